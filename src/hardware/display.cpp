@@ -1,186 +1,489 @@
 #include "display.h"
-#include "hardware/i2c.h"
+#include "oled.h"
+#include "i2c.h"
+#include "hardware/sync.h"
 #include "pico/time.h"
 #include <cstring>
 #include <algorithm>
-#include <cstdio>    // for snprintf
-#include "hardware/gpio.h"  // for GPIO_FUNC_I2C
 
 namespace pg1000 {
 namespace hardware {
 
 // Static member initialization
+DisplayType Display::type = DisplayType::LCD_16X2;
+Display::Graphics Display::graphics = {};
+Display::Graphics Display::graphics_drawn = {};
 uint8_t Display::backlight_state = LCD_BACKLIGHT;
-char Display::display_buffer[ROWS][COLS + 1] = {{0}};
+char Display::frame[ROWS][COLS] = {};
+char Display::shown[ROWS][COLS] = {};
+uint8_t Display::cursor_col = 0;
+uint8_t Display::cursor_row = 0;
+uint8_t Display::cgram[8][8] = {};
+uint8_t Display::cgram_loaded = 0;
 uint32_t Display::last_update = 0;
+std::array<Display::Op, Display::QUEUE_SIZE> Display::queue = {};
+volatile uint16_t Display::queue_head = 0;
+volatile uint16_t Display::queue_tail = 0;
+volatile bool Display::draining = false;
+Display::QueueStats Display::queue_stats = {};
+std::array<uint8_t, Display::STREAM_SIZE> Display::stream = {};
+volatile bool Display::stream_busy = false;
+volatile bool Display::resync_needed = false;
 
-// Custom character definitions
-const uint8_t CUSTOM_CHAR_FULL_DATA[] = {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F};
-const uint8_t CUSTOM_CHAR_HALF_DATA[] = {0x1F, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F};
+// Bar glyphs, every row n columns wide
+static constexpr uint8_t left_columns(uint8_t n) { return static_cast<uint8_t>((0x1F << (5 - n)) & 0x1F); }
+static constexpr uint8_t right_columns(uint8_t n) { return static_cast<uint8_t>((1 << n) - 1); }
 
-bool Display::init() {
-    // Initialize I2C for display
-    i2c_init(i2c1, 100000);  // 100kHz
-    gpio_set_function(6, GPIO_FUNC_I2C);  // SDA
-    gpio_set_function(7, GPIO_FUNC_I2C);  // SCL
+static_assert(left_columns(5) == 0x1F && left_columns(1) == 0x10 && right_columns(1) == 0x01,
+              "Bar glyph columns");
 
-    // Wait for LCD to power up
-    sleep_ms(50);
+bool Display::init(DisplayType display_type) {
+    type = display_type;
+    memset(shown, ' ', sizeof(shown));
+    if (type != DisplayType::LCD_16X2) {
+        clear();
+        return Oled::init(Oled::Controller::SSD1306, type == DisplayType::OLED_128X64);
+    }
 
-    // Initialize in 4-bit mode
-    write_4bits(0x03 << 4);
-    sleep_ms(5);
+    // I2C1 is set up by I2C::init_all(), streams go through its engine
+
+    // Power-up wait and 4-bit mode switch, timed by the queue
+    enqueue(50, OP_WAIT);
     write_4bits(0x03 << 4);
-    sleep_ms(5);
+    enqueue(5, OP_WAIT);
     write_4bits(0x03 << 4);
-    sleep_us(150);
+    enqueue(5, OP_WAIT);
+    write_4bits(0x03 << 4);  // The next nibble is more than 150us behind
     write_4bits(0x02 << 4);
 
     // Set up the LCD
     write_command(LCD_FUNCTIONSET | 0x08);  // 2-line display
     write_command(LCD_DISPLAYCONTROL | LCD_DISPLAY_ON);  // Display on
     write_command(LCD_CLEARDISPLAY);  // Clear display
-    sleep_ms(2);
     write_command(LCD_ENTRYMODESET | 0x02);  // Increment cursor
 
-    // Create custom characters
-    create_custom_char(CUSTOM_CHAR_FULL, CUSTOM_CHAR_FULL_DATA);
-    create_custom_char(CUSTOM_CHAR_HALF, CUSTOM_CHAR_HALF_DATA);
+    // Bar glyphs
+    for(uint8_t n = 1; n <= CELL_STEPS; n++) {
+        uint8_t glyph[8];
+        memset(glyph, left_columns(n), sizeof(glyph));
+        create_custom_char(bar_cell(n), glyph);
+    }
 
+    // The clear command above left the LCD blank
     clear();
     return true;
 }
 
 void Display::clear() {
-    write_command(LCD_CLEARDISPLAY);
-    sleep_ms(2);
-    memset(display_buffer, ' ', sizeof(display_buffer));
-    for(uint8_t i = 0; i < ROWS; i++) {
-        display_buffer[i][COLS] = '\0';
-    }
+    memset(frame, ' ', sizeof(frame));
+    graphics = {};
+    cursor_col = 0;
+    cursor_row = 0;
 }
 
 void Display::set_cursor(uint8_t col, uint8_t row) {
-    const uint8_t row_offsets[] = {0x00, 0x40};
-    write_command(LCD_SETDDRAMADDR | (col + row_offsets[row & 0x01]));
+    cursor_col = col;
+    cursor_row = row & 0x01;
 }
 
 void Display::print(std::string_view str) {
     for(char c : str) {
-        write_data(c);
+        if(cursor_col >= COLS) break;
+        frame[cursor_row][cursor_col++] = c;
     }
 }
 
 void Display::print_at(uint8_t col, uint8_t row, std::string_view str) {
-    if(row >= ROWS) return;
-    
-    // Check if update is needed
-    if(!needs_update(row, str)) return;
-    
+    if(row >= ROWS || col >= COLS) return;
     set_cursor(col, row);
-    size_t len = std::min(str.length(), static_cast<size_t>(COLS - col));
-    
-    // Update buffer
-    memcpy(&display_buffer[row][col], str.data(), len);
-    print(str.substr(0, len));
+    print(str);
+}
+
+void Display::print_row(uint8_t row, std::string_view str) {
+    if(row >= ROWS) return;
+    size_t len = std::min(str.length(), static_cast<size_t>(COLS));
+    memcpy(frame[row], str.data(), len);
+    memset(&frame[row][len], ' ', COLS - len);
 }
 
-void Display::show_parameter(std::string_view name, uint8_t value, uint8_t max_value) {
+void Display::show_parameter(std::string_view name, std::string_view value_text, uint8_t value,
+                             uint8_t max_value, uint8_t zero) {
     // First line: Parameter name
-    print_at(0, 0, name);
-    
-    // Second line: Value and progress bar
-    char value_str[6];
-    snprintf(value_str, sizeof(value_str), "%3d", value);
-    print_at(0, 1, value_str);
-    
+    print_row(0, name);
+    graphics.envelope = false;
+
+    // Second line: Value right aligned in 3 cells (4 if it needs them), then the bar
+    size_t len = std::min(value_text.length(), static_cast<size_t>(BAR_START));
+    size_t start = (len < BAR_START) ? BAR_START - 1 - len : 0;
+    memset(frame[1], ' ', BAR_START);
+    memcpy(&frame[1][start], value_text.data(), len);
+
     // Progress bar
-    show_progress_bar(value, max_value);
+    show_progress_bar(value, max_value, zero);
 }
 
 void Display::show_message(std::string_view line1, std::string_view line2) {
-    print_at(0, 0, line1);
-    if(line2.empty()) {
-        // Clear second line if no text provided
-        print_at(0, 1, std::string_view("                ", 16));
-    } else {
-        print_at(0, 1, line2);
-    }
+    // Whole rows, an empty line2 clears the second line
+    print_row(0, line1);
+    print_row(1, line2);
+    graphics = {};
+}
+
+uint8_t Display::bar_cell(uint8_t columns) {
+    if(columns == 0) return ' ';
+    return (columns >= CELL_STEPS) ? GLYPH_FULL : columns;
 }
 
-void Display::show_progress_bar(uint8_t value, uint8_t max_value) {
-    const uint8_t BAR_START = 4;  // Start after value display
-    const uint8_t BAR_LENGTH = COLS - BAR_START;
-    
-    float percentage = static_cast<float>(value) / max_value;
-    uint8_t filled_chars = static_cast<uint8_t>(percentage * BAR_LENGTH);
-    
-    set_cursor(BAR_START, 1);
-    
-    // Draw filled section
-    for(uint8_t i = 0; i < filled_chars; i++) {
-        write_data(CUSTOM_CHAR_FULL);
+void Display::show_progress_bar(uint8_t value, uint8_t max_value, uint8_t zero) {
+    char* bar = &frame[1][BAR_START];
+    if(max_value == 0) max_value = 1;
+    if(value > max_value) value = max_value;
+    if(zero > max_value) zero = max_value;
+
+    // The OLED draws it with pixels over blank cells
+    if(type != DisplayType::LCD_16X2) {
+        memset(bar, ' ', BAR_CELLS);
+        graphics.bar = true;
+        graphics.zero = zero;
+        graphics.value = value;
+        graphics.max_value = max_value;
+        return;
     }
-    
-    // Draw empty section
-    for(uint8_t i = filled_chars; i < BAR_LENGTH; i++) {
-        write_data(' ');
+
+    if(zero == 0) {
+        // Rounded to the nearest of 60 pixel columns
+        uint16_t filled = (value * BAR_STEPS + max_value / 2) / max_value;
+        for(uint8_t i = 0; i < BAR_CELLS; i++) {
+            uint16_t before = i * CELL_STEPS;
+            bar[i] = bar_cell(filled > before ? filled - before : 0);
+        }
+        return;
     }
+
+    // Zero on the cell boundary nearest to it, keeping a cell for each
+    // side the range has. Each side is scaled to its own columns.
+    uint8_t zero_cell = (zero * BAR_CELLS + max_value / 2) / max_value;
+    if(zero < max_value) zero_cell = std::clamp<uint8_t>(zero_cell, 1, BAR_CELLS - 1);
+    const uint16_t centre = zero_cell * CELL_STEPS;
+    uint16_t right = 0;
+    uint16_t left = 0;
+    if(value > zero) {
+        right = ((value - zero) * (BAR_STEPS - centre) + (max_value - zero) / 2) / (max_value - zero);
+    } else if(value < zero) {
+        left = ((zero - value) * centre + zero / 2) / zero;
+    }
+
+    // Zero shows as one column next to the centre
+    if(left == 0 && right == 0) {
+        if(centre > 0) {
+            left = 1;
+        } else {
+            right = 1;
+        }
+    }
+
+    // Right of zero grows from the centre like a plain bar. Left of it
+    // at most one cell is partial, it uses the right-filled slot.
+    for(uint8_t i = 0; i < BAR_CELLS; i++) {
+        uint16_t start = i * CELL_STEPS;
+        if(start >= centre) {
+            uint16_t before = start - centre;
+            bar[i] = bar_cell(right > before ? right - before : 0);
+            continue;
+        }
+
+        uint16_t before = centre - start - CELL_STEPS;
+        uint16_t columns = (left > before) ? left - before : 0;
+        if(columns == 0) {
+            bar[i] = ' ';
+        } else if(columns >= CELL_STEPS) {
+            bar[i] = GLYPH_FULL;
+        } else {
+            uint8_t glyph[8];
+            memset(glyph, right_columns(columns), sizeof(glyph));
+            create_custom_char(GLYPH_RIGHT, glyph);
+            bar[i] = GLYPH_RIGHT;
+        }
+    }
+}
+
+void Display::show_envelope(const uint8_t* times, const uint8_t* levels) {
+    if(type == DisplayType::LCD_16X2) return;
+    graphics.envelope = true;
+    memcpy(graphics.times, times, sizeof(graphics.times));
+    memcpy(graphics.levels, levels, sizeof(graphics.levels));
 }
 
 void Display::create_custom_char(uint8_t location, const uint8_t* char_map) {
+    if(type != DisplayType::LCD_16X2) return;
     location &= 0x7;  // Only 8 custom characters allowed
+    if((cgram_loaded & (1 << location)) && memcmp(cgram[location], char_map, 8) == 0) return;
+    memcpy(cgram[location], char_map, 8);
+    cgram_loaded |= 1 << location;
+
     write_command(LCD_SETCGRAMADDR | (location << 3));
     for(int i = 0; i < 8; i++) {
         write_data(char_map[i]);
     }
 }
 
+uint16_t Display::flush() {
+    return (type == DisplayType::LCD_16X2) ? flush_lcd() : flush_oled();
+}
+
+uint16_t Display::flush_oled() {
+    // Graphics that changed are wiped, with the text cells under them
+    if(memcmp(&graphics, &graphics_drawn, sizeof(Graphics)) != 0) {
+        if(graphics_drawn.bar) {
+            Oled::fill_rect(BAR_START * OLED_CELL_WIDTH, OLED_ROW_HEIGHT, Oled::WIDTH, OLED_BAR_HEIGHT, false);
+            memset(&shown[1][BAR_START], 0, BAR_CELLS);
+        }
+        if(graphics_drawn.envelope) {
+            Oled::fill_rect(0, OLED_ENVELOPE_TOP, Oled::WIDTH, Oled::HEIGHT - OLED_ENVELOPE_TOP, false);
+        }
+    }
+
+    uint16_t drawn = 0;
+    for(uint8_t row = 0; row < ROWS; row++) {
+        for(uint8_t col = 0; col < COLS; col++) {
+            if(frame[row][col] == shown[row][col]) continue;
+            Oled::draw_char(col * OLED_CELL_WIDTH, row * OLED_ROW_HEIGHT, frame[row][col]);
+            shown[row][col] = frame[row][col];
+            drawn++;
+        }
+    }
+
+    if(memcmp(&graphics, &graphics_drawn, sizeof(Graphics)) != 0) {
+        draw_graphics();
+        graphics_drawn = graphics;
+    }
+
+    // Only the pages whose bytes changed go out
+    Oled::flush();
+    return drawn;
+}
+
+void Display::draw_graphics() {
+    if(graphics.bar) {
+        // Outline with the value inside, a tick at zero for signed values
+        const int x = BAR_START * OLED_CELL_WIDTH;
+        const int y = OLED_ROW_HEIGHT;
+        const int width = Oled::WIDTH - x;
+        const int inner = width - 4;
+        Oled::draw_rect(x, y, width, OLED_BAR_HEIGHT);
+        if(graphics.zero == 0) {
+            int filled = (graphics.value * inner + graphics.max_value / 2) / graphics.max_value;
+            Oled::fill_rect(x + 2, y + 2, filled, OLED_BAR_HEIGHT - 4);
+        } else {
+            // Each side of zero scaled to the pixels it has
+            const int value = graphics.value;
+            const int zero = graphics.zero;
+            const int max_value = graphics.max_value;
+            int centre = x + 2 + (zero * inner + max_value / 2) / max_value;
+            int offset = 0;
+            if(value > zero) {
+                offset = (value - zero) * (x + 2 + inner - centre) / (max_value - zero);
+            } else if(value < zero) {
+                offset = -((zero - value) * (centre - x - 2) / zero);
+            }
+            if(offset >= 0) {
+                Oled::fill_rect(centre, y + 2, offset, OLED_BAR_HEIGHT - 4);
+            } else {
+                Oled::fill_rect(centre + offset, y + 2, -offset, OLED_BAR_HEIGHT - 4);
+            }
+            Oled::fill_rect(centre, y, 1, OLED_BAR_HEIGHT);
+        }
+    }
+
+    if(graphics.envelope) {
+        const int top = OLED_ENVELOPE_TOP + 1;
+        const int height = Oled::HEIGHT - top;
+        auto level_y = [&](uint8_t level) {
+            return Oled::HEIGHT - 1 - (std::min<uint8_t>(level, 100) * (height - 1) + 50) / 100;
+        };
+
+        // Dotted zero line
+        for(int x = 0; x < Oled::WIDTH; x += 4) {
+            Oled::set_pixel(x, level_y(50));
+        }
+
+        // L0 -T1- L1 -T2- L2 -T3- sustain, held, -T4- end
+        int x = 0;
+        int y = level_y(graphics.levels[0]);
+        const uint8_t targets[] = {graphics.levels[1], graphics.levels[2], graphics.levels[3],
+                                   graphics.levels[3], graphics.levels[4]};
+        for(uint8_t segment = 0; segment < 5; segment++) {
+            int width = OLED_SUSTAIN_WIDTH;
+            if(segment != 3) {
+                uint8_t time = graphics.times[segment < 3 ? segment : 3];
+                width = std::min<uint8_t>(time, 50) * OLED_TIME_WIDTH / 50;
+            }
+            int next_y = level_y(targets[segment]);
+            Oled::draw_line(x, y, x + width, next_y);
+            x += width;
+            y = next_y;
+        }
+    }
+}
+
+uint16_t Display::flush_lcd() {
+    // After lost writes nothing is sent until the queue is empty, then
+    // everything is
+    if(resync_needed) {
+        if(draining) return 0;
+        resync_lcd();
+    }
+
+    uint16_t written = 0;
+
+    for(uint8_t row = 0; row < ROWS; row++) {
+        uint8_t col = 0;
+        while(col < COLS) {
+            if(frame[row][col] == shown[row][col]) {
+                col++;
+                continue;
+            }
+
+            // Extend the run while the next difference is close enough
+            uint8_t first = col;
+            uint8_t last = col;
+            for(uint8_t next = col + 1; next < COLS && next - last - 1 <= MAX_BRIDGE; next++) {
+                if(frame[row][next] != shown[row][next]) last = next;
+            }
+
+            set_address(first, row);
+            for(uint8_t i = first; i <= last; i++) {
+                write_data(frame[row][i]);
+                shown[row][i] = frame[row][i];
+            }
+            written += 1 + (last - first + 1);
+            col = last + 1;
+        }
+    }
+    return written;
+}
+
+void Display::resync_lcd() {
+    resync_needed = false;
+    queue_stats.resyncs++;
+
+    // Glyphs as they should be, then every cell differs from shown
+    for(uint8_t slot = 0; slot < 8; slot++) {
+        if(!(cgram_loaded & (1 << slot))) continue;
+        write_command(LCD_SETCGRAMADDR | (slot << 3));
+        for(int i = 0; i < 8; i++) {
+            write_data(cgram[slot][i]);
+        }
+    }
+    memset(shown, 0, sizeof(shown));
+}
+
+void Display::set_address(uint8_t col, uint8_t row) {
+    const uint8_t row_offsets[] = {0x00, 0x40};
+    write_command(LCD_SETDDRAMADDR | (col + row_offsets[row & 0x01]));
+}
+
 void Display::write_command(uint8_t cmd) {
-    send(cmd, true);
+    // Clear and home take far longer than the other commands
+    enqueue(cmd, (cmd != 0 && cmd < LCD_ENTRYMODESET) ? OP_SLOW : 0);
 }
 
 void Display::write_data(uint8_t data) {
-    send(data, false);
+    enqueue(data, OP_DATA);
 }
 
 void Display::write_4bits(uint8_t value) {
-    pulse_enable(value);
-}
-
-void Display::pulse_enable(uint8_t value) {
-    uint8_t data = value | backlight_state;
-    
-    // Enable pulse must be at least 450ns wide
-    uint8_t en = data | LCD_ENABLE;
-    uint8_t buf[] = {0x00, en};
-    i2c_write_blocking(i2c1, I2C_ADDR, buf, 2, false);
-    sleep_us(1);
-    
-    buf[1] = data & ~LCD_ENABLE;
-    i2c_write_blocking(i2c1, I2C_ADDR, buf, 2, false);
-    sleep_us(50);  // Commands need >37us to settle
-}
-
-void Display::send(uint8_t value, bool is_command) {
-    uint8_t high = value & 0xF0;
-    uint8_t low = (value << 4) & 0xF0;
-    
-    if(!is_command) {
-        high |= LCD_REGISTER_SELECT;
-        low |= LCD_REGISTER_SELECT;
-    }
-    
-    write_4bits(high);
-    write_4bits(low);
-}
-
-bool Display::needs_update(uint8_t row, std::string_view new_text) {
-    if(row >= ROWS) return false;
-    
-    // Compare with current buffer
-    size_t len = std::min(new_text.length(), static_cast<size_t>(COLS));
-    return memcmp(display_buffer[row], new_text.data(), len) != 0;
+    enqueue(value, OP_NIBBLE);
+}
+
+void Display::enqueue(uint8_t value, uint8_t flags) {
+    // Only when several screens are written faster than the bus drains.
+    // Once one write is lost the rest wait for the resync too, or they
+    // would land at the wrong address.
+    uint16_t next = (queue_head + 1) % QUEUE_SIZE;
+    if (next == queue_tail || resync_needed) {
+        resync_needed = true;
+        queue_stats.dropped++;
+        return;
+    }
+    queue[queue_head] = {value, flags};
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    queue_head = next;
+    bool start = !draining;
+    draining = true;
+    restore_interrupts(irq_state);
+
+    queue_stats.ops++;
+    uint16_t depth = (queue_head + QUEUE_SIZE - queue_tail) % QUEUE_SIZE;
+    if (depth > queue_stats.peak_depth) queue_stats.peak_depth = depth;
+
+    if (start) {
+        add_alarm_in_us(10, on_alarm, nullptr, true);
+    }
+}
+
+int64_t Display::on_alarm(alarm_id_t, void*) {
+    // The previous stream is still going out. The alarm is the only
+    // submitter on I2C1, so a free descriptor now is still free below.
+    if (stream_busy || I2C::get_free(I2C::Bus::BUS1) == 0) {
+        return -static_cast<int64_t>(4 * BYTE_US);
+    }
+
+    static_assert(STREAM_SIZE <= I2C::MAX_WRITE, "A stream must fit one I2C transaction");
+    uint32_t wait_us = 0;
+    size_t length = 0;
+    while (queue_tail != queue_head) {
+        const Op op = queue[queue_tail];
+        if (op.flags & OP_WAIT) {
+            // Starts once the stream so far is out
+            if (length > 0) break;
+            queue_tail = (queue_tail + 1) % QUEUE_SIZE;
+            wait_us = op.value * 1000u;
+            break;
+        }
+
+        uint8_t nibbles = (op.flags & OP_NIBBLE) ? 1 : 2;
+        if (length + nibbles * 2u > STREAM_SIZE) break;
+
+        uint8_t rs = ((op.flags & OP_DATA) ? LCD_REGISTER_SELECT : 0) | backlight_state;
+        for (uint8_t i = 0; i < nibbles; i++) {
+            uint8_t nibble = ((i == 0) ? (op.value & 0xF0) : ((op.value << 4) & 0xF0)) | rs;
+            stream[length++] = nibble | LCD_ENABLE;
+            stream[length++] = nibble;
+        }
+        queue_tail = (queue_tail + 1) % QUEUE_SIZE;
+
+        // A plain byte's 37us is covered by the next byte's own bus time
+        if (op.flags & OP_SLOW) {
+            wait_us = SLOW_US;
+            break;
+        }
+    }
+
+    if (length > 0) {
+        stream_busy = true;
+        if (I2C::submit(I2C::Bus::BUS1, I2C_ADDR, stream.data(), length, nullptr, 0, on_stream_done)) {
+            wait_us += (length + 1) * BYTE_US;
+            queue_stats.transactions++;
+            queue_stats.bus_bytes += length + 1;
+        } else {
+            // Never called back, and the ops are gone
+            stream_busy = false;
+            resync_needed = true;
+        }
+    }
+
+    if (wait_us == 0) {
+        draining = false;
+        return 0;
+    }
+    return -static_cast<int64_t>(wait_us);
+}
+
+void Display::on_stream_done(bool ok, void*) {
+    if (!ok) resync_needed = true;
+    stream_busy = false;
 }
 
 } // namespace hardware
@@ -1,33 +1,78 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
+#include <array>
 #include <string_view>
+#include "pico/time.h"
 
 namespace pg1000 {
 namespace hardware {
 
+// Where the text and graphics end up
+enum class DisplayType : uint8_t {
+    LCD_16X2,      // HD44780 behind a PCF8574 on I2C1
+    OLED_128X64,   // SSD1306 on SPI1, see Oled
+    HOST           // OLED framebuffer only, no bus, for tests
+};
+
+// The same 16x2 text model on every back end. The OLED draws the bar with
+// pixels and can show graphics the character LCD can't.
 class Display {
 public:
     static constexpr uint8_t COLS = 16;
     static constexpr uint8_t ROWS = 2;
 
     // Initialize display
-    static bool init();
+    static bool init(DisplayType display_type = DisplayType::LCD_16X2);
+    static DisplayType get_type() { return type; }
 
-    // Basic display control
+    // Basic display control. These only change the framebuffer in RAM,
+    // flush() sends the cells that differ from the display.
     static void clear();
     static void set_cursor(uint8_t col, uint8_t row);
     static void print(std::string_view str);
     static void print_at(uint8_t col, uint8_t row, std::string_view str);
 
     // Specialized display functions
-    static void show_parameter(std::string_view name, uint8_t value, uint8_t max_value);
+    // Values run from 0 to max_value, value_text is the value as shown
+    // (up to 4 characters). zero is the value shown as 0, -min_value for a
+    // signed range: above 0 the bar grows either way from there.
+    static void show_parameter(std::string_view name, std::string_view value_text, uint8_t value,
+                               uint8_t max_value, uint8_t zero = 0);
     static void show_message(std::string_view line1, std::string_view line2 = "");
-    static void show_progress_bar(uint8_t value, uint8_t max_value);
+    static void show_progress_bar(uint8_t value, uint8_t max_value, uint8_t zero = 0);
 
-    // Custom character support
+    // D-50 style envelope under the parameter: 4 times (0-50) and the
+    // levels L0, L1, L2, sustain and end (0-100, 50 is zero). OLED only,
+    // cleared by the next show_parameter() or show_message().
+    static void show_envelope(const uint8_t* times, const uint8_t* levels);
+
+    // Custom character support. CGRAM contents are tracked, a glyph is
+    // only uploaded when it differs from what the LCD holds.
     static void create_custom_char(uint8_t location, const uint8_t* char_map);
 
+    // Send the changed cells: on the LCD as few DDRAM address + data runs
+    // as possible, on the OLED as dirty pages. Returns the bytes queued
+    // (LCD) or cells drawn (OLED).
+    static uint16_t flush();
+
+    // All of the above only queue LCD writes, a timer alarm streams them
+    // to the backpack through the I2C engine in the background. Nothing
+    // waits for the queue: with it full, or a stream lost on the bus,
+    // writes are dropped and the next flush() once it has drained sends
+    // the glyphs and the whole screen again.
+    struct QueueStats {
+        uint32_t ops;          // LCD bytes queued
+        uint16_t peak_depth;   // Most ops waiting at once
+        uint32_t dropped;      // Writes thrown away until the resync
+        uint32_t resyncs;
+        uint32_t transactions; // I2C writes, one per stream
+        uint32_t bus_bytes;    // Including the address byte of each write
+    };
+    static bool is_busy() { return draining; }
+    static const QueueStats& get_queue_stats() { return queue_stats; }
+
 private:
     static constexpr uint8_t I2C_ADDR = 0x27;
     static constexpr uint8_t I2C_PORT = 1;  // i2c1
@@ -47,25 +92,102 @@ private:
     static constexpr uint8_t LCD_ENABLE = 0x04;
     static constexpr uint8_t LCD_REGISTER_SELECT = 0x01;
 
-    // Custom characters
-    static constexpr uint8_t CUSTOM_CHAR_FULL = 0;
-    static constexpr uint8_t CUSTOM_CHAR_HALF = 1;
+    // Bar graph, 5 pixel columns per cell
+    static constexpr uint8_t BAR_START = 4;  // After the value
+    static constexpr uint8_t BAR_CELLS = COLS - BAR_START;
+    static constexpr uint8_t CELL_STEPS = 5;
+    static constexpr uint8_t BAR_STEPS = BAR_CELLS * CELL_STEPS;
+
+    // Custom characters: 1-4 columns filled from the left in slots 1-4,
+    // full in slot 5. Slot 6 holds the one partial cell left of zero in a
+    // signed value's bar, filled from the right, and is changed as needed.
+    static constexpr uint8_t GLYPH_FULL = 5;
+    static constexpr uint8_t GLYPH_RIGHT = 6;
+
+    // Unchanged cells between two runs are rewritten rather than starting
+    // a new run, when that's no more bytes than the address command
+    static constexpr uint8_t MAX_BRIDGE = 1;
+
+    // OLED layout: 8 pixel wide cells, the bar right of the value and
+    // the envelope below
+    static constexpr uint8_t OLED_CELL_WIDTH = 8;
+    static constexpr uint8_t OLED_ROW_HEIGHT = 12;
+    static constexpr uint8_t OLED_BAR_HEIGHT = 8;
+    static constexpr uint8_t OLED_ENVELOPE_TOP = 26;
+    static constexpr uint8_t OLED_SUSTAIN_WIDTH = 16;
+    static constexpr uint8_t OLED_TIME_WIDTH = 24;  // Pixels for a time of 50
+
+    // Graphics wanted on the OLED, one byte fields so they compare with memcmp
+    struct Graphics {
+        bool bar;
+        uint8_t zero;
+        uint8_t value;
+        uint8_t max_value;
+        bool envelope;
+        uint8_t times[4];
+        uint8_t levels[5];
+    };
 
     // Internal state
+    static DisplayType type;
+    static Graphics graphics;
+    static Graphics graphics_drawn;
     static uint8_t backlight_state;
-    static char display_buffer[ROWS][COLS + 1];
+    static char frame[ROWS][COLS];   // What the UI wants shown
+    static char shown[ROWS][COLS];   // What has been queued to the LCD
+    static uint8_t cursor_col;
+    static uint8_t cursor_row;
+    static uint8_t cgram[8][8];
+    static uint8_t cgram_loaded;    // Bit per slot
     static uint32_t last_update;
 
+    // Write queue. HD44780 execution times are kept by scheduling the
+    // next alarm, never by sleeping.
+    struct Op {
+        uint8_t value;
+        uint8_t flags;
+    };
+    static constexpr uint8_t OP_DATA = 0x01;     // RS high
+    static constexpr uint8_t OP_NIBBLE = 0x02;   // High nibble only, for the 4-bit mode switch
+    static constexpr uint8_t OP_SLOW = 0x04;     // Clear/home, 1.52 ms to execute
+    static constexpr uint8_t OP_WAIT = 0x08;     // No write, pause for value ms
+
+    static constexpr size_t QUEUE_SIZE = 128;    // Three full screens
+    static constexpr uint32_t SLOW_US = 1600;
+    static constexpr uint32_t BYTE_US = 90;      // 9 clocks at 100 kHz
+
+    // PCF8574 bytes of one I2C write: every nibble is the data with E high,
+    // then with E low. The backpack latches each byte as it arrives, and a
+    // byte's 90us on the bus is far over the 450ns E pulse width.
+    static constexpr uint8_t STREAM_OPS = 18;    // Address command and a full row
+    static constexpr size_t STREAM_SIZE = STREAM_OPS * 4;
+    static std::array<uint8_t, STREAM_SIZE> stream;
+    static volatile bool stream_busy;  // Submitted, not yet through the I2C engine
+    static volatile bool resync_needed; // Writes were lost, the LCD no longer matches shown
+
+    static std::array<Op, QUEUE_SIZE> queue;
+    static volatile uint16_t queue_head;
+    static volatile uint16_t queue_tail;
+    static volatile bool draining;
+    static QueueStats queue_stats;
+
+    static void enqueue(uint8_t value, uint8_t flags);
+    static int64_t on_alarm(alarm_id_t id, void* user_data);
+    static void on_stream_done(bool ok, void* context);
+
     // Low-level functions
     static void write_command(uint8_t cmd);
     static void write_data(uint8_t data);
     static void write_4bits(uint8_t value);
-    static void pulse_enable(uint8_t value);
-    static void send(uint8_t value, bool is_command);
-    
+    static void set_address(uint8_t col, uint8_t row);
+    static uint16_t flush_lcd();
+    static void resync_lcd();
+    static uint16_t flush_oled();
+    static void draw_graphics();
+
     // Buffer management
-    static void update_buffer();
-    static bool needs_update(uint8_t row, std::string_view new_text);
+    static void print_row(uint8_t row, std::string_view str);  // Pads with spaces
+    static uint8_t bar_cell(uint8_t columns);                  // Filled from the left
 };
 
 } // namespace hardware
@@ -0,0 +1,51 @@
+#include "flash.h"
+#include "hardware/sync.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+
+namespace pg1000 {
+namespace hardware {
+
+const uint8_t* Flash::read(uint32_t offset) {
+    return reinterpret_cast<const uint8_t*>(XIP_BASE + offset);
+}
+
+bool Flash::erase(uint32_t offset, uint32_t size) {
+    if (offset % SECTOR_SIZE || size % SECTOR_SIZE || offset + size > SIZE) return false;
+
+    // A whole library half at once would keep interrupts off for most of
+    // a second
+    for (uint32_t sector = offset; sector < offset + size; sector += SECTOR_SIZE) {
+        uint32_t irq_state = begin_busy();
+        flash_range_erase(sector, SECTOR_SIZE);
+        end_busy(irq_state);
+    }
+    return true;
+}
+
+bool Flash::program(uint32_t offset, const uint8_t* data, uint32_t size) {
+    if (!data || offset % PAGE_SIZE || size % PAGE_SIZE || offset + size > SIZE) return false;
+
+    uint32_t irq_state = begin_busy();
+    flash_range_program(offset, data, size);
+    end_busy(irq_state);
+    return true;
+}
+
+uint32_t Flash::begin_busy() {
+    uint32_t irq_state = save_and_disable_interrupts();
+    uart_set_fifo_enabled(uart0, true);  // MIDI in, normally one interrupt per byte
+    return irq_state;
+}
+
+void Flash::end_busy(uint32_t irq_state) {
+    // The UART interrupt empties the FIFO as soon as interrupts are back,
+    // without waiting for the receive timeout. Bytes that arrived while
+    // the flash was busy are stamped late.
+    irq_set_pending(UART0_IRQ);
+    restore_interrupts(irq_state);
+    uart_set_fifo_enabled(uart0, false);
+}
+
+} // namespace hardware
+} // namespace pg1000
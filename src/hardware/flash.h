@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include "hardware/flash.h"
+
+namespace pg1000 {
+namespace hardware {
+
+// On-board QSPI flash, addressed by offset from the start of flash.
+// Erase and program run with interrupts disabled (code can't execute from
+// flash meanwhile). Erases go one sector at a time with interrupts back on
+// in between, and the MIDI UART's receive FIFO holds what arrives while
+// the flash is busy: 32 bytes, about 10 ms at 31250 baud against up to
+// 45 ms for a sector. Clock and active sensing fit, a SysEx stream
+// doesn't, so only use them for explicit user actions like saving a patch.
+class Flash {
+public:
+    static constexpr uint32_t PAGE_SIZE = FLASH_PAGE_SIZE;      // Smallest program unit
+    static constexpr uint32_t SECTOR_SIZE = FLASH_SECTOR_SIZE;  // Smallest erase unit
+    static constexpr uint32_t SIZE = PICO_FLASH_SIZE_BYTES;
+
+    // Round a size up to whole pages
+    static constexpr uint32_t page_align(uint32_t size) {
+        return (size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    }
+
+    // Memory mapped contents
+    static const uint8_t* read(uint32_t offset);
+
+    // Offset and size must be multiples of SECTOR_SIZE
+    static bool erase(uint32_t offset, uint32_t size);
+
+    // Offset and size must be multiples of PAGE_SIZE, data must be in RAM
+    static bool program(uint32_t offset, const uint8_t* data, uint32_t size);
+
+private:
+    static uint32_t begin_busy();
+    static void end_busy(uint32_t irq_state);
+};
+
+} // namespace hardware
+} // namespace pg1000
@@ -1,23 +1,25 @@
 #include "gpio.h"
-#include "hardware/i2c.h"
+#include "hardware.h"
+#include "i2c.h"
+#include "hardware/sync.h"
 #include "pico/time.h"
-#include "hardware/gpio.h"  // for GPIO_FUNC_I2C
+#include "hardware/gpio.h"
 
 namespace pg1000 {
 namespace hardware {
 
 // Static member initialization
 std::array<GPIO::Button, GPIO::NUM_BUTTONS> GPIO::buttons = {{
-    {0, false, false, 0, "COMMON_UPPER"},     // Common Upper selector
-    {1, false, false, 0, "COMMON_LOWER"},     // Common Lower selector
-    {2, false, false, 0, "PARTIAL_UP1"},      // Upper Partial 1
-    {3, false, false, 0, "PARTIAL_UP2"},      // Upper Partial 2
-    {4, false, false, 0, "PARTIAL_LOW1"},     // Lower Partial 1
-    {5, false, false, 0, "PARTIAL_LOW2"},     // Lower Partial 2
-    {6, false, false, 0, "MIDI_CHANNEL"},     // MIDI Channel button
-    {7, false, false, 0, "MANUAL"},           // Manual Mode button
-    {8, false, false, 0, "PARAM_REQ"},        // Parameter Request
-    {9, false, false, 0, "PREV_VALUE"}        // Previous Value comparison
+    {0, false, false, 0, 0, "COMMON_UPPER"},     // Common Upper selector
+    {1, false, false, 0, 0, "COMMON_LOWER"},     // Common Lower selector
+    {2, false, false, 0, 0, "PARTIAL_UP1"},      // Upper Partial 1
+    {3, false, false, 0, 0, "PARTIAL_UP2"},      // Upper Partial 2
+    {4, false, false, 0, 0, "PARTIAL_LOW1"},     // Lower Partial 1
+    {5, false, false, 0, 0, "PARTIAL_LOW2"},     // Lower Partial 2
+    {6, false, false, 0, 0, "MIDI_CHANNEL"},     // MIDI Channel button
+    {7, false, false, 0, 0, "MANUAL"},           // Manual Mode button
+    {14, false, false, 0, 0, "PARAM_REQ"},       // Parameter Request, GPB6
+    {15, false, false, 0, 0, "PREV_VALUE"}       // Previous Value comparison, GPB7
 }};
 
 std::array<GPIO::Led, GPIO::NUM_LEDS> GPIO::leds = {{
@@ -29,21 +31,58 @@ std::array<GPIO::Led, GPIO::NUM_LEDS> GPIO::leds = {{
     {5, LedState::OFF, 0, "PARTIAL_LOW2"}     // Lower Partial 2 LED
 }};
 
+std::array<ButtonEvent, GPIO::EVENT_QUEUE_SIZE> GPIO::events = {};
+uint8_t GPIO::event_head = 0;
+uint8_t GPIO::event_count = 0;
+uint32_t GPIO::dropped_events = 0;
+volatile bool GPIO::change_pending = false;
+volatile uint32_t GPIO::change_time = 0;
+bool GPIO::settling = false;
+uint32_t GPIO::settle_time = 0;
+uint8_t GPIO::led_output = 0;
+uint32_t GPIO::transaction_count = 0;
+uint32_t GPIO::window_start = 0;
+GPIO::Stats GPIO::stats = {};
+GPIO::Stats GPIO::window = {};
+std::array<uint8_t, GPIO::CHANGE_BURST> GPIO::sample = {};
+uint32_t GPIO::sample_time = 0;
+uint32_t GPIO::sample_start = 0;
+volatile bool GPIO::read_in_flight = false;
+volatile bool GPIO::sample_ready = false;
+
 bool GPIO::init() {
-    // Initialize I2C
-    i2c_init(i2c0, 400000);  // 400kHz
-    gpio_set_function(4, GPIO_FUNC_I2C);  // SDA
-    gpio_set_function(5, GPIO_FUNC_I2C);  // SCL
-    
-    // Configure MCP23017
-    // Port A: Inputs (buttons)
-    write_register(REG_IODIRA, 0xFF);
-    write_register(REG_GPPUA, 0xFF);  // Enable pull-ups
-    
-    // Port B: Outputs (LEDs)
-    write_register(REG_IODIRB, 0x00);
-    write_register(REG_GPIOB, 0x00);  // All LEDs off
-    
+    // Configure MCP23017, waiting for each write so a missing chip shows.
+    // I2C0 itself is set up by I2C::init_all().
+    constexpr uint8_t setup[][2] = {
+        // Port A: Inputs (buttons), interrupt on any change
+        {REG_IOCON, IOCON_MIRROR | IOCON_ODR},
+        {REG_IODIRA, 0xFF},
+        {REG_GPPUA, 0xFF},      // Enable pull-ups
+        {REG_INTCONA, 0x00},    // Compare against the previous value
+        {REG_GPINTENA, 0xFF},
+        // Port B: Outputs (LEDs), the top two pins buttons like port A
+        {REG_IODIRB, PORTB_BUTTONS},
+        {REG_GPPUB, PORTB_BUTTONS},
+        {REG_INTCONB, 0x00},
+        {REG_GPINTENB, PORTB_BUTTONS},
+        {REG_GPIOB, 0x00}       // All LEDs off
+    };
+    for (const auto& reg : setup) {
+        if (!I2C::write_byte(I2C::Bus::BUS0, I2C_ADDR, reg[0], reg[1])) return false;
+    }
+    led_output = 0;
+
+    // INTA is open drain and active low
+    gpio_init(Pins::MCP23017_INTA);
+    gpio_set_dir(Pins::MCP23017_INTA, GPIO_IN);
+    gpio_pull_up(Pins::MCP23017_INTA);
+    gpio_set_irq_enabled_with_callback(Pins::MCP23017_INTA, GPIO_IRQ_EDGE_FALL, true, on_button_irq);
+
+    // Initial state, the read also releases INTA if it was already low
+    uint8_t ports[2];
+    if (!I2C::read_bytes(I2C::Bus::BUS0, I2C_ADDR, REG_GPIOA, ports, 2)) return false;
+    apply_button_sample(ports[0] | (ports[1] << 8), time_us_32());
+
     return true;
 }
 
@@ -71,38 +110,199 @@ bool GPIO::get_button_pressed(uint8_t button) {
     return false;
 }
 
+uint32_t GPIO::get_button_time(uint8_t button) {
+    return (button < NUM_BUTTONS) ? buttons[button].last_change : 0;
+}
+
+bool GPIO::next_event(ButtonEvent& event) {
+    if (event_count == 0) return false;
+    event = events[event_head];
+    event_head = (event_head + 1) % EVENT_QUEUE_SIZE;
+    event_count--;
+    return true;
+}
+
+void GPIO::set_auto_repeat(uint8_t button, bool enabled) {
+    if (button < NUM_BUTTONS) {
+        buttons[button].auto_repeat = enabled;
+    }
+}
+
+void GPIO::push_event(uint8_t button, ButtonEventType type, uint32_t time_us, uint8_t repeats) {
+    if (event_count == EVENT_QUEUE_SIZE) {
+        dropped_events++;
+        return;
+    }
+    events[(event_head + event_count) % EVENT_QUEUE_SIZE] = {time_us, button, type, repeats};
+    event_count++;
+}
+
 void GPIO::update() {
     update_buttons();
     update_leds();
+
+    uint32_t current_time = time_us_32();
+    if (current_time - window_start >= 1000000) {
+        stats = window;
+        window = {};
+        window_start = current_time;
+    }
 }
 
-void GPIO::write_register(uint8_t reg, uint8_t value) {
+bool GPIO::write_register(uint8_t reg, uint8_t value) {
     uint8_t buf[] = {reg, value};
-    i2c_write_blocking(i2c0, I2C_ADDR, buf, 2, false);
+    if (!I2C::submit(I2C::Bus::BUS0, I2C_ADDR, buf, 2)) return false;
+    transaction_count++;
+    window.transactions++;
+    return true;
+}
+
+bool GPIO::start_read(uint8_t reg, uint8_t count, uint32_t time_us) {
+    // The values land at their place in the burst, a GPIOA/B read at the end
+    uint8_t* values = &sample[CHANGE_BURST - count];
+    if (count < CHANGE_BURST) sample[0] = sample[1] = 0;  // No flags, INTCAPA/B aren't used
+
+    read_in_flight = true;
+    if (!I2C::submit(I2C::Bus::BUS0, I2C_ADDR, &reg, 1, values, count, on_read_done)) {
+        read_in_flight = false;
+        return false;
+    }
+    sample_time = time_us;
+    sample_start = time_us_32();
+    transaction_count++;
+    window.transactions++;
+    window.button_reads++;
+    return true;
 }
 
-uint8_t GPIO::read_register(uint8_t reg) {
-    uint8_t value;
-    i2c_write_blocking(i2c0, I2C_ADDR, &reg, 1, true);
-    i2c_read_blocking(i2c0, I2C_ADDR, &value, 1, false);
-    return value;
+void GPIO::on_read_done(bool ok, void*) {
+    // From the I2C interrupt, a failed read is retried as INTA stays low
+    sample_ready = ok;
+    read_in_flight = false;
+}
+
+void GPIO::apply_sample() {
+    // A port without a flag has a stale INTCAP, e.g. zero since reset or
+    // INTA found low with no edge, so its current value stands in
+    constexpr uint8_t capture = REG_INTCAPA - REG_INTFA;
+    constexpr uint8_t current = REG_GPIOA - REG_INTFA;
+    if (sample[0] != 0 || sample[1] != 0) {
+        uint8_t port_a = sample[0] ? sample[capture] : sample[current];
+        uint8_t port_b = sample[1] ? sample[capture + 1] : sample[current + 1];
+        apply_button_sample(port_a | (port_b << 8), sample_time);
+    }
+    apply_button_sample(sample[current] | (sample[current + 1] << 8), sample_start);
+}
+
+void GPIO::on_button_irq(unsigned int gpio, uint32_t events) {
+    if (gpio != Pins::MCP23017_INTA) return;
+
+    // Keep the first edge, that's when INTCAPA/B were latched
+    if (!change_pending) change_time = time_us_32();
+    change_pending = true;
 }
 
 void GPIO::update_buttons() {
-    // Read button states
-    uint8_t button_states = read_register(REG_GPIOA);
-    uint32_t current_time = time_us_32();
-    
-    // Update button states with debouncing
     for (auto& button : buttons) {
-        bool raw_state = !(button_states & (1 << button.bit));
-        
+        button.prev_state = button.state;  // Press events last a single update
+    }
+
+    if (sample_ready) {
+        sample_ready = false;
+        apply_sample();
+    }
+
+    uint32_t current_time = time_us_32();
+    if (!read_in_flight && !sample_ready) {
+        uint32_t irq_state = save_and_disable_interrupts();
+        bool pending = change_pending;
+        uint32_t time = change_time;
+        change_pending = false;
+        restore_interrupts(irq_state);
+
+        // INTA still low means an edge was missed, e.g. it fell while already low
+        if (!pending && !gpio_get(Pins::MCP23017_INTA)) {
+            pending = true;
+            time = current_time;
+        }
+
+        if (pending) {
+            // INTCAPA/B hold the ports as they were at the interrupt and
+            // reading them releases INTA. GPIOA/B are read as well, since
+            // later changes made while INTA was low don't raise a new interrupt.
+            if (!start_read(REG_INTFA, CHANGE_BURST, time)) change_pending = true;
+        } else if (settling && current_time - settle_time > DEBOUNCE_US) {
+            // A rejected bounce may have been the last edge, look again once quiet
+            start_read(REG_GPIOA, 2, current_time);
+        }
+    }
+
+    update_held_buttons(current_time);
+}
+
+void GPIO::press_button(uint8_t index, uint32_t time_us) {
+    Button& button = buttons[index];
+    button.held = false;
+    button.repeats = 0;
+    button.next_repeat = time_us + REPEAT_DELAY_US;
+    button.repeat_interval = REPEAT_START_US;
+    push_event(index, ButtonEventType::PRESS, time_us);
+
+    // A third press starts over rather than making another double
+    if (button.double_armed && time_us - button.last_press <= DOUBLE_PRESS_US) {
+        push_event(index, ButtonEventType::DOUBLE_PRESS, time_us);
+        button.double_armed = false;
+    } else {
+        button.double_armed = true;
+    }
+    button.last_press = time_us;
+}
+
+void GPIO::update_held_buttons(uint32_t current_time) {
+    for (uint8_t i = 0; i < NUM_BUTTONS; i++) {
+        Button& button = buttons[i];
+        if (!button.state) continue;
+
+        if (!button.held && current_time - button.last_change >= HOLD_US) {
+            button.held = true;
+            push_event(i, ButtonEventType::HOLD, button.last_change + HOLD_US);
+        }
+
+        // Shorter intervals the longer it's held, at most one per update
+        if (button.auto_repeat && static_cast<int32_t>(current_time - button.next_repeat) >= 0) {
+            if (button.repeats < UINT8_MAX) button.repeats++;
+            push_event(i, ButtonEventType::REPEAT, button.next_repeat, button.repeats);
+            button.next_repeat += button.repeat_interval;
+            if (static_cast<int32_t>(current_time - button.next_repeat) >= 0) {
+                button.next_repeat = current_time + button.repeat_interval;  // Fell behind
+            }
+            button.repeat_interval -= button.repeat_interval / 4;
+            if (button.repeat_interval < REPEAT_MIN_US) button.repeat_interval = REPEAT_MIN_US;
+        }
+    }
+}
+
+void GPIO::apply_button_sample(uint16_t ports, uint32_t time_us) {
+    settling = false;
+
+    for (uint8_t i = 0; i < NUM_BUTTONS; i++) {
+        Button& button = buttons[i];
+        bool raw_state = !(ports & (1 << button.bit));
+
         if (raw_state != button.state) {
-            if (current_time - button.last_debounce > 5000) {  // 5ms debounce
-                button.prev_state = button.state;
+            if (time_us - button.last_debounce > DEBOUNCE_US) {
                 button.state = raw_state;
+                button.last_change = time_us;
+                if (raw_state) {
+                    press_button(i, time_us);
+                } else {
+                    push_event(i, ButtonEventType::RELEASE, time_us);
+                }
+            } else {
+                settling = true;
+                settle_time = time_us;
             }
-            button.last_debounce = current_time;
+            button.last_debounce = time_us;
         }
     }
 }
@@ -133,7 +333,11 @@ void GPIO::update_leds() {
         }
     }
     
-    write_register(REG_GPIOB, led_state);
+    // Only blink edges and state changes reach the bus, retried next
+    // update if the I2C pool is full
+    if (led_state == led_output || !write_register(REG_GPIOB, led_state)) return;
+    led_output = led_state;
+    window.led_writes++;
 }
 
 } // namespace hardware
@@ -13,17 +13,48 @@ enum class LedState {
     BLINK_FAST
 };
 
+enum class ButtonEventType : uint8_t {
+    PRESS,
+    RELEASE,
+    HOLD,          // Once, when held for GPIO::HOLD_US
+    REPEAT,        // While held, buttons with auto-repeat only
+    DOUBLE_PRESS   // Follows the PRESS of a second press in quick succession
+};
+
+struct ButtonEvent {
+    uint32_t time_us;  // Debounced edge, or when the hold or repeat fell due
+    uint8_t button;
+    ButtonEventType type;
+    uint8_t repeats;   // REPEAT events so far in this hold
+};
+
 class GPIO {
 public:
     static constexpr uint8_t NUM_BUTTONS = 10;
     static constexpr uint8_t NUM_LEDS = 6;
+    static constexpr uint8_t EVENT_QUEUE_SIZE = 16;
+
+    // Button timing
+    static constexpr uint32_t HOLD_US = 1000000;
+    static constexpr uint32_t REPEAT_DELAY_US = 400000;
+    static constexpr uint32_t REPEAT_START_US = 120000;  // First interval, shrinks by a quarter per repeat
+    static constexpr uint32_t REPEAT_MIN_US = 25000;
+    static constexpr uint32_t DOUBLE_PRESS_US = 300000;
 
     struct Button {
         uint8_t bit;
         bool state;
         bool prev_state;
         uint32_t last_debounce;
+        uint32_t last_change;  // Time of the last accepted press or release
         const char* name;
+        bool auto_repeat = false;
+        bool held = false;         // HOLD sent for this press
+        uint8_t repeats = 0;
+        uint32_t next_repeat = 0;
+        uint32_t repeat_interval = 0;
+        uint32_t last_press = 0;   // For double presses
+        bool double_armed = false; // last_press can still start a double press
     };
 
     struct Led {
@@ -43,6 +74,17 @@ public:
     // Button reading
     static bool get_button(uint8_t button);
     static bool get_button_pressed(uint8_t button);  // Returns true on press event
+    static uint32_t get_button_time(uint8_t button);  // When the current state began
+
+    // Events in the order they happened. If the queue fills up, new
+    // events are dropped and counted.
+    static bool next_event(ButtonEvent& event);
+    static void set_auto_repeat(uint8_t button, bool enabled);
+    static uint32_t get_dropped_events() { return dropped_events; }
+
+    // Debounce a sample of both ports taken at time_us, port A in the low
+    // byte (bit clear = pressed)
+    static void apply_button_sample(uint16_t ports, uint32_t time_us);
 
     // Button indices
     static constexpr uint8_t BTN_COMMON_UPPER = 0;
@@ -67,28 +109,88 @@ public:
     // Update function (handles debouncing and LED blinking)
     static void update();
 
+    // I2C0 traffic for the last full second. A transaction runs from
+    // START to STOP, so a register read with a repeated start is one.
+    struct Stats {
+        uint16_t transactions;
+        uint16_t led_writes;
+        uint16_t button_reads;
+    };
+    static const Stats& get_stats() { return stats; }
+    static uint32_t get_transaction_count() { return transaction_count; }  // Since init
+
 private:
     static constexpr uint8_t I2C_ADDR = 0x20;
     static constexpr uint8_t I2C_PORT = 0;  // i2c0
+    static constexpr uint32_t DEBOUNCE_US = 5000;
 
     // MCP23017 registers
     static constexpr uint8_t REG_IODIRA = 0x00;
     static constexpr uint8_t REG_IODIRB = 0x01;
+    static constexpr uint8_t REG_GPINTENA = 0x04;
+    static constexpr uint8_t REG_GPINTENB = 0x05;
+    static constexpr uint8_t REG_INTCONA = 0x08;
+    static constexpr uint8_t REG_INTCONB = 0x09;
+    static constexpr uint8_t REG_IOCON = 0x0A;
     static constexpr uint8_t REG_GPPUA = 0x0C;
     static constexpr uint8_t REG_GPPUB = 0x0D;
+    static constexpr uint8_t REG_INTFA = 0x0E;
+    static constexpr uint8_t REG_INTCAPA = 0x10;
     static constexpr uint8_t REG_GPIOA = 0x12;
     static constexpr uint8_t REG_GPIOB = 0x13;
 
+    // INTFA, INTFB, INTCAPA, INTCAPB, GPIOA, GPIOB, read as one burst
+    static constexpr uint8_t CHANGE_BURST = REG_GPIOB - REG_INTFA + 1;
+
+    // IOCON: INTA open drain and mirrored to cover port B, sequential
+    // addressing left on
+    static constexpr uint8_t IOCON_MIRROR = 0x40;
+    static constexpr uint8_t IOCON_ODR = 0x04;
+
+    // Port B: LEDs on GPB0-5, PARAM REQ and PREV VALUE on GPB6-7
+    static constexpr uint8_t PORTB_BUTTONS = 0xC0;
+
     // Internal state
     static std::array<Button, NUM_BUTTONS> buttons;
     static std::array<Led, NUM_LEDS> leds;
+
+    // Set by the INTA interrupt, cleared once the ports have been read
+    static volatile bool change_pending;
+    static volatile uint32_t change_time;
+    static std::array<ButtonEvent, EVENT_QUEUE_SIZE> events;
+    static uint8_t event_head;
+    static uint8_t event_count;
+    static uint32_t dropped_events;
+
+    static bool settling;  // A bounce was rejected, the ports are read again once quiet
+    static uint32_t settle_time;
+
+    static uint8_t led_output;  // Last LED bits written to GPIOB
+
+    // Port read in flight on the I2C engine, picked up by the next update
+    static std::array<uint8_t, CHANGE_BURST> sample;
+    static uint32_t sample_time;    // Edge time for INTCAPA/B
+    static uint32_t sample_start;   // When the read was queued, for GPIOA/B
+    static volatile bool read_in_flight;
+    static volatile bool sample_ready;
+
+    static uint32_t transaction_count;
+    static uint32_t window_start;
+    static Stats window;
+    static Stats stats;
     
-    // I2C utility functions
-    static void write_register(uint8_t reg, uint8_t value);
-    static uint8_t read_register(uint8_t reg);
+    // I2C utility functions, queued on the I2C engine
+    static bool write_register(uint8_t reg, uint8_t value);
+    static bool start_read(uint8_t reg, uint8_t count, uint32_t time_us);  // Sequential addresses
+    static void on_read_done(bool ok, void* context);
+    static void apply_sample();
     
     // Update functions
     static void update_buttons();
+    static void update_held_buttons(uint32_t current_time);
+    static void press_button(uint8_t index, uint32_t time_us);
+    static void push_event(uint8_t button, ButtonEventType type, uint32_t time_us, uint8_t repeats = 0);
+    static void on_button_irq(unsigned int gpio, uint32_t events);
     static void update_leds();
 };
 
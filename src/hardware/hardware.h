@@ -16,11 +16,19 @@ struct Pins {
     // I2C0 (MCP23017)
     static constexpr uint8_t I2C0_SDA = 4;
     static constexpr uint8_t I2C0_SCL = 5;
+    static constexpr uint8_t MCP23017_INTA = 2;  // Button change interrupt, active low
 
     // I2C1 (LCD)
     static constexpr uint8_t I2C1_SDA = 6;
     static constexpr uint8_t I2C1_SCL = 7;
 
+    // SPI1 (optional OLED instead of the LCD)
+    static constexpr uint8_t OLED_SCK = 10;
+    static constexpr uint8_t OLED_MOSI = 11;
+    static constexpr uint8_t OLED_CS = 13;
+    static constexpr uint8_t OLED_DC = 14;
+    static constexpr uint8_t OLED_RST = 15;
+
     // MIDI UART
     static constexpr uint8_t MIDI_TX = 0;
     static constexpr uint8_t MIDI_RX = 1;
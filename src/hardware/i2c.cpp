@@ -1,15 +1,23 @@
 #include "i2c.h"
 #include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "pico/platform.h"
 #include "pico/stdlib.h"
 #include <cstring>
-#include <cstdio>    // for printf, snprintf
+#include <cstdio>    // for printf
 #include <cstddef>   // for size_t
 #include "hardware/gpio.h"  // for GPIO_FUNC_I2C
-#include "pico/stdlib.h"
 
 namespace pg1000 {
 namespace hardware {
 
+static constexpr uint32_t WINDOW_US = 1000000;
+static constexpr uint32_t TX_REFILL_LEVEL = 4;  // TX_EMPTY fires at or below this many words
+
+// Static member initialization
+std::array<I2C::Engine, 2> I2C::engines = {};
+
 bool I2C::init(Bus bus) {
     const Config& config = get_config(bus);
     i2c_inst_t* i2c = get_i2c_inst(bus);
@@ -24,6 +32,23 @@ bool I2C::init(Bus bus) {
     // Enable pull-ups
     gpio_pull_up(config.sda_pin);
     gpio_pull_up(config.scl_pin);
+
+    // Interrupts: TX FIFO low, a byte received, STOP and abort. TX_EMPTY is
+    // only unmasked while a transaction has words left to queue.
+    i2c_hw_t* hw = i2c_get_hw(i2c);
+    hw->intr_mask = 0;
+    hw->tx_tl = TX_REFILL_LEVEL;
+    hw->rx_tl = 0;
+
+    Engine& engine = get_engine(bus);
+    engine.tail = 0;
+    engine.count = 0;
+    engine.active = false;
+    engine.target = 0xFF;
+
+    unsigned irq = (bus == Bus::BUS0) ? I2C0_IRQ : I2C1_IRQ;
+    irq_set_exclusive_handler(irq, (bus == Bus::BUS0) ? on_i2c0_irq : on_i2c1_irq);
+    irq_set_enabled(irq, true);
     
     return true;
 }
@@ -32,74 +57,245 @@ bool I2C::init_all() {
     return init(Bus::BUS0) && init(Bus::BUS1);
 }
 
+bool I2C::submit(Bus bus, uint8_t device_addr, const uint8_t* write_data, size_t write_length,
+                 uint8_t* read_data, size_t read_length, Callback callback, void* context) {
+    if (!check_bus(bus) || write_length > MAX_WRITE || read_length > UINT8_MAX) return false;
+    if (write_length + read_length == 0 || (write_length && !write_data) || (read_length && !read_data)) return false;
+
+    Engine& engine = get_engine(bus);
+    uint32_t irq_state = save_and_disable_interrupts();
+    if (engine.count == POOL_SIZE) {
+        engine.window.refused++;
+        restore_interrupts(irq_state);
+        return false;
+    }
+
+    Transaction& transaction = engine.pool[(engine.tail + engine.count) % POOL_SIZE];
+    transaction.address = device_addr;
+    transaction.write_length = static_cast<uint8_t>(write_length);
+    transaction.read_length = static_cast<uint8_t>(read_length);
+    if (write_length > 0) memcpy(transaction.write_data.data(), write_data, write_length);
+    transaction.read_data = read_data;
+    transaction.callback = callback;
+    transaction.context = context;
+    transaction.submit_us = time_us_32();
+    engine.count++;
+
+    if (!engine.active) start_next(bus);
+    restore_interrupts(irq_state);
+    return true;
+}
+
+uint8_t I2C::get_free(Bus bus) {
+    return check_bus(bus) ? POOL_SIZE - get_engine(bus).count : 0;
+}
+
+bool I2C::is_idle(Bus bus) {
+    return !check_bus(bus) || get_engine(bus).count == 0;
+}
+
+void I2C::start_next(Bus bus) {
+    Engine& engine = get_engine(bus);
+    i2c_hw_t* hw = i2c_get_hw(get_i2c_inst(bus));
+    if (engine.count == 0) {
+        engine.active = false;
+        hw->intr_mask = 0;
+        return;
+    }
+
+    // IC_TAR can only change with the block disabled, which is fine between transactions
+    const Transaction& transaction = engine.pool[engine.tail];
+    if (engine.target != transaction.address) {
+        hw->enable = 0;
+        hw->tar = transaction.address;
+        hw->enable = 1;
+        engine.target = transaction.address;
+    }
+
+    engine.active = true;
+    engine.sent = 0;
+    engine.received = 0;
+    engine.aborted = false;
+    engine.start_us = time_us_32();
+
+    hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS |
+                    I2C_IC_INTR_MASK_M_RX_FULL_BITS | I2C_IC_INTR_MASK_M_TX_EMPTY_BITS;
+    fill_tx(bus);
+}
+
+void I2C::fill_tx(Bus bus) {
+    Engine& engine = get_engine(bus);
+    i2c_hw_t* hw = i2c_get_hw(get_i2c_inst(bus));
+    const Transaction& transaction = engine.pool[engine.tail];
+    uint16_t total = transaction.write_length + transaction.read_length;
+
+    // The master holds SCL low if the FIFO runs dry before the STOP word
+    while (engine.sent < total && hw->txflr < FIFO_DEPTH) {
+        uint32_t word;
+        if (engine.sent < transaction.write_length) {
+            word = transaction.write_data[engine.sent];
+        } else {
+            word = I2C_IC_DATA_CMD_CMD_BITS;
+            if (engine.sent == transaction.write_length && transaction.write_length > 0) {
+                word |= I2C_IC_DATA_CMD_RESTART_BITS;
+            }
+        }
+        if (engine.sent == total - 1) word |= I2C_IC_DATA_CMD_STOP_BITS;
+        hw->data_cmd = word;
+        engine.sent++;
+    }
+
+    if (engine.sent == total) {
+        hw->intr_mask &= ~I2C_IC_INTR_MASK_M_TX_EMPTY_BITS;
+    }
+}
+
+void I2C::on_irq(Bus bus) {
+    Engine& engine = get_engine(bus);
+    i2c_hw_t* hw = i2c_get_hw(get_i2c_inst(bus));
+    uint32_t status = hw->intr_stat;
+    if (!engine.active) {
+        hw->intr_mask = 0;
+        return;
+    }
+
+    // An abort flushes the TX FIFO and ends in a STOP, completed below
+    if (status & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+        hw->clr_tx_abrt;
+        engine.aborted = true;
+        hw->intr_mask &= ~I2C_IC_INTR_MASK_M_TX_EMPTY_BITS;
+    }
+
+    Transaction& transaction = engine.pool[engine.tail];
+    while (hw->rxflr > 0) {
+        uint8_t value = static_cast<uint8_t>(hw->data_cmd);
+        if (engine.received < transaction.read_length) transaction.read_data[engine.received++] = value;
+    }
+
+    if (status & I2C_IC_INTR_STAT_R_STOP_DET_BITS) {
+        hw->clr_stop_det;
+        complete(bus);
+        start_next(bus);
+        return;
+    }
+
+    if ((status & I2C_IC_INTR_STAT_R_TX_EMPTY_BITS) && !engine.aborted) {
+        fill_tx(bus);
+    }
+}
+
+void I2C::complete(Bus bus) {
+    Engine& engine = get_engine(bus);
+    const Transaction& transaction = engine.pool[engine.tail];
+    bool ok = !engine.aborted && engine.received == transaction.read_length;
+
+    uint32_t now = time_us_32();
+    uint32_t latency = now - transaction.submit_us;
+    engine.window.transactions++;
+    if (!ok) engine.window.errors++;
+    engine.window.bytes += 1 + transaction.write_length + transaction.read_length +
+                           ((transaction.write_length && transaction.read_length) ? 1 : 0);
+    engine.window.busy_us += now - engine.start_us;
+    engine.window.latency_us += latency;
+    if (latency > engine.window.max_latency_us) engine.window.max_latency_us = latency;
+
+    roll_window(engine, now);
+
+    // Free the slot first, so the callback can submit the next transaction
+    Callback callback = transaction.callback;
+    void* context = transaction.context;
+    engine.tail = (engine.tail + 1) % POOL_SIZE;
+    engine.count--;
+    if (callback) callback(ok, context);
+}
+
+void I2C::roll_window(Engine& engine, uint32_t now_us) {
+    if (now_us - engine.window_start_us < WINDOW_US) return;
+    engine.stats = engine.window;
+    engine.window = {};
+    engine.window_start_us = now_us;
+}
+
+const I2C::Stats& I2C::get_stats(Bus bus) {
+    // Also rolled here, or an idle bus would keep showing its last busy second
+    Engine& engine = get_engine(bus);
+    uint32_t irq_state = save_and_disable_interrupts();
+    roll_window(engine, time_us_32());
+    restore_interrupts(irq_state);
+    return engine.stats;
+}
+
+uint8_t I2C::get_utilisation(Bus bus) {
+    uint32_t busy_us = get_stats(bus).busy_us;
+    return static_cast<uint8_t>((busy_us >= WINDOW_US) ? 100 : busy_us * 100 / WINDOW_US);
+}
+
+uint32_t I2C::get_average_latency(Bus bus) {
+    const Stats& stats = get_stats(bus);
+    return stats.transactions ? stats.latency_us / stats.transactions : 0;
+}
+
+void I2C::print_stats() {
+    for (Bus bus : {Bus::BUS0, Bus::BUS1}) {
+        const Stats& stats = get_stats(bus);
+        printf("I2C%d: %u transactions, %lu bytes, %u%% busy, latency %lu us avg %lu us max, %u errors, %u refused\n",
+               static_cast<int>(bus), stats.transactions, static_cast<unsigned long>(stats.bytes),
+               get_utilisation(bus), static_cast<unsigned long>(get_average_latency(bus)),
+               static_cast<unsigned long>(stats.max_latency_us), stats.errors, stats.refused);
+    }
+}
+
+bool I2C::transfer_blocking(Bus bus, uint8_t device_addr, const uint8_t* write_data, size_t write_length,
+                            uint8_t* read_data, size_t read_length) {
+    volatile int8_t result = -1;
+    if (!submit(bus, device_addr, write_data, write_length, read_data, read_length,
+                on_blocking_done, const_cast<int8_t*>(&result))) {
+        return false;
+    }
+    while (result < 0) {
+        tight_loop_contents();
+    }
+    return result == 1;
+}
+
+void I2C::on_blocking_done(bool ok, void* context) {
+    *static_cast<volatile int8_t*>(context) = ok ? 1 : 0;
+}
+
 bool I2C::write_byte(Bus bus, uint8_t device_addr, uint8_t reg, uint8_t data) {
-    if (!check_bus(bus)) return false;
-    
     uint8_t buf[2] = {reg, data};
-    return i2c_write_blocking(get_i2c_inst(bus), device_addr, buf, 2, false) == 2;
+    return transfer_blocking(bus, device_addr, buf, 2, nullptr, 0);
 }
 
 bool I2C::write_bytes(Bus bus, uint8_t device_addr, uint8_t reg, const uint8_t* data, size_t length) {
-    if (!check_bus(bus) || !data || length == 0) return false;
-    
-    // Allocate temporary buffer for register address + data
-    uint8_t* buf = new uint8_t[length + 1];
-    if (!buf) return false;
-    
-    // Prepare buffer
+    if (!data || length == 0 || length + 1 > MAX_WRITE) return false;
+
+    // Register address + data
+    uint8_t buf[MAX_WRITE];
     buf[0] = reg;
     memcpy(buf + 1, data, length);
-    
-    // Write data
-    bool success = i2c_write_blocking(get_i2c_inst(bus), device_addr, buf, length + 1, false) == length + 1;
-    
-    delete[] buf;
-    return success;
+    return transfer_blocking(bus, device_addr, buf, length + 1, nullptr, 0);
 }
 
 bool I2C::read_byte(Bus bus, uint8_t device_addr, uint8_t reg, uint8_t& data) {
-    if (!check_bus(bus)) return false;
-    
-    // Write register address
-    if (i2c_write_blocking(get_i2c_inst(bus), device_addr, &reg, 1, true) != 1) {
-        return false;
-    }
-    
-    // Read data
-    return i2c_read_blocking(get_i2c_inst(bus), device_addr, &data, 1, false) == 1;
+    return transfer_blocking(bus, device_addr, &reg, 1, &data, 1);
 }
 
 bool I2C::read_bytes(Bus bus, uint8_t device_addr, uint8_t reg, uint8_t* data, size_t length) {
-    if (!check_bus(bus) || !data || length == 0) return false;
-    
-    // Write register address
-    if (i2c_write_blocking(get_i2c_inst(bus), device_addr, &reg, 1, true) != 1) {
-        return false;
-    }
-    
-    // Read data
-    return i2c_read_blocking(get_i2c_inst(bus), device_addr, data, length, false) == length;
+    return transfer_blocking(bus, device_addr, &reg, 1, data, length);
 }
 
 bool I2C::write_raw(Bus bus, uint8_t device_addr, uint8_t data) {
-    if (!check_bus(bus)) return false;
-    
-    return i2c_write_blocking(get_i2c_inst(bus), device_addr, &data, 1, false) == 1;
+    return transfer_blocking(bus, device_addr, &data, 1, nullptr, 0);
 }
 
 bool I2C::read_raw(Bus bus, uint8_t device_addr, uint8_t& data) {
-    if (!check_bus(bus)) return false;
-    
-    return i2c_read_blocking(get_i2c_inst(bus), device_addr, &data, 1, false) == 1;
+    return transfer_blocking(bus, device_addr, nullptr, 0, &data, 1);
 }
 
 bool I2C::device_present(Bus bus, uint8_t device_addr) {
-    if (!check_bus(bus)) return false;
-    
     uint8_t dummy;
-    int result = i2c_read_blocking(get_i2c_inst(bus), device_addr, &dummy, 1, false);
-    
-    return result >= 0;  // Non-negative result indicates device responded
+    return read_raw(bus, device_addr, dummy);  // A missing device NACKs its address
 }
 
 void I2C::scan_bus(Bus bus) {
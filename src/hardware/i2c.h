@@ -2,11 +2,15 @@
 
 #include <cstdint>
 #include <cstddef>  // for size_t
+#include <array>
 #include "hardware/i2c.h"
 
 namespace pg1000 {
 namespace hardware {
 
+// Both I2C buses, driven by interrupt. Devices submit transactions to a
+// fixed pool of descriptors per bus and carry on; the bus works through
+// them in order and calls back from its interrupt when each one is done.
 class I2C {
 public:
     // I2C Bus identifiers
@@ -28,11 +32,28 @@ public:
     static constexpr uint8_t ADDR_MCP23017 = 0x20;  // Default MCP23017 address
     static constexpr uint8_t ADDR_LCD = 0x27;       // Default LCD address
 
+    static constexpr uint8_t POOL_SIZE = 8;     // Transactions queued per bus
+    static constexpr uint8_t MAX_WRITE = 72;    // Bytes, a full LCD stream
+    static constexpr uint8_t FIFO_DEPTH = 16;
+
+    // Called from the bus interrupt, ok is false on a NACK or other abort
+    using Callback = void (*)(bool ok, void* context);
+
     // Initialize I2C buses
     static bool init(Bus bus);
     static bool init_all();
 
-    // Basic I2C operations
+    // Queue a write, then a read with a repeated start; either may be
+    // empty. write_data is copied, read_data must stay valid until the
+    // callback. False if the bus's pool is full.
+    static bool submit(Bus bus, uint8_t device_addr, const uint8_t* write_data, size_t write_length,
+                       uint8_t* read_data = nullptr, size_t read_length = 0,
+                       Callback callback = nullptr, void* context = nullptr);
+    static uint8_t get_free(Bus bus);   // Descriptors left in the pool
+    static bool is_idle(Bus bus);
+
+    // Basic I2C operations. These wait for the transaction, for start-up
+    // and diagnostics only.
     static bool write_byte(Bus bus, uint8_t device_addr, uint8_t reg, uint8_t data);
     static bool write_bytes(Bus bus, uint8_t device_addr, uint8_t reg, const uint8_t* data, size_t length);
     static bool read_byte(Bus bus, uint8_t device_addr, uint8_t reg, uint8_t& data);
@@ -46,6 +67,21 @@ public:
     static bool device_present(Bus bus, uint8_t device_addr);
     static void scan_bus(Bus bus);  // For debugging - scans for devices
 
+    // Figures for the last full second
+    struct Stats {
+        uint16_t transactions;
+        uint16_t errors;          // NACKs and other aborts
+        uint16_t refused;         // Submits that found the pool full
+        uint32_t bytes;           // On the wire, address bytes included
+        uint32_t busy_us;         // First byte queued to STOP
+        uint32_t latency_us;      // Submit to completion, summed
+        uint32_t max_latency_us;
+    };
+    static const Stats& get_stats(Bus bus);
+    static uint8_t get_utilisation(Bus bus);       // Percent of the second the bus was busy
+    static uint32_t get_average_latency(Bus bus);  // us
+    static void print_stats();
+
 private:
     // Hardware configurations
     static constexpr Config BUS0_CONFIG = {
@@ -64,12 +100,56 @@ private:
         7               // SCL pin
     };
 
+    struct Transaction {
+        uint8_t address;
+        uint8_t write_length;
+        uint8_t read_length;
+        std::array<uint8_t, MAX_WRITE> write_data;
+        uint8_t* read_data;
+        Callback callback;
+        void* context;
+        uint32_t submit_us;
+    };
+
+    // One per bus. The pool is a ring, the transaction at tail is the one
+    // on the bus.
+    struct Engine {
+        std::array<Transaction, POOL_SIZE> pool;
+        uint8_t tail;
+        volatile uint8_t count;
+        volatile bool active;
+        uint16_t sent;       // Command words in the TX FIFO so far
+        uint8_t received;
+        bool aborted;
+        uint8_t target;      // Address in IC_TAR
+        uint32_t start_us;
+        uint32_t window_start_us;
+        Stats window;
+        Stats stats;
+    };
+
+    static std::array<Engine, 2> engines;
+
     // Get hardware i2c instance for bus
     static i2c_inst_t* get_i2c_inst(Bus bus);
-    
+
+    // Transaction engine, called with interrupts off or from the bus interrupt
+    static void start_next(Bus bus);
+    static void fill_tx(Bus bus);
+    static void complete(Bus bus);
+    static void on_irq(Bus bus);
+    static void roll_window(Engine& engine, uint32_t now_us);
+    static void on_i2c0_irq() { on_irq(Bus::BUS0); }
+    static void on_i2c1_irq() { on_irq(Bus::BUS1); }
+
+    static bool transfer_blocking(Bus bus, uint8_t device_addr, const uint8_t* write_data, size_t write_length,
+                                  uint8_t* read_data, size_t read_length);
+    static void on_blocking_done(bool ok, void* context);
+
     // Internal helper functions
     static bool check_bus(Bus bus);
     static const Config& get_config(Bus bus);
+    static Engine& get_engine(Bus bus) { return engines[static_cast<size_t>(bus)]; }
 };
 
 } // namespace hardware
@@ -0,0 +1,233 @@
+#include "oled.h"
+#include "hardware.h"
+#include "font5x7.h"
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "pico/time.h"
+#include <cstring>
+
+namespace pg1000 {
+namespace hardware {
+
+// Static member initialization
+std::array<uint8_t, Oled::BUFFER_SIZE> Oled::buffer = {};
+volatile uint8_t Oled::dirty = 0;
+volatile bool Oled::sending = false;
+uint8_t Oled::page_sending = 0;
+uint32_t Oled::pages_sent = 0;
+Oled::Controller Oled::controller = Oled::Controller::SSD1306;
+bool Oled::connected = false;
+int Oled::dma_channel = -1;
+
+// Page addressing mode, 64 rows, charge pump on, column 0 on the left
+static constexpr uint8_t INIT_COMMANDS[] = {
+    0xAE,        // Display off
+    0xD5, 0x80,  // Clock divide
+    0xA8, 0x3F,  // Multiplex, 64 rows
+    0xD3, 0x00,  // Display offset
+    0x40,        // Start line 0
+    0x8D, 0x14,  // SSD1306 charge pump on (ignored by the SH1106)
+    0x20, 0x02,  // Page addressing
+    0xA1,        // Segment remap
+    0xC8,        // COM scan from the bottom
+    0xDA, 0x12,  // COM pins
+    0x81, 0xCF,  // Contrast
+    0xD9, 0xF1,  // Precharge
+    0xDB, 0x40,  // VCOMH
+    0xA4,        // Show RAM contents
+    0xA6,        // Not inverted
+    0xAF         // Display on
+};
+
+bool Oled::init(Controller type, bool bus) {
+    controller = type;
+    connected = bus;
+    buffer.fill(0);
+    dirty = 0xFF;
+    if (!connected) return true;
+
+    spi_init(spi1, SPI_FREQUENCY);
+    gpio_set_function(Pins::OLED_SCK, GPIO_FUNC_SPI);
+    gpio_set_function(Pins::OLED_MOSI, GPIO_FUNC_SPI);
+    for (uint8_t pin : {Pins::OLED_CS, Pins::OLED_DC, Pins::OLED_RST}) {
+        gpio_init(pin);
+        gpio_set_dir(pin, GPIO_OUT);
+        gpio_put(pin, 1);
+    }
+
+    // Reset pulse, once at power up
+    gpio_put(Pins::OLED_RST, 0);
+    sleep_us(10);
+    gpio_put(Pins::OLED_RST, 1);
+    sleep_us(10);
+
+    // The panel stays selected, it's alone on the bus
+    gpio_put(Pins::OLED_CS, 0);
+    write_commands(INIT_COMMANDS, sizeof(INIT_COMMANDS));
+
+    dma_channel = dma_claim_unused_channel(true);
+    dma_channel_config config = dma_channel_get_default_config(dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, spi_get_dreq(spi1, true));
+    dma_channel_configure(dma_channel, &config, &spi_get_hw(spi1)->dr, buffer.data(), WIDTH, false);
+    dma_channel_set_irq1_enabled(dma_channel, true);
+    irq_set_exclusive_handler(DMA_IRQ_1, on_dma_irq);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    flush();
+    return true;
+}
+
+void Oled::clear() {
+    fill_rect(0, 0, WIDTH, HEIGHT, false);
+}
+
+void Oled::put(size_t index, uint8_t value) {
+    if (buffer[index] == value) return;
+    buffer[index] = value;
+    dirty |= 1 << (index / WIDTH);
+}
+
+void Oled::set_pixel(int x, int y, bool on) {
+    if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) return;
+    size_t index = (y / 8) * WIDTH + x;
+    uint8_t bit = 1 << (y % 8);
+    put(index, on ? (buffer[index] | bit) : (buffer[index] & ~bit));
+}
+
+bool Oled::get_pixel(int x, int y) {
+    if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) return false;
+    return buffer[(y / 8) * WIDTH + x] & (1 << (y % 8));
+}
+
+void Oled::fill_rect(int x, int y, int width, int height, bool on) {
+    for (int row = y; row < y + height; row++) {
+        for (int col = x; col < x + width; col++) {
+            set_pixel(col, row, on);
+        }
+    }
+}
+
+void Oled::draw_rect(int x, int y, int width, int height) {
+    fill_rect(x, y, width, 1);
+    fill_rect(x, y + height - 1, width, 1);
+    fill_rect(x, y, 1, height);
+    fill_rect(x + width - 1, y, 1, height);
+}
+
+void Oled::draw_line(int x0, int y0, int x1, int y1) {
+    // Bresenham
+    int dx = (x1 > x0) ? x1 - x0 : x0 - x1;
+    int dy = (y1 > y0) ? y0 - y1 : y1 - y0;
+    int step_x = (x0 < x1) ? 1 : -1;
+    int step_y = (y0 < y1) ? 1 : -1;
+    int error = dx + dy;
+    while (true) {
+        set_pixel(x0, y0);
+        if (x0 == x1 && y0 == y1) break;
+        int twice = 2 * error;
+        if (twice >= dy) {
+            error += dy;
+            x0 += step_x;
+        }
+        if (twice <= dx) {
+            error += dx;
+            y0 += step_y;
+        }
+    }
+}
+
+void Oled::draw_char(int x, int y, char c) {
+    uint8_t code = static_cast<uint8_t>(c);
+    if (code < FONT_FIRST || code >= FONT_FIRST + FONT_5X7.size() / FONT_WIDTH) code = '?';
+    const uint8_t* columns = &FONT_5X7[(code - FONT_FIRST) * FONT_WIDTH];
+
+    // One blank column after the glyph, so text can be redrawn in place
+    for (int col = 0; col <= FONT_WIDTH; col++) {
+        uint8_t bits = (col < FONT_WIDTH) ? columns[col] : 0;
+        for (int row = 0; row < 8; row++) {
+            set_pixel(x + col, y + row, bits & (1 << row));
+        }
+    }
+}
+
+void Oled::draw_text(int x, int y, std::string_view text) {
+    for (char c : text) {
+        draw_char(x, y, c);
+        x += FONT_WIDTH + 1;
+    }
+}
+
+void Oled::flush() {
+    if (!connected) {
+        // Host build: count the pages that would have gone out
+        for (uint8_t page = 0; page < PAGES; page++) {
+            if (dirty & (1 << page)) pages_sent++;
+        }
+        dirty = 0;
+        return;
+    }
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    bool start = !sending && dirty != 0;
+    if (start) sending = true;
+    restore_interrupts(irq_state);
+
+    if (start) start_next_page();
+}
+
+void Oled::write_commands(const uint8_t* commands, size_t length) {
+    gpio_put(Pins::OLED_DC, 0);
+    spi_write_blocking(spi1, commands, length);
+    gpio_put(Pins::OLED_DC, 1);
+}
+
+bool Oled::start_next_page() {
+    if (dirty == 0) {
+        sending = false;
+        return false;
+    }
+
+    uint8_t page = 0;
+    while (!(dirty & (1 << page))) page++;
+    dirty &= ~(1 << page);  // Set again if it's drawn on while going out
+    page_sending = page;
+
+    uint8_t column = (controller == Controller::SH1106) ? 2 : 0;
+    const uint8_t address[] = {
+        static_cast<uint8_t>(0xB0 | page),
+        static_cast<uint8_t>(column & 0x0F),
+        static_cast<uint8_t>(0x10 | (column >> 4))
+    };
+    write_commands(address, sizeof(address));
+    dma_channel_transfer_from_buffer_now(dma_channel, &buffer[page * WIDTH], WIDTH);
+    return true;
+}
+
+void Oled::on_dma_irq() {
+    dma_channel_acknowledge_irq1(dma_channel);
+    pages_sent++;
+
+    // DMA is done when the last byte is in the FIFO, D/C must wait for
+    // it to shift out (a few us at 10 MHz)
+    while (spi_is_busy(spi1)) {
+    }
+    start_next_page();
+}
+
+void Oled::write_pgm(std::FILE* out) {
+    std::fprintf(out, "P5\n%d %d\n255\n", WIDTH, HEIGHT);
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            std::fputc(get_pixel(x, y) ? 255 : 0, out);
+        }
+    }
+}
+
+} // namespace hardware
+} // namespace pg1000
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <array>
+#include <string_view>
+
+namespace pg1000 {
+namespace hardware {
+
+// 128x64 SSD1306/SH1106 OLED on SPI1.
+//
+// Drawing only changes the 1 KB framebuffer and marks the pages (8 pixel
+// rows) whose bytes changed. flush() hands the dirty pages to a DMA
+// channel one after another; the DMA interrupt sets up the next page, so
+// the transfer costs no main loop time. Without a bus (the host back end)
+// the framebuffer can be dumped as a PGM image instead.
+class Oled {
+public:
+    static constexpr uint8_t WIDTH = 128;
+    static constexpr uint8_t HEIGHT = 64;
+    static constexpr uint8_t PAGES = HEIGHT / 8;
+    static constexpr size_t BUFFER_SIZE = WIDTH * PAGES;
+
+    enum class Controller : uint8_t {
+        SSD1306,
+        SH1106     // 132 column RAM, the panel starts at column 2
+    };
+
+    // connected = false keeps everything in RAM, for host tests
+    static bool init(Controller controller, bool connected = true);
+
+    // Drawing
+    static void clear();
+    static void set_pixel(int x, int y, bool on = true);
+    static void fill_rect(int x, int y, int width, int height, bool on = true);
+    static void draw_rect(int x, int y, int width, int height);
+    static void draw_line(int x0, int y0, int x1, int y1);
+    static void draw_char(int x, int y, char c);   // 5x7, top left at x, y
+    static void draw_text(int x, int y, std::string_view text);  // 6 pixels per character
+
+    // Start sending the dirty pages, returns straight away
+    static void flush();
+    static bool is_busy() { return sending; }
+    static uint8_t get_dirty_pages() { return dirty; }
+    static uint32_t get_pages_sent() { return pages_sent; }
+
+    static const uint8_t* get_buffer() { return buffer.data(); }
+    static bool get_pixel(int x, int y);
+    static void write_pgm(std::FILE* out);  // Binary PGM, 0 or 255 per pixel
+
+private:
+    static constexpr uint8_t SPI_PORT = 1;
+    static constexpr uint32_t SPI_FREQUENCY = 10'000'000;
+
+    static std::array<uint8_t, BUFFER_SIZE> buffer;
+    static volatile uint8_t dirty;    // Bit per page
+    static volatile bool sending;
+    static uint8_t page_sending;
+    static uint32_t pages_sent;
+    static Controller controller;
+    static bool connected;
+    static int dma_channel;
+
+    static void put(size_t index, uint8_t value);  // Marks the page dirty if the byte changes
+    static void write_commands(const uint8_t* commands, size_t length);
+    static bool start_next_page();
+    static void on_dma_irq();
+};
+
+} // namespace hardware
+} // namespace pg1000
@@ -7,6 +7,10 @@
 #include "midi/midi.h"
 #include "parameters/parameters.h"
 #include "parameters/common_selector.h"
+#include "parameters/partial_selector.h"
+#include "parameters/patch_library.h"
+#include "parameters/patch_morph.h"
+#include "parameters/macro_pots.h"
 #include "ui/interface.h"
 
 using namespace pg1000;
@@ -28,11 +32,17 @@ int main() {
     if (!midi::MIDI::init()) {
         printf("MIDI initialization failed\n");
         hardware::Display::show_message("Error:", "MIDI Init Failed");
+        hardware::Display::flush();
         return -1;
     }
 
+    // Load the patch library index from flash
+    parameters::PatchLibrary::init();
+
     // Initialize Common Parameter Selection
     parameters::CommonSelector::init();  // Add this
+    parameters::PartialSelector::init();
+    parameters::MacroPots::init();
 
     // Initialize UI
     if (!ui::Interface::init()) {
@@ -48,8 +58,20 @@ int main() {
         hardware::ADC::read_all();      // Read all potentiometers
         hardware::GPIO::update();        // Update button states and LEDs
         
-        // Update parameter selection
-        parameters::CommonSelector::update();  // Add this - after GPIO update but before UI update
+        // Update parameter selection. Outside NORMAL mode the UI uses the
+        // selector buttons to navigate.
+        if (ui::Interface::get_current_mode() == ui::Mode::NORMAL) {
+            parameters::CommonSelector::update();
+            parameters::PartialSelector::update();
+        }
+
+        // Morph pot, queues changes for the next MIDI flush
+        parameters::PatchMorph::update();
+
+        // Macro pots, everything one scan changed goes out as one burst
+        if (parameters::MacroPots::update()) {
+            midi::MIDI::send_dirty();
+        }
 
         // Update UI
         ui::Interface::update();         // Handle UI logic
@@ -0,0 +1,57 @@
+#include "address_map.h"
+#include "../parameters/parameter_table.h"
+#include <array>
+
+namespace pg1000 {
+namespace midi {
+
+static_assert(PARAMETERS.size() < AddressMap::UNMAPPED, "Parameter index doesn't fit a slot");
+
+static constexpr std::array<uint8_t, EDIT_BUFFER_SIZE> build_slots() {
+    std::array<uint8_t, EDIT_BUFFER_SIZE> slots = {};
+    for (auto& slot : slots) {
+        slot = AddressMap::UNMAPPED;
+    }
+    // The table describes Upper Partial 1, its partial parameters sit at
+    // the same offset in every partial block
+    constexpr ParamGroup partials[] = {
+        ParamGroup::UPPER_PARTIAL_1, ParamGroup::UPPER_PARTIAL_2,
+        ParamGroup::LOWER_PARTIAL_1, ParamGroup::LOWER_PARTIAL_2
+    };
+    for (size_t i = 0; i < PARAMETERS.size(); i++) {
+        if (!is_partial_group(PARAMETERS[i].group)) {
+            slots[get_edit_address(PARAMETERS[i])] = static_cast<uint8_t>(i);
+            continue;
+        }
+        for (ParamGroup partial : partials) {
+            slots[get_group_base(partial) + PARAMETERS[i].offset] = static_cast<uint8_t>(i);
+        }
+    }
+    return slots;
+}
+
+static constexpr std::array<uint8_t, EDIT_BUFFER_SIZE> SLOTS = build_slots();
+
+static_assert(SLOTS[get_group_base(ParamGroup::LOWER_PARTIAL_2) + PARAMETERS[0].offset] == 0,
+              "Partial parameters are mapped in every partial block");
+
+uint8_t AddressMap::get_slot(uint16_t address) {
+    return (address < SLOTS.size()) ? SLOTS[address] : UNMAPPED;
+}
+
+const Parameter* AddressMap::get_parameter(uint16_t address) {
+    uint8_t slot = get_slot(address);
+    return (slot != UNMAPPED) ? pg1000::get_parameter(slot) : nullptr;
+}
+
+void AddressMap::apply(uint16_t address, size_t length) {
+    for (size_t i = 0; i < length && address + i < SLOTS.size(); i++) {
+        uint8_t slot = SLOTS[address + i];
+        if (slot != UNMAPPED) {
+            sync_parameter_filter(slot, address + i);
+        }
+    }
+}
+
+} // namespace midi
+} // namespace pg1000
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "../parameters/parameters.h"
+
+namespace pg1000 {
+namespace midi {
+
+// Reverse lookup from linear edit buffer address to parameter slot, so
+// incoming DT1 data is matched to parameters in O(1) per byte instead of
+// scanning the parameter table. The table is built at compile time.
+class AddressMap {
+public:
+    static constexpr uint8_t UNMAPPED = 0xFF;
+
+    // Parameter index for an address, or UNMAPPED. Each of the four
+    // partial blocks maps to the table's partial parameters.
+    static uint8_t get_slot(uint16_t address);
+    static const Parameter* get_parameter(uint16_t address);
+
+    // A run of bytes from the synth has landed in the edit buffer, pot
+    // filters reading from any of them pick up the new values
+    static void apply(uint16_t address, size_t length);
+};
+
+} // namespace midi
+} // namespace pg1000
@@ -0,0 +1,137 @@
+#include "bulk_dump.h"
+#include "address_map.h"
+#include "midi.h"
+#include "../parameters/edit_history.h"
+#include "../parameters/patch_compare.h"
+#include "../parameters/patch_morph.h"
+#include "pico/time.h"
+#include <cstdio>
+
+namespace pg1000 {
+namespace midi {
+
+// Static member initialization
+std::array<uint8_t, (BulkDump::IMAGE_SIZE + 7) / 8> BulkDump::received = {};
+uint16_t BulkDump::received_count = 0;
+BulkDumpState BulkDump::state = BulkDumpState::IDLE;
+bool BulkDump::completed = false;
+uint32_t BulkDump::start_time = 0;
+uint32_t BulkDump::elapsed_us = 0;
+uint32_t BulkDump::last_packet_time = 0;
+uint8_t BulkDump::retries = 0;
+uint32_t BulkDump::bad_packets = 0;
+std::array<uint8_t, SysExConst::MAX_PACKET_DATA> BulkDump::packet;
+uint32_t BulkDump::packet_start = 0;
+uint16_t BulkDump::packet_length = 0;
+bool BulkDump::packet_overflow = false;
+
+void BulkDump::begin() {
+    received.fill(0);
+    received_count = 0;
+    completed = false;
+    elapsed_us = 0;
+    retries = 0;
+    start_time = time_us_32();
+    last_packet_time = start_time;
+    state = BulkDumpState::RECEIVING;
+}
+
+void BulkDump::update() {
+    if (state != BulkDumpState::RECEIVING) return;
+    if (time_us_32() - last_packet_time <= QUIET_US) return;
+
+    if (retries == MAX_RETRIES) {
+        state = BulkDumpState::FAILED;
+        printf("Bulk sync failed (%d/%d bytes)\n", received_count, IMAGE_SIZE);
+        return;
+    }
+    retries++;
+    last_packet_time = time_us_32();
+    request_missing();
+}
+
+void BulkDump::begin_packet(uint32_t address) {
+    packet_start = address;
+    packet_length = 0;
+    packet_overflow = false;
+}
+
+void BulkDump::write_byte(uint8_t value) {
+    if (packet_length < packet.size()) {
+        packet[packet_length++] = value;
+    } else {
+        packet_overflow = true;
+    }
+}
+
+void BulkDump::end_packet(bool checksum_ok) {
+    uint32_t end = packet_start + packet_length;
+    if (end > IMAGE_SIZE) end = IMAGE_SIZE;
+    if (packet_start >= end) return;  // Packet outside the edit buffer
+
+    if (!checksum_ok || packet_overflow) {
+        // Nothing was stored, a sync asks for the range again once quiet
+        bad_packets++;
+        printf("DT1 dropped, bad packet at %lu\n", static_cast<unsigned long>(packet_start));
+        return;
+    }
+
+    for (uint32_t address = packet_start; address < end; address++) {
+        parameters::EditBuffer::store(address, packet[address - packet_start]);
+    }
+
+    if (state != BulkDumpState::RECEIVING) {
+        // Edit echo from the synth, outside of a sync
+        AddressMap::apply(packet_start, end - packet_start);
+        return;
+    }
+
+    last_packet_time = time_us_32();
+    mark_received(packet_start, end);
+
+    if (received_count == IMAGE_SIZE) {
+        AddressMap::apply(0, IMAGE_SIZE);  // One pass over the whole image
+        parameters::EditHistory::clear();  // Old values belong to another patch
+        parameters::PatchCompare::capture();
+        parameters::PatchMorph::stop();
+        elapsed_us = time_us_32() - start_time;
+        state = BulkDumpState::COMPLETE;
+        completed = true;
+        printf("Bulk sync complete in %lu us\n", static_cast<unsigned long>(elapsed_us));
+    }
+}
+
+void BulkDump::request_missing() {
+    // First to last missing byte, anything received in between comes again
+    uint32_t first = IMAGE_SIZE;
+    uint32_t last = 0;
+    for (uint32_t addr = 0; addr < IMAGE_SIZE; addr++) {
+        if (received[addr >> 3] & (1 << (addr & 0x07))) continue;
+        if (first == IMAGE_SIZE) first = addr;
+        last = addr;
+    }
+    if (first == IMAGE_SIZE) return;
+
+    printf("Bulk sync retry %d, %lu-%lu\n", retries, static_cast<unsigned long>(first),
+           static_cast<unsigned long>(last));
+    MIDI::send_request(SysExCommand::RQ1, first, last - first + 1);
+}
+
+bool BulkDump::take_completed() {
+    bool result = completed;
+    completed = false;
+    return result;
+}
+
+void BulkDump::mark_received(uint32_t start, uint32_t end) {
+    for (uint32_t addr = start; addr < end; addr++) {
+        uint8_t mask = 1 << (addr & 0x07);
+        if (!(received[addr >> 3] & mask)) {
+            received[addr >> 3] |= mask;
+            received_count++;
+        }
+    }
+}
+
+} // namespace midi
+} // namespace pg1000
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include "sysex.h"
+#include "../parameters/edit_buffer.h"
+
+namespace pg1000 {
+namespace midi {
+
+// Bulk sync progress
+enum class BulkDumpState {
+    IDLE,       // No sync requested
+    RECEIVING,  // Full request sent, waiting for DT1 packets
+    COMPLETE,   // Every byte of the edit buffer received
+    FAILED      // Still incomplete after MAX_RETRIES re-requests
+};
+
+// Bulk sync of the D-50 edit buffer [00-00-00] - [00-03-24].
+// DT1 data is staged one packet at a time and only goes into EditBuffer
+// once the checksum has checked out. If the dump goes quiet with bytes
+// still missing, e.g. after a bad packet, the missing range is requested
+// again.
+class BulkDump {
+public:
+    static constexpr uint16_t IMAGE_SIZE = parameters::EditBuffer::SIZE;
+    static constexpr uint32_t QUIET_US = 200'000;  // No packet for this long, ask again for what's missing
+    static constexpr uint8_t MAX_RETRIES = 3;
+
+    // Start a sync (called when the full RQ1 request goes out)
+    static void begin();
+
+    // Re-requests and timeout, call from the main loop
+    static void update();
+
+    // Streaming DT1 sink
+    static void begin_packet(uint32_t address);
+    static void write_byte(uint8_t value);
+    static void end_packet(bool checksum_ok);
+
+    // Status
+    static BulkDumpState get_state() { return state; }
+    static bool take_completed();  // True once per finished sync
+    static uint16_t get_received_count() { return received_count; }
+    static uint32_t get_elapsed_us() { return elapsed_us; }
+    static uint8_t get_retries() { return retries; }
+    static uint32_t get_bad_packets() { return bad_packets; }  // Since start-up
+
+private:
+    static std::array<uint8_t, (IMAGE_SIZE + 7) / 8> received;  // One bit per address
+    static uint16_t received_count;
+    static BulkDumpState state;
+    static bool completed;
+    static uint32_t start_time;
+    static uint32_t elapsed_us;
+    static uint32_t last_packet_time;
+    static uint8_t retries;
+    static uint32_t bad_packets;
+
+    // Current packet, held until its checksum is known
+    static std::array<uint8_t, SysExConst::MAX_PACKET_DATA> packet;
+    static uint32_t packet_start;
+    static uint16_t packet_length;
+    static bool packet_overflow;
+
+    static void mark_received(uint32_t start, uint32_t end);
+    static void request_missing();
+};
+
+} // namespace midi
+} // namespace pg1000
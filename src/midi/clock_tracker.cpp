@@ -0,0 +1,138 @@
+#include "clock_tracker.h"
+#include <cstdio>
+
+namespace pg1000 {
+namespace midi {
+
+// Static member initialization
+uint32_t ClockTracker::interval_q4 = 0;
+uint32_t ClockTracker::last_clock_time = 0;
+uint8_t ClockTracker::outliers = 0;
+bool ClockTracker::clock_present = false;
+bool ClockTracker::restarted = false;
+uint8_t ClockTracker::clock_in_beat = 0;
+uint32_t ClockTracker::beat_count = 0;
+Transport ClockTracker::transport = Transport::STOPPED;
+bool ClockTracker::sensing_seen = false;
+uint32_t ClockTracker::last_sensing_time = 0;
+bool ClockTracker::link_up = true;
+bool ClockTracker::link_restored = false;
+
+void ClockTracker::on_clock(uint32_t timestamp) {
+    if (clock_present && !restarted) {
+        track_interval(timestamp - last_clock_time);
+    }
+    last_clock_time = timestamp;
+    clock_present = true;
+    restarted = false;
+
+    if (transport == Transport::RUNNING) {
+        if (++clock_in_beat >= PPQN) {
+            clock_in_beat = 0;
+            beat_count++;
+        }
+    }
+}
+
+void ClockTracker::on_start(uint32_t timestamp) {
+    // The first clock after START is the downbeat. The sequencer restarts
+    // its clock grid from START, so phase counts from there, one clock
+    // before the downbeat, rather than from the last clock while stopped.
+    transport = Transport::RUNNING;
+    clock_in_beat = PPQN - 1;
+    beat_count = static_cast<uint32_t>(-1);
+    last_clock_time = timestamp;
+    restarted = true;
+}
+
+void ClockTracker::on_continue() {
+    transport = Transport::RUNNING;
+}
+
+void ClockTracker::on_stop() {
+    transport = Transport::STOPPED;
+}
+
+void ClockTracker::on_active_sensing(uint32_t timestamp) {
+    sensing_seen = true;
+    last_sensing_time = timestamp;
+}
+
+void ClockTracker::update(uint32_t now, uint32_t last_rx) {
+    if (clock_present && now - last_clock_time > CLOCK_TIMEOUT_US) {
+        clock_present = false;
+        interval_q4 = 0;
+        outliers = 0;
+    }
+
+    if (!sensing_seen) return;
+
+    // Any byte counts as a sign of life, not only active sensing
+    uint32_t last_alive = (static_cast<int32_t>(last_sensing_time - last_rx) > 0) ? last_sensing_time : last_rx;
+    bool alive = (now - last_alive) <= SENSING_TIMEOUT_US;
+    if (alive != link_up) {
+        link_up = alive;
+        link_restored = alive;
+        printf("MIDI link %s\n", alive ? "restored" : "lost");
+    }
+}
+
+uint16_t ClockTracker::get_bpm_x100() {
+    if (!clock_present || interval_q4 == 0) return 0;
+
+    // 60s / 24 clocks * 100, with the interval in 1/16 us
+    return static_cast<uint16_t>(4'000'000'000u / interval_q4);
+}
+
+uint16_t ClockTracker::get_beat_phase(uint32_t now) {
+    if (!clock_present || interval_q4 == 0) return 0;
+
+    // Interpolate between clocks, never past the next one
+    uint64_t elapsed_q4 = static_cast<uint64_t>(now - last_clock_time) << INTERVAL_SHIFT;
+    uint32_t fraction = static_cast<uint32_t>((elapsed_q4 << 16) / interval_q4);
+    if (fraction > 0xFFFF) fraction = 0xFFFF;
+
+    uint32_t phase = ((static_cast<uint32_t>(clock_in_beat) << 16) + fraction) / PPQN;
+    return static_cast<uint16_t>(phase);
+}
+
+uint32_t ClockTracker::get_next_division_time(uint8_t division) {
+    if (!clock_present || interval_q4 == 0 || division == 0) return last_clock_time;
+
+    uint8_t clocks_ahead = division - (clock_in_beat % division);
+    return last_clock_time + ((interval_q4 * clocks_ahead) >> INTERVAL_SHIFT);
+}
+
+bool ClockTracker::take_link_restored() {
+    bool result = link_restored;
+    link_restored = false;
+    return result;
+}
+
+void ClockTracker::track_interval(uint32_t interval_us) {
+    uint32_t sample_q4 = interval_us << INTERVAL_SHIFT;
+
+    if (interval_q4 == 0) {
+        interval_q4 = sample_q4;
+        return;
+    }
+
+    // Reject intervals more than 25% away from the estimate, unless they
+    // keep coming, in which case the tempo really changed
+    uint32_t diff = (sample_q4 > interval_q4) ? sample_q4 - interval_q4 : interval_q4 - sample_q4;
+    if (diff > (interval_q4 >> 2)) {
+        if (++outliers >= RELOCK_COUNT) {
+            interval_q4 = sample_q4;
+            outliers = 0;
+        }
+        return;
+    }
+    outliers = 0;
+
+    // Exponential moving average
+    int32_t error = static_cast<int32_t>(sample_q4) - static_cast<int32_t>(interval_q4);
+    interval_q4 = static_cast<uint32_t>(static_cast<int32_t>(interval_q4) + (error >> FILTER_SHIFT));
+}
+
+} // namespace midi
+} // namespace pg1000
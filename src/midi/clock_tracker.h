@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+
+namespace pg1000 {
+namespace midi {
+
+enum class Transport {
+    STOPPED,
+    RUNNING
+};
+
+// Tempo, beat phase and transport from incoming MIDI clock, plus the
+// active sensing watchdog. Timestamps are taken in the UART interrupt, so
+// main loop latency doesn't show up as clock jitter.
+class ClockTracker {
+public:
+    static constexpr uint8_t PPQN = 24;                       // MIDI clocks per beat
+    static constexpr uint32_t SENSING_TIMEOUT_US = 300'000;   // Link down after 300ms of silence
+    static constexpr uint32_t CLOCK_TIMEOUT_US = 250'000;     // Slower than 10 BPM means no clock
+    static constexpr uint8_t RELOCK_COUNT = 4;                // Consecutive outliers before accepting a new tempo
+
+    // Realtime messages, with the reception timestamp where it matters
+    static void on_clock(uint32_t timestamp);
+    static void on_start(uint32_t timestamp);
+    static void on_continue();
+    static void on_stop();
+    static void on_active_sensing(uint32_t timestamp);
+
+    // Watchdog, last_rx is the timestamp of the most recent byte of any kind
+    static void update(uint32_t now, uint32_t last_rx);
+
+    // Tempo
+    static bool has_clock() { return clock_present; }
+    static uint16_t get_bpm_x100();                  // 12000 = 120.00 BPM, 0 without clock
+    static uint16_t get_beat_phase(uint32_t now);    // 0-65535 through the current beat
+    static uint32_t get_beat_count() { return beat_count; }
+    static Transport get_transport() { return transport; }
+
+    // Predicted time of the next clock on a multiple of division clocks
+    // (6 = sixteenth note, 24 = beat)
+    static uint32_t get_next_division_time(uint8_t division);
+
+    // Active sensing, the link counts as up until sensing has been seen
+    static bool is_link_up() { return link_up; }
+    static bool take_link_restored();  // True once when the synth comes back
+
+private:
+    // Fixed point clock interval, microseconds * 16
+    static constexpr uint8_t INTERVAL_SHIFT = 4;
+    static constexpr uint8_t FILTER_SHIFT = 3;  // Moving average weight 1/8
+
+    static uint32_t interval_q4;
+    static uint32_t last_clock_time;
+    static uint8_t outliers;
+    static bool clock_present;
+    static bool restarted;  // START since the last clock, its interval isn't a clock interval
+
+    static uint8_t clock_in_beat;
+    static uint32_t beat_count;
+    static Transport transport;
+
+    static bool sensing_seen;
+    static uint32_t last_sensing_time;
+    static bool link_up;
+    static bool link_restored;
+
+    static void track_interval(uint32_t interval_us);
+};
+
+} // namespace midi
+} // namespace pg1000
@@ -0,0 +1,224 @@
+#include "d50_responder.h"
+#include "midi.h"
+
+namespace pg1000 {
+namespace midi {
+
+// Static member initialization
+std::vector<uint8_t> D50Responder::message;
+bool D50Responder::in_message = false;
+std::array<uint8_t, SysExConst::FULL_REQUEST_SIZE> D50Responder::edit_buffer = {};
+D50Responder::Phase D50Responder::phase = D50Responder::Phase::IDLE;
+uint32_t D50Responder::out_address = 0;
+uint32_t D50Responder::out_remaining = 0;
+uint16_t D50Responder::out_length = 0;
+uint8_t D50Responder::error_interval = 0;
+uint8_t D50Responder::packet_count = 0;
+uint32_t D50Responder::bytes_written = 0;
+uint32_t D50Responder::write_sum = 0;
+uint32_t D50Responder::errors_injected = 0;
+uint16_t D50Responder::reject_after = 0;
+uint16_t D50Responder::dat_count = 0;
+
+void D50Responder::receive(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        uint8_t byte = data[i];
+
+        if (byte == SysExConst::STATUS) {
+            message.clear();
+            in_message = true;
+        }
+        if (!in_message) continue;
+
+        message.push_back(byte);
+        if (byte == SysExConst::EOX) {
+            in_message = false;
+            handle_message();
+        } else if (message.size() > SysExConst::MAX_PACKET_DATA + SysExConst::DATA_OVERHEAD) {
+            in_message = false;
+        }
+    }
+}
+
+void D50Responder::update() {
+    switch (phase) {
+        case Phase::ONE_WAY:
+            if (send_packet(SysExCommand::DT1)) {
+                out_address += out_length;
+                out_remaining -= out_length;
+                if (out_remaining == 0) phase = Phase::IDLE;
+            }
+            break;
+
+        case Phase::SEND_DAT:
+            if (send_packet(SysExCommand::DAT)) {
+                phase = Phase::WAIT_ACK;
+            }
+            break;
+
+        case Phase::SEND_EOD:
+            reply(SysExCommand::EOD);
+            phase = Phase::WAIT_EOD_ACK;
+            break;
+
+        default:
+            break;
+    }
+}
+
+void D50Responder::reset() {
+    message.clear();
+    in_message = false;
+    edit_buffer.fill(0);
+    phase = Phase::IDLE;
+    packet_count = 0;
+    bytes_written = 0;
+    write_sum = 0;
+    errors_injected = 0;
+    dat_count = 0;
+}
+
+uint8_t D50Responder::read(uint32_t address) {
+    if (address < edit_buffer.size()) {
+        return edit_buffer[address];
+    }
+    return static_cast<uint8_t>((address * 37 + (address >> 7)) & 0x7F);
+}
+
+void D50Responder::handle_message() {
+    if (message.size() < SysExConst::SHORT_MESSAGE_SIZE ||
+        message[1] != SysExConst::ROLAND_ID ||
+        message[3] != SysExConst::D50_ID) return;
+
+    SysExCommand cmd = static_cast<SysExCommand>(message[4]);
+
+    if (message.size() == SysExConst::SHORT_MESSAGE_SIZE) {
+        switch (cmd) {
+            case SysExCommand::ACK:
+                if (phase == Phase::WAIT_ACK) {
+                    if (reject()) break;
+                    out_address += out_length;
+                    out_remaining -= out_length;
+                    phase = out_remaining ? Phase::SEND_DAT : Phase::SEND_EOD;
+                } else if (phase == Phase::WAIT_EOD_ACK) {
+                    phase = Phase::IDLE;
+                }
+                break;
+            case SysExCommand::ERR:
+                if (phase == Phase::WAIT_ACK) phase = Phase::SEND_DAT;  // Same packet again
+                break;
+            case SysExCommand::EOD:
+                if (phase == Phase::RECEIVING) {
+                    reply(SysExCommand::ACK);
+                    phase = Phase::IDLE;
+                }
+                break;
+            case SysExCommand::RJC:
+                phase = Phase::IDLE;
+                break;
+            default:
+                break;
+        }
+        return;
+    }
+
+    if (message.size() < 11) return;
+    bool checksum_ok = SysEx::calculate_checksum(message) == message[message.size() - 2];
+    uint32_t address = SysExAddress(message[5], message[6], message[7]).to_linear();
+    uint32_t size = SysExAddress(message[8], message[9], message[10]).to_linear();
+
+    switch (cmd) {
+        case SysExCommand::RQ1:
+            if (!checksum_ok) return;
+            out_address = address;
+            out_remaining = size;
+            phase = size ? Phase::ONE_WAY : Phase::IDLE;
+            break;
+
+        case SysExCommand::RQD:
+            if (!checksum_ok) return;
+            out_address = address;
+            out_remaining = size;
+            phase = size ? Phase::SEND_DAT : Phase::SEND_EOD;
+            break;
+
+        case SysExCommand::WSD:
+            if (!checksum_ok) return;
+            reply(SysExCommand::ACK);
+            phase = Phase::RECEIVING;
+            break;
+
+        case SysExCommand::DT1:
+        case SysExCommand::DAT: {
+            bool is_dat = (cmd == SysExCommand::DAT);
+            if (!checksum_ok || (is_dat && inject_error())) {
+                if (is_dat) reply(SysExCommand::ERR);
+                return;
+            }
+            if (is_dat && reject()) return;
+            for (size_t i = 8; i < message.size() - 2; i++) {
+                write(address++, message[i]);
+            }
+            if (is_dat) reply(SysExCommand::ACK);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void D50Responder::write(uint32_t address, uint8_t value) {
+    if (address < edit_buffer.size()) {
+        edit_buffer[address] = value;
+        return;
+    }
+    bytes_written++;
+    write_sum += value;
+}
+
+bool D50Responder::send_packet(SysExCommand cmd) {
+    out_length = (out_remaining < SysExConst::MAX_PACKET_DATA) ? out_remaining : SysExConst::MAX_PACKET_DATA;
+    if (MIDI::get_rx_free() < static_cast<size_t>(out_length + SysExConst::DATA_OVERHEAD)) return false;
+
+    std::array<uint8_t, SysExConst::MAX_PACKET_DATA> data;
+    for (uint16_t i = 0; i < out_length; i++) {
+        data[i] = read(out_address + i);
+    }
+
+    std::vector<uint8_t> msg = SysEx::create_data(cmd, out_address, data.data(), out_length);
+    if (cmd == SysExCommand::DAT && inject_error()) {
+        msg[msg.size() - 2] ^= 0x01;  // Break the checksum
+    }
+
+    MIDI::loopback_receive(msg.data(), msg.size());
+    return true;
+}
+
+void D50Responder::reply(SysExCommand cmd) {
+    std::vector<uint8_t> msg = SysEx::create_handshake(cmd);
+    MIDI::loopback_receive(msg.data(), msg.size());
+}
+
+bool D50Responder::inject_error() {
+    if (error_interval == 0) return false;
+
+    if (++packet_count >= error_interval) {
+        packet_count = 0;
+        errors_injected++;
+        return true;
+    }
+    return false;
+}
+
+bool D50Responder::reject() {
+    if (reject_after == 0 || ++dat_count < reject_after) return false;
+
+    dat_count = 0;
+    reply(SysExCommand::RJC);
+    phase = Phase::IDLE;
+    return true;
+}
+
+} // namespace midi
+} // namespace pg1000
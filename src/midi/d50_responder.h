@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include "sysex.h"
+
+namespace pg1000 {
+namespace midi {
+
+// Local stand-in for the D-50 side of the SysEx link, for exercising the
+// transfer engines without the synth. With MIDI::set_loopback(true) every
+// byte the controller sends comes here, and the replies are fed back into
+// the MIDI receive ring.
+//
+// Answers RQ1 with one-way DT1 packets, accepts DT1, and runs the
+// handshake protocol in both directions. The edit buffer is held in RAM;
+// the rest of the address space reads back a fixed pattern (see read())
+// and writes to it are only counted, so a whole bank costs no memory.
+class D50Responder {
+public:
+    // Bytes sent by the controller
+    static void receive(const uint8_t* data, size_t length);
+
+    // Send queued packets while the receive ring has room
+    static void update();
+
+    static void reset();
+
+    // Fault injection: corrupt every nth DAT sent and answer every nth DAT
+    // received with ERR (0 = off)
+    static void set_error_interval(uint8_t interval) { error_interval = interval; }
+
+    // Answer with RJC once this many DATs have gone through either way, as
+    // the synth does when it runs out of memory or is stopped (0 = off)
+    static void set_reject_after(uint16_t packets) { reject_after = packets; }
+
+    // A transfer is under way
+    static bool is_busy() { return phase != Phase::IDLE; }
+
+    // Memory model
+    static uint8_t read(uint32_t address);
+
+    // Statistics
+    static uint32_t get_bytes_written() { return bytes_written; }
+    static uint32_t get_write_sum() { return write_sum; }  // Sum of bytes written outside the edit buffer
+    static uint32_t get_errors_injected() { return errors_injected; }
+
+private:
+    enum class Phase {
+        IDLE,
+        ONE_WAY,       // Answering RQ1 with DT1 packets
+        SEND_DAT,      // Next DAT due
+        WAIT_ACK,      // DAT sent
+        SEND_EOD,
+        WAIT_EOD_ACK,
+        RECEIVING      // Accepted a WSD
+    };
+
+    static std::vector<uint8_t> message;
+    static bool in_message;
+    static std::array<uint8_t, SysExConst::FULL_REQUEST_SIZE> edit_buffer;
+
+    static Phase phase;
+    static uint32_t out_address;
+    static uint32_t out_remaining;
+    static uint16_t out_length;  // Last DAT sent
+
+    static uint8_t error_interval;
+    static uint8_t packet_count;
+    static uint32_t bytes_written;
+    static uint32_t write_sum;
+    static uint32_t errors_injected;
+    static uint16_t reject_after;
+    static uint16_t dat_count;
+
+    static void handle_message();
+    static void write(uint32_t address, uint8_t value);
+    static bool send_packet(SysExCommand cmd);
+    static void reply(SysExCommand cmd);
+    static bool inject_error();
+    static bool reject();
+};
+
+} // namespace midi
+} // namespace pg1000
@@ -0,0 +1,247 @@
+#include "handshake.h"
+#include "midi.h"
+#include "pico/time.h"
+#include <cstdio>
+
+namespace pg1000 {
+namespace midi {
+
+// Static member initialization
+TransferState Handshake::state = TransferState::IDLE;
+bool Handshake::finished = false;
+uint32_t Handshake::base_address = 0;
+uint32_t Handshake::transfer_size = 0;
+uint32_t Handshake::bytes_done = 0;
+uint8_t* Handshake::rx_dest = nullptr;
+const uint8_t* Handshake::tx_src = nullptr;
+SysExCommand Handshake::last_sent = SysExCommand::ACK;
+uint16_t Handshake::packet_length = 0;
+uint32_t Handshake::packet_cursor = 0;
+bool Handshake::send_pending = false;
+uint8_t Handshake::retries = 0;
+uint32_t Handshake::total_retries = 0;
+uint32_t Handshake::last_activity = 0;
+
+bool Handshake::start_receive(uint32_t address, uint32_t size, uint8_t* dest) {
+    if (is_busy() || !dest || size == 0) return false;
+
+    state = TransferState::RECEIVING;
+    finished = false;
+    base_address = address;
+    transfer_size = size;
+    bytes_done = 0;
+    rx_dest = dest;
+    tx_src = nullptr;
+    retries = 0;
+
+    last_sent = SysExCommand::RQD;
+    transmit();
+    return true;
+}
+
+bool Handshake::start_send(uint32_t address, const uint8_t* src, uint32_t size) {
+    if (is_busy() || !src || size == 0) return false;
+
+    state = TransferState::SENDING;
+    finished = false;
+    base_address = address;
+    transfer_size = size;
+    bytes_done = 0;
+    rx_dest = nullptr;
+    tx_src = src;
+    retries = 0;
+
+    last_sent = SysExCommand::WSD;
+    transmit();
+    return true;
+}
+
+void Handshake::abort() {
+    if (!is_busy()) return;
+
+    // Tell the other side to stop
+    MIDI::send_handshake(SysExCommand::RJC);
+    finish(TransferState::FAILED);
+}
+
+bool Handshake::receive_patch(uint8_t patch, uint8_t* dest) {
+    if (patch >= PATCHES_PER_BANK) return false;
+    return start_receive(PATCH_MEMORY + patch * PATCH_STRIDE, PATCH_STRIDE, dest);
+}
+
+bool Handshake::send_patch(uint8_t patch, const uint8_t* src) {
+    if (patch >= PATCHES_PER_BANK) return false;
+    return start_send(PATCH_MEMORY + patch * PATCH_STRIDE, src, PATCH_STRIDE);
+}
+
+bool Handshake::receive_bank(uint8_t* dest) {
+    return start_receive(PATCH_MEMORY, BANK_SIZE, dest);
+}
+
+bool Handshake::send_bank(const uint8_t* src) {
+    return start_send(PATCH_MEMORY, src, BANK_SIZE);
+}
+
+void Handshake::update() {
+    if (!is_busy()) return;
+
+    if (send_pending) {
+        transmit();
+        return;
+    }
+
+    if (time_us_32() - last_activity > RESPONSE_TIMEOUT_US) {
+        retry();
+    }
+}
+
+void Handshake::on_command(SysExCommand cmd) {
+    if (!is_busy()) return;
+    last_activity = time_us_32();
+
+    if (cmd == SysExCommand::RJC) {
+        printf("Handshake rejected after %lu bytes\n", static_cast<unsigned long>(bytes_done));
+        finish(TransferState::FAILED);
+        return;
+    }
+
+    if (state == TransferState::RECEIVING) {
+        if (cmd == SysExCommand::EOD) {
+            send_reply(SysExCommand::ACK);
+            finish(bytes_done >= transfer_size ? TransferState::COMPLETE : TransferState::FAILED);
+        }
+        return;
+    }
+
+    // Sending
+    switch (cmd) {
+        case SysExCommand::ACK:
+            retries = 0;
+            if (last_sent == SysExCommand::EOD) {
+                finish(TransferState::COMPLETE);
+                return;
+            }
+            if (last_sent == SysExCommand::DAT) {
+                bytes_done += packet_length;
+            }
+            last_sent = (bytes_done < transfer_size) ? SysExCommand::DAT : SysExCommand::EOD;
+            transmit();
+            break;
+
+        case SysExCommand::ERR:
+            retry();  // Receiver wants the last packet again
+            break;
+
+        default:
+            break;
+    }
+}
+
+void Handshake::on_request(SysExCommand cmd, uint32_t address, uint32_t size) {
+    // Unsolicited transfers from the synth have nowhere to go
+    if (is_busy()) return;
+
+    printf("Rejected %s of %lu bytes at %06lx\n", (cmd == SysExCommand::WSD) ? "WSD" : "RQD",
+           static_cast<unsigned long>(size), static_cast<unsigned long>(address));
+    send_reply(SysExCommand::RJC);
+}
+
+void Handshake::begin_packet(uint32_t address) {
+    packet_cursor = address;
+}
+
+void Handshake::write_byte(uint8_t value) {
+    if (state == TransferState::RECEIVING &&
+        packet_cursor >= base_address &&
+        packet_cursor < base_address + transfer_size) {
+        rx_dest[packet_cursor - base_address] = value & 0x7F;
+    }
+    packet_cursor++;
+}
+
+void Handshake::end_packet(bool checksum_ok) {
+    if (state != TransferState::RECEIVING) return;
+    last_activity = time_us_32();
+
+    if (!checksum_ok) {
+        // Sender repeats the packet, overwriting what was streamed in
+        total_retries++;
+        send_reply(SysExCommand::ERR);
+        return;
+    }
+
+    uint32_t end = (packet_cursor > base_address) ? packet_cursor - base_address : 0;
+    if (end > bytes_done) {
+        bytes_done = (end < transfer_size) ? end : transfer_size;
+    }
+    retries = 0;
+    send_reply(SysExCommand::ACK);
+}
+
+bool Handshake::take_finished() {
+    bool result = finished;
+    finished = false;
+    return result;
+}
+
+void Handshake::transmit() {
+    MidiError result;
+
+    // Straight into the transmit ring, nothing is staged
+    switch (last_sent) {
+        case SysExCommand::RQD:
+        case SysExCommand::WSD:
+            result = MIDI::send_request(last_sent, base_address, transfer_size);
+            break;
+
+        case SysExCommand::DAT: {
+            uint32_t remaining = transfer_size - bytes_done;
+            packet_length = (remaining < SysExConst::MAX_PACKET_DATA) ? remaining : SysExConst::MAX_PACKET_DATA;
+            result = MIDI::send_data(SysExCommand::DAT, base_address + bytes_done,
+                                     tx_src + bytes_done, packet_length);
+            break;
+        }
+
+        default:
+            result = MIDI::send_handshake(last_sent);
+            break;
+    }
+
+    // Try again from update() if the transmit queue is full
+    send_pending = (result == MidiError::BUFFER_OVERFLOW);
+    last_activity = time_us_32();
+}
+
+void Handshake::send_reply(SysExCommand cmd) {
+    if (state == TransferState::RECEIVING) {
+        last_sent = cmd;
+    }
+    MIDI::send_handshake(cmd);
+}
+
+void Handshake::retry() {
+    if (++retries > MAX_RETRIES) {
+        printf("Handshake timed out after %lu bytes\n", static_cast<unsigned long>(bytes_done));
+        abort();
+        return;
+    }
+    total_retries++;
+    last_activity = time_us_32();
+
+    // A receiver only repeats its request. Repeating an ACK could make the
+    // sender skip a packet, so it waits for the sender's own retry instead.
+    if (state == TransferState::SENDING || last_sent == SysExCommand::RQD) {
+        transmit();
+    }
+}
+
+void Handshake::finish(TransferState result) {
+    state = result;
+    finished = true;
+    send_pending = false;
+    rx_dest = nullptr;
+    tx_src = nullptr;
+}
+
+} // namespace midi
+} // namespace pg1000
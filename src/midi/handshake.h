@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "sysex.h"
+
+namespace pg1000 {
+namespace midi {
+
+enum class TransferState {
+    IDLE,
+    SENDING,    // WSD/DAT/EOD out, waiting for ACK after each
+    RECEIVING,  // RQD out, ACKing each DAT until EOD
+    COMPLETE,
+    FAILED
+};
+
+// Roland handshake transfer engine (WSD/RQD/DAT/ACK/EOD/ERR/RJC).
+// Every packet is acknowledged, so packets can follow each other as fast as
+// the link allows instead of the fixed pacing needed for one-way DT1 dumps.
+// Nothing blocks: outgoing packets go through the MIDI transmit queue and
+// update() handles timeouts and retries.
+class Handshake {
+public:
+    static constexpr uint32_t RESPONSE_TIMEOUT_US = 200'000;  // Per packet
+    static constexpr uint8_t MAX_RETRIES = 3;                 // Per packet
+
+    // D-50 internal patch memory
+    static constexpr uint32_t PATCH_MEMORY = SysExAddress(0x02, 0x00, 0x00).to_linear();
+    static constexpr uint16_t PATCH_STRIDE = 448;   // 7 blocks of 64 bytes
+    static constexpr uint8_t PATCHES_PER_BANK = 64;
+    static constexpr uint32_t BANK_SIZE = static_cast<uint32_t>(PATCH_STRIDE) * PATCHES_PER_BANK;
+
+    // One patch of internal memory to or from a PATCH_STRIDE byte buffer,
+    // or all of it to or from a BANK_SIZE one. The buffer must stay put
+    // until the transfer finishes. Fails if a transfer is already running.
+    static bool receive_patch(uint8_t patch, uint8_t* dest);
+    static bool send_patch(uint8_t patch, const uint8_t* src);
+    static bool receive_bank(uint8_t* dest);
+    static bool send_bank(const uint8_t* src);
+    static void abort();
+
+    // Timeouts and retries, call from the main loop
+    static void update();
+
+    // Called by the MIDI parser
+    static void on_command(SysExCommand cmd);  // ACK/EOD/ERR/RJC
+    static void on_request(SysExCommand cmd, uint32_t address, uint32_t size);  // WSD/RQD from the synth
+    static void begin_packet(uint32_t address);
+    static void write_byte(uint8_t value);
+    static void end_packet(bool checksum_ok);
+
+    // Status
+    static TransferState get_state() { return state; }
+    static bool is_busy() { return state == TransferState::SENDING || state == TransferState::RECEIVING; }
+    static bool take_finished();  // True once per completed or failed transfer
+    static uint32_t get_bytes_done() { return bytes_done; }
+    static uint32_t get_size() { return transfer_size; }
+    static uint32_t get_retries() { return total_retries; }
+
+private:
+    static TransferState state;
+    static bool finished;
+
+    // Transfer
+    static uint32_t base_address;
+    static uint32_t transfer_size;
+    static uint32_t bytes_done;
+    static uint8_t* rx_dest;
+    static const uint8_t* tx_src;
+
+    // Current packet
+    static SysExCommand last_sent;
+    static uint16_t packet_length;   // Outgoing DAT
+    static uint32_t packet_cursor;   // Incoming DAT
+    static bool send_pending;        // Transmit queue was full
+    static uint8_t retries;
+    static uint32_t total_retries;
+    static uint32_t last_activity;
+
+    static bool start_receive(uint32_t address, uint32_t size, uint8_t* dest);
+    static bool start_send(uint32_t address, const uint8_t* src, uint32_t size);
+    static void transmit();
+    static void send_reply(SysExCommand cmd);
+    static void retry();
+    static void finish(TransferState result);
+};
+
+} // namespace midi
+} // namespace pg1000
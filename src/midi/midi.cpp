@@ -1,6 +1,16 @@
 #include "midi.h"
+#include "bulk_dump.h"
+#include "address_map.h"
+#include "handshake.h"
+#include "d50_responder.h"
+#include "clock_tracker.h"
+#include "../parameters/edit_buffer.h"
+#include "../parameters/edit_history.h"
+#include "../parameters/patch_compare.h"
+#include "../parameters/partial_selector.h"
 #include "../hardware/hardware.h"
 #include "../hardware/gpio.h"
+#include "hardware/sync.h"
 
 namespace pg1000 {
 namespace midi {
@@ -11,7 +21,29 @@ bool MIDI::sysex_enabled = true;
 bool MIDI::cc_enabled = true;
 std::vector<uint8_t> MIDI::sysex_buffer;
 bool MIDI::in_sysex = false;
+uint8_t MIDI::running_status = 0;
+bool MIDI::sysex_streaming = false;
+uint8_t MIDI::stream_command = 0;
+bool MIDI::stream_pending_valid = false;
+uint8_t MIDI::stream_pending = 0;
+uint8_t MIDI::stream_sum = 0;
+std::array<uint8_t, RX_BUFFER_SIZE> MIDI::rx_buffer;
+volatile uint16_t MIDI::rx_head = 0;
+volatile uint16_t MIDI::rx_tail = 0;
+volatile uint32_t MIDI::rx_overflows = 0;
+volatile uint32_t MIDI::last_rx_time = 0;
+std::array<MIDI::RealtimeEvent, REALTIME_BUFFER_SIZE> MIDI::realtime_buffer;
+volatile uint16_t MIDI::realtime_head = 0;
+volatile uint16_t MIDI::realtime_tail = 0;
+std::array<uint8_t, TX_BUFFER_SIZE> MIDI::tx_buffer;
+volatile uint16_t MIDI::tx_head = 0;
+volatile uint16_t MIDI::tx_tail = 0;
+bool MIDI::loopback = false;
 uint32_t MIDI::min_update_interval = MIN_UPDATE_INTERVAL;
+uint32_t MIDI::last_flush_time = 0;
+uint8_t MIDI::flush_division = FLUSH_DIVISION;
+bool MIDI::flush_scheduled = false;
+uint32_t MIDI::flush_time = 0;
 std::array<hardware::ValueSmoother<4>, MAX_PARAMETERS> MIDI::parameter_smoothers;
 std::array<std::chrono::steady_clock::time_point, MAX_PARAMETERS> MIDI::last_update_time;
 
@@ -24,15 +56,68 @@ const char* MIDI::get_error_string(MidiError error) {
         case MidiError::BUFFER_OVERFLOW: return "Buffer overflow";
         case MidiError::CHECKSUM_ERROR: return "Checksum error";
         case MidiError::MALFORMED_MESSAGE: return "Malformed message";
+        case MidiError::LINK_DOWN: return "MIDI link down";
         default: return "Unknown error";
     }
 }
 
-static void on_uart_rx() {
+void MIDI::on_uart_irq() {
+    // Only queue bytes here, parsing happens in process_incoming()
     while (uart_is_readable(uart0)) {
         uint8_t byte = uart_getc(uart0);
-        MIDI::process_incoming();
+        uint32_t now = time_us_32();
+        last_rx_time = now;
+
+        // Realtime messages keep their arrival time for the clock tracker
+        if (byte >= static_cast<uint8_t>(MessageType::TIMING_CLOCK)) {
+            uint16_t next = (realtime_head + 1) & (REALTIME_BUFFER_SIZE - 1);
+            if (next != realtime_tail) {
+                realtime_buffer[realtime_head] = {byte, now};
+                realtime_head = next;
+            }
+            continue;
+        }
+
+        queue_rx(byte);
+    }
+
+    pump_tx();
+}
+
+void MIDI::queue_rx(uint8_t byte) {
+    uint16_t next = (rx_head + 1) & (RX_BUFFER_SIZE - 1);
+    if (next == rx_tail) {
+        rx_overflows++;
+        return;
+    }
+    rx_buffer[rx_head] = byte;
+    rx_head = next;
+}
+
+void MIDI::pump_tx() {
+    while (tx_tail != tx_head && uart_is_writable(uart0)) {
+        uart_putc_raw(uart0, tx_buffer[tx_tail]);
+        tx_tail = (tx_tail + 1) & (TX_BUFFER_SIZE - 1);
+    }
+
+    // Transmit interrupt only while there is something left to send
+    uart_set_irq_enables(uart0, true, tx_tail != tx_head);
+}
+
+size_t MIDI::get_tx_free() {
+    return (tx_tail - tx_head - 1) & (TX_BUFFER_SIZE - 1);
+}
+
+size_t MIDI::get_rx_free() {
+    return (rx_tail - rx_head - 1) & (RX_BUFFER_SIZE - 1);
+}
+
+void MIDI::loopback_receive(const uint8_t* data, size_t length) {
+    uint32_t irq_state = save_and_disable_interrupts();
+    for (size_t i = 0; i < length; i++) {
+        queue_rx(data[i]);
     }
+    restore_interrupts(irq_state);
 }
 
 bool MIDI::init() {
@@ -41,8 +126,12 @@ bool MIDI::init() {
     gpio_set_function(UART_TX, GPIO_FUNC_UART);
     gpio_set_function(UART_RX, GPIO_FUNC_UART);
 
+    // Interrupt on every byte, so realtime timestamps aren't delayed by
+    // the FIFO level or receive timeout
+    uart_set_fifo_enabled(uart0, false);
+
     // Setup UART interrupt
-    irq_set_exclusive_handler(UART0_IRQ, on_uart_rx);
+    irq_set_exclusive_handler(UART0_IRQ, on_uart_irq);
     irq_set_enabled(UART0_IRQ, true);
     uart_set_irq_enables(uart0, true, false);
 
@@ -84,35 +173,80 @@ MidiError MIDI::send_cc(uint8_t cc, uint8_t value) {
 MidiError MIDI::send_sysex(const Parameter* param) {
     if (!sysex_enabled || !param) return MidiError::INVALID_PARAMETER;
 
-    // Get parameter address
-    SysExAddress addr = SysEx::get_parameter_address(param);
-    
-    // Apply value smoothing
-    uint16_t smoothed_value = parameter_smoothers[param->pot_number].update(param->value);
-    
-    // Check if we should send an update
+    // Check if we should send an update, if not the value stays dirty
+    // and goes out with the next send_dirty()
     if (!should_update_parameter(param->pot_number)) {
         return MidiError::OK;
     }
 
-    // Prepare SysEx message
-    std::vector<uint8_t> sysex = {
-        static_cast<uint8_t>(MessageType::SYSTEM_EXCLUSIVE),
-        ROLAND_ID,
-        static_cast<uint8_t>(midi_channel - 1),  // Device ID
-        D50_ID,
-        DT1_COMMAND,
-        addr.msb,      // Address MSB
-        addr.mid,      // Address middle byte
-        addr.lsb,      // Address LSB
-        static_cast<uint8_t>(smoothed_value & 0x7F)  // Parameter value
-    };
-    
-    // Calculate checksum
-    sysex.push_back(calculate_checksum(sysex.data() + 5, 4));  // Start from address bytes
-    sysex.push_back(0xF7);  // End of SysEx
-    
-    return send_bytes(sysex.data(), sysex.size());
+    // A partial parameter may have been written to several partials
+    if (is_partial_group(param->group) && parameters::PartialSelector::get_targets().count > 1) {
+        return send_dirty();
+    }
+
+    // Send what's in the edit buffer, so the image always matches the synth
+    uint16_t address = get_parameter_address(param);
+    uint8_t value = parameters::EditBuffer::get(address);
+
+    MidiError result = send_data(SysExCommand::DT1, address, &value, 1);
+    if (result == MidiError::OK) {
+        parameters::EditBuffer::clear_dirty(address, 1);
+    }
+    return result;
+}
+
+MidiError MIDI::send_dirty() {
+    if (!sysex_enabled) return MidiError::OK;
+
+    uint16_t start;
+    uint16_t length;
+    uint16_t from = 0;
+    while (parameters::EditBuffer::next_dirty_run(from, start, length)) {
+        MidiError result = send_data(SysExCommand::DT1, start, parameters::EditBuffer::data() + start, length);
+        if (result != MidiError::OK) return result;
+
+        parameters::EditBuffer::clear_dirty(start, length);
+        from = start + length;
+    }
+    return MidiError::OK;
+}
+
+MidiError MIDI::send_data(SysExCommand cmd, uint32_t address, const uint8_t* data, size_t length) {
+    if (!data || length == 0 || length > SysExConst::MAX_PACKET_DATA) return MidiError::INVALID_PARAMETER;
+
+    MidiError result = reserve_tx(length + SysExConst::DATA_OVERHEAD);
+    if (result != MidiError::OK) return result;
+
+    SysEx::write_data(cmd, address, data, length, queue_tx);
+    start_tx();
+    return MidiError::OK;
+}
+
+MidiError MIDI::send_patch(const parameters::PatchView& patch) {
+    if (patch.empty()) return MidiError::INVALID_PARAMETER;
+
+    // One DT1 per block, leaving out the reserved tail of each
+    size_t total = 0;
+    for (uint8_t length : EDIT_BLOCK_LENGTHS) {
+        total += length + SysExConst::DATA_OVERHEAD;
+    }
+    MidiError result = reserve_tx(total);
+    if (result != MidiError::OK) return result;
+
+    for (size_t block = 0; block < EDIT_BLOCK_LENGTHS.size(); block++) {
+        uint16_t address = block * EDIT_BLOCK_SIZE;
+        SysEx::write_data(SysExCommand::DT1, address, patch.data() + address, EDIT_BLOCK_LENGTHS[block], queue_tx);
+    }
+    start_tx();
+
+    // The synth now holds this patch
+    for (uint16_t address = 0; address < patch.size(); address++) {
+        parameters::EditBuffer::store(address, patch[address]);
+    }
+    AddressMap::apply(0, patch.size());
+    parameters::EditHistory::clear();
+    parameters::PatchCompare::capture();
+    return MidiError::OK;
 }
 
 MidiError MIDI::send_program_change(uint8_t program) {
@@ -152,99 +286,280 @@ MidiError MIDI::request_parameter(const Parameter* param) {
 }
 
 MidiError MIDI::request_all_parameters() {
-    std::vector<uint8_t> sysex = {
-        static_cast<uint8_t>(MessageType::SYSTEM_EXCLUSIVE),
-        ROLAND_ID,
-        static_cast<uint8_t>(midi_channel - 1),
-        D50_ID,
-        RQ1_COMMAND,
-        0x00, 0x00, 0x00,  // Start address
-        0x00, 0x03, 0x25   // Size (421 bytes)
-    };
-    
-    sysex.push_back(calculate_checksum(sysex.data() + 5, 6));
-    sysex.push_back(0xF7);
-    
-    return send_bytes(sysex.data(), sysex.size());
+    // The reply arrives as DT1 packets, streamed into the shadow image
+    BulkDump::begin();
+    return send_request(SysExCommand::RQ1, 0, SysExConst::FULL_REQUEST_SIZE);
+}
+
+MidiError MIDI::send_request(SysExCommand cmd, uint32_t address, uint32_t size) {
+    MidiError result = reserve_tx(SysExConst::DATA_OVERHEAD + 3);  // Size follows the address
+    if (result != MidiError::OK) return result;
+
+    SysEx::write_request(cmd, address, size, queue_tx);
+    start_tx();
+    return MidiError::OK;
+}
+
+MidiError MIDI::send_handshake(SysExCommand cmd) {
+    MidiError result = reserve_tx(SysExConst::SHORT_MESSAGE_SIZE);
+    if (result != MidiError::OK) return result;
+
+    SysEx::write_handshake(cmd, queue_tx);
+    start_tx();
+    return MidiError::OK;
 }
 
 void MIDI::process_incoming() {
-    while (uart_is_readable(uart0)) {
-        uint8_t byte = uart_getc(uart0);
-        
-        // Handle real-time messages immediately
-        if (byte >= static_cast<uint8_t>(MessageType::TIMING_CLOCK)) {
-            handle_realtime_message(static_cast<MessageType>(byte));
-            continue;
+    while (realtime_tail != realtime_head) {
+        RealtimeEvent event = realtime_buffer[realtime_tail];
+        realtime_tail = (realtime_tail + 1) & (REALTIME_BUFFER_SIZE - 1);
+        handle_realtime_message(static_cast<MessageType>(event.message), event.timestamp);
+    }
+
+    while (rx_tail != rx_head) {
+        uint8_t byte = rx_buffer[rx_tail];
+        rx_tail = (rx_tail + 1) & (RX_BUFFER_SIZE - 1);
+        parse_byte(byte);
+    }
+
+    if (loopback) {
+        D50Responder::update();
+    }
+
+    // Read last_rx before now, so now is never older
+    uint32_t last_rx = last_rx_time;
+    ClockTracker::update(time_us_32(), last_rx);
+    if (ClockTracker::take_link_restored()) {
+        request_all_parameters();  // Synth may have been power cycled
+    }
+
+    BulkDump::update();
+    Handshake::update();
+
+    // Edits pile up in the edit buffer between flushes, so a pot sweep
+    // sends the latest value rather than every step. While a sequencer
+    // runs they wait for the predicted time of the next division.
+    bool aligned = flush_division != 0 && ClockTracker::has_clock() &&
+                   ClockTracker::get_transport() == Transport::RUNNING;
+    if (!aligned || !parameters::EditBuffer::has_dirty()) {
+        flush_scheduled = false;
+    } else if (!flush_scheduled) {
+        flush_time = ClockTracker::get_next_division_time(flush_division);
+        flush_scheduled = true;
+    }
+
+    uint32_t now = time_us_32();
+    if (is_flush_due(now)) {
+        last_flush_time = now;
+        flush_scheduled = false;
+        send_dirty();
+    }
+}
+
+bool MIDI::is_flush_due(uint32_t now_us) {
+    if (!parameters::EditBuffer::has_dirty() || now_us - last_flush_time < min_update_interval) return false;
+    return !flush_scheduled || static_cast<int32_t>(now_us - flush_time) >= 0;
+}
+
+void MIDI::parse_byte(uint8_t byte) {
+    // Realtime bytes from the UART never get here, only loopback ones
+    if (byte >= static_cast<uint8_t>(MessageType::TIMING_CLOCK)) {
+        handle_realtime_message(static_cast<MessageType>(byte), time_us_32());
+        return;
+    }
+    
+    // Handle SysEx
+    if (byte == static_cast<uint8_t>(MessageType::SYSTEM_EXCLUSIVE)) {
+        if (sysex_streaming) {
+            end_sysex_stream(false);  // Previous packet never terminated
         }
-        
-        // Handle SysEx
-        if (byte == static_cast<uint8_t>(MessageType::SYSTEM_EXCLUSIVE)) {
-            sysex_buffer.clear();
-            sysex_buffer.push_back(byte);
-            in_sysex = true;
-            continue;
+        sysex_buffer.clear();
+        sysex_buffer.push_back(byte);
+        in_sysex = true;
+        running_status = 0;
+        return;
+    }
+    
+    // Process SysEx data
+    if (in_sysex) {
+        if (byte == 0xF7) {
+            in_sysex = false;
+            if (sysex_streaming) {
+                // The held back byte was the checksum, and is already in the sum
+                end_sysex_stream(stream_pending_valid && stream_sum == 0);
+            } else {
+                sysex_buffer.push_back(byte);
+                handle_sysex();
+            }
+            return;
         }
-        
-        // Process SysEx data
-        if (in_sysex) {
-            sysex_buffer.push_back(byte);
-            
-            // Check for end of SysEx
-            if (byte == 0xF7) {
-                in_sysex = false;
-                if (verify_checksum(sysex_buffer)) {
-                    handle_sysex();
+
+        if (byte & 0x80) {
+            // Any other status byte aborts the message
+            if (sysex_streaming) {
+                end_sysex_stream(false);
+            }
+            in_sysex = false;
+        } else if (sysex_streaming) {
+            if (stream_pending_valid) {
+                if (stream_command == DAT_COMMAND) {
+                    Handshake::write_byte(stream_pending);
+                } else {
+                    BulkDump::write_byte(stream_pending);
                 }
             }
+            stream_pending = byte;
+            stream_pending_valid = true;
+            stream_sum = (stream_sum + byte) & 0x7F;
+            return;
+        } else {
+            sysex_buffer.push_back(byte);
+
+            if (sysex_buffer.size() == SYSEX_HEADER_SIZE &&
+                sysex_buffer[1] == ROLAND_ID &&
+                sysex_buffer[3] == D50_ID &&
+                (sysex_buffer[4] == DT1_COMMAND || sysex_buffer[4] == DAT_COMMAND)) {
+                start_sysex_stream();
+            }
             
             // Check for buffer overflow
             if (sysex_buffer.size() >= MAX_SYSEX_SIZE) {
                 in_sysex = false;
                 sysex_buffer.clear();
             }
-            continue;
+            return;
         }
     }
+
+    // Channel messages (running status)
+    if (byte & 0x80) {
+        running_status = (byte < static_cast<uint8_t>(MessageType::SYSTEM_EXCLUSIVE)) ? byte : 0;
+        return;
+    }
+    if (running_status) {
+        handle_channel_message(running_status, byte);
+    }
+}
+
+void MIDI::start_sysex_stream() {
+    SysExAddress addr = {
+        sysex_buffer[5],
+        sysex_buffer[6],
+        sysex_buffer[7]
+    };
+
+    sysex_streaming = true;
+    stream_command = sysex_buffer[4];
+    stream_pending_valid = false;
+    stream_sum = (addr.msb + addr.mid + addr.lsb) & 0x7F;
+
+    if (stream_command == DAT_COMMAND) {
+        Handshake::begin_packet(addr.to_linear());
+    } else {
+        BulkDump::begin_packet(addr.to_linear());
+    }
+}
+
+void MIDI::end_sysex_stream(bool checksum_ok) {
+    sysex_streaming = false;
+
+    if (stream_command == DAT_COMMAND) {
+        Handshake::end_packet(checksum_ok);
+    } else {
+        BulkDump::end_packet(checksum_ok);
+    }
+}
+
+void MIDI::handle_channel_message(uint8_t status, uint8_t data) {
+    if ((status & 0x0F) != midi_channel - 1) return;
+
+    switch (status & 0xF0) {
+        case static_cast<uint8_t>(MessageType::PROGRAM_CHANGE):
+            // Patch changed on the synth, pull the new edit buffer
+            request_all_parameters();
+            break;
+        default:
+            // Other channel messages are ignored
+            break;
+    }
 }
 
 MidiError MIDI::send_bytes(const uint8_t* data, size_t length) {
     if (!data) return MidiError::INVALID_PARAMETER;
-    
+
+    MidiError result = reserve_tx(length);
+    if (result != MidiError::OK) return result;
+
     for (size_t i = 0; i < length; i++) {
-        uart_putc(uart0, data[i]);
+        queue_tx(data[i]);
     }
+    start_tx();
     
     return MidiError::OK;
 }
 
+MidiError MIDI::reserve_tx(size_t length) {
+    if (loopback) return MidiError::OK;
+
+    // Don't waste bandwidth while active sensing says nobody is listening
+    if (!ClockTracker::is_link_up()) return MidiError::LINK_DOWN;
+
+    // Never queue part of a message
+    if (length > get_tx_free()) return MidiError::BUFFER_OVERFLOW;
+    return MidiError::OK;
+}
+
+void MIDI::queue_tx(uint8_t byte) {
+    if (loopback) {
+        D50Responder::receive(&byte, 1);
+        return;
+    }
+    tx_buffer[tx_head] = byte;
+    tx_head = (tx_head + 1) & (TX_BUFFER_SIZE - 1);
+}
+
+void MIDI::start_tx() {
+    if (loopback) return;
+
+    // Prime the FIFO, the interrupt takes over from there
+    uint32_t irq_state = save_and_disable_interrupts();
+    pump_tx();
+    restore_interrupts(irq_state);
+}
+
 void MIDI::handle_sysex() {
-    if (sysex_buffer.size() < 11) return;  // Minimum size for D50 message
+    if (sysex_buffer.size() < SysExConst::SHORT_MESSAGE_SIZE) return;
     
     // Verify Roland message
     if (sysex_buffer[1] != ROLAND_ID || 
         sysex_buffer[3] != D50_ID) return;
+
+    SysExCommand cmd = static_cast<SysExCommand>(sysex_buffer[4]);
+
+    // Handshake replies carry no address or checksum
+    if (sysex_buffer.size() == SysExConst::SHORT_MESSAGE_SIZE) {
+        Handshake::on_command(cmd);
+        return;
+    }
+
+    if (sysex_buffer.size() < 11 || !verify_checksum(sysex_buffer)) return;  // Minimum size for D50 message
         
     // Process message based on command
-    switch (sysex_buffer[4]) {
-        case RQ1_COMMAND:  // RQ1 - Data request
+    switch (cmd) {
+        case SysExCommand::RQ1:  // RQ1 - Data request
             // Handle parameter request response
             break;
-            
-        case DT1_COMMAND:  // DT1 - Data set
-            if (sysex_buffer.size() < 13) return;  // Need at least address + value + checksum
-            
-            // Extract address and value
-            SysExAddress addr = {
-                sysex_buffer[5],
-                sysex_buffer[6],
-                sysex_buffer[7]
-            };
-            
-            uint8_t value = sysex_buffer[8];
-            
-            // Update parameter based on address
-            // TODO: Implement parameter update logic
+
+        case SysExCommand::WSD:
+        case SysExCommand::RQD:
+            if (sysex_buffer.size() < 13) return;  // Address + size + checksum
+            Handshake::on_request(cmd,
+                SysExAddress(sysex_buffer[5], sysex_buffer[6], sysex_buffer[7]).to_linear(),
+                SysExAddress(sysex_buffer[8], sysex_buffer[9], sysex_buffer[10]).to_linear());
+            break;
+
+        // DT1 and DAT never get here, their data is streamed as it arrives
+        default:
             break;
     }
 }
@@ -272,22 +587,22 @@ bool MIDI::verify_checksum(const std::vector<uint8_t>& message) {
     return sum == 0;  // Valid checksum should result in 0
 }
 
-void MIDI::handle_realtime_message(MessageType message) {
+void MIDI::handle_realtime_message(MessageType message, uint32_t timestamp) {
     switch (message) {
         case MessageType::TIMING_CLOCK:
-            // Handle MIDI clock pulse (24 ppq)
+            ClockTracker::on_clock(timestamp);
             break;
         case MessageType::START:
-            // Handle MIDI start message
+            ClockTracker::on_start(timestamp);
             break;
         case MessageType::CONTINUE:
-            // Handle MIDI continue message
+            ClockTracker::on_continue();
             break;
         case MessageType::STOP:
-            // Handle MIDI stop message
+            ClockTracker::on_stop();
             break;
         case MessageType::ACTIVE_SENSING:
-            // Handle MIDI active sensing message
+            ClockTracker::on_active_sensing(timestamp);
             break;
         case MessageType::SYSTEM_RESET:
             // Handle MIDI system reset message
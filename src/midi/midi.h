@@ -6,6 +6,7 @@
 #include <chrono>
 #include "sysex.h"
 #include "../parameters/parameters.h"
+#include "../parameters/patch_view.h"
 #include "../hardware/value_smoother.h"
 
 namespace pg1000 {
@@ -16,9 +17,14 @@ static constexpr uint8_t MIDI_CHANNEL = 1;     // Default channel
 static constexpr uint32_t MIDI_BAUD = 31250;   // MIDI baud rate
 static constexpr uint8_t UART_TX = 0;          // UART TX pin
 static constexpr uint8_t UART_RX = 1;          // UART RX pin
-static constexpr size_t MAX_SYSEX_SIZE = 256;  // Maximum SysEx message size
+static constexpr size_t MAX_SYSEX_SIZE = 256;  // Maximum buffered SysEx message size (DT1 data is streamed)
+static constexpr size_t SYSEX_HEADER_SIZE = 8; // F0 41 dev 14 cmd + 3 address bytes
+static constexpr size_t RX_BUFFER_SIZE = 512;  // UART receive ring (power of two)
+static constexpr size_t TX_BUFFER_SIZE = 512;  // UART transmit ring (power of two)
+static constexpr size_t REALTIME_BUFFER_SIZE = 32;  // Timestamped realtime messages (power of two)
 static constexpr uint8_t MAX_PARAMETERS = 128;  // Maximum number of parameters
 static constexpr uint32_t MIN_UPDATE_INTERVAL = 10000;  // Minimum time between parameter updates (10ms)
+static constexpr uint8_t FLUSH_DIVISION = 6;    // With clock running, edits go out on sixteenths
 
 // MIDI Message Types
 enum class MessageType : uint8_t {
@@ -40,6 +46,7 @@ static constexpr uint8_t ROLAND_ID = 0x41;
 static constexpr uint8_t D50_ID = 0x14;
 static constexpr uint8_t DT1_COMMAND = 0x12;
 static constexpr uint8_t RQ1_COMMAND = 0x11;
+static constexpr uint8_t DAT_COMMAND = 0x42;
 
 // MIDI Error Codes
 enum class MidiError {
@@ -49,7 +56,8 @@ enum class MidiError {
     INVALID_VALUE,
     BUFFER_OVERFLOW,
     CHECKSUM_ERROR,
-    MALFORMED_MESSAGE
+    MALFORMED_MESSAGE,
+    LINK_DOWN
 };
 
 class MIDI {
@@ -60,21 +68,39 @@ public:
     // MIDI message sending
     static MidiError send_cc(uint8_t cc, uint8_t value);
     static MidiError send_sysex(const Parameter* param);
+    static MidiError send_dirty();  // Dirty edit buffer runs as DT1, what doesn't fit stays dirty
+    static bool is_flush_due(uint32_t now_us);  // process_incoming() would call send_dirty()
+    static MidiError send_data(SysExCommand cmd, uint32_t address, const uint8_t* data, size_t length);
+    static MidiError send_patch(const parameters::PatchView& patch);  // Whole patch into the synth's edit buffer
     static MidiError send_program_change(uint8_t program);
     static MidiError request_parameter(const Parameter* param);
-    static MidiError request_all_parameters();
+    static MidiError request_all_parameters();  // Starts a BulkDump sync
+    static MidiError send_request(SysExCommand cmd, uint32_t address, uint32_t size);  // RQ1/RQD/WSD for a linear range
+    static MidiError send_handshake(SysExCommand cmd);  // ACK/EOD/ERR/RJC
+    static size_t get_tx_free();
 
     // MIDI message receiving
     static void process_incoming();
+    static uint32_t get_rx_overflows() { return rx_overflows; }
+    static size_t get_rx_free();
+
+    // Loopback to the local D-50 stand-in (D50Responder) instead of the UART
+    static void set_loopback(bool enable) { loopback = enable; }
+    static bool is_loopback() { return loopback; }
+    static void loopback_receive(const uint8_t* data, size_t length);
     
     // Configuration
     static void enable_sysex(bool enable) { sysex_enabled = enable; }
     static void enable_cc(bool enable) { cc_enabled = enable; }
     static void set_update_interval(uint32_t interval_us) { min_update_interval = interval_us; }
+    static void set_flush_division(uint8_t clocks) { flush_division = clocks; }  // 0 to ignore the clock
 
     // MIDI channel access
     static void set_midi_channel(uint8_t channel) { 
-        if (channel >= 1 && channel <= 16) midi_channel = channel;
+        if (channel >= 1 && channel <= 16) {
+            midi_channel = channel;
+            SysEx::set_midi_channel(channel);
+        }
     }
     static uint8_t get_midi_channel() { return midi_channel; }
 
@@ -87,14 +113,58 @@ private:
     static bool cc_enabled;
     static std::vector<uint8_t> sysex_buffer;
     static bool in_sysex;
+    static uint8_t running_status;
+
+    // DT1/DAT data streaming (see BulkDump and Handshake)
+    static bool sysex_streaming;
+    static uint8_t stream_command;
+    static bool stream_pending_valid;
+    static uint8_t stream_pending;   // Held back until we know it isn't the checksum
+    static uint8_t stream_sum;
+
+    // Receive ring, filled from the UART interrupt
+    static std::array<uint8_t, RX_BUFFER_SIZE> rx_buffer;
+    static volatile uint16_t rx_head;
+    static volatile uint16_t rx_tail;
+    static volatile uint32_t rx_overflows;
+    static volatile uint32_t last_rx_time;
+
+    // Realtime messages, timestamped in the UART interrupt
+    struct RealtimeEvent {
+        uint8_t message;
+        uint32_t timestamp;
+    };
+    static std::array<RealtimeEvent, REALTIME_BUFFER_SIZE> realtime_buffer;
+    static volatile uint16_t realtime_head;
+    static volatile uint16_t realtime_tail;
+
+    // Transmit ring, drained from the UART interrupt
+    static std::array<uint8_t, TX_BUFFER_SIZE> tx_buffer;
+    static volatile uint16_t tx_head;
+    static volatile uint16_t tx_tail;
+    static bool loopback;
     static uint32_t min_update_interval;
+    static uint32_t last_flush_time;
+    static uint8_t flush_division;
+    static bool flush_scheduled;   // Edits are waiting for flush_time, a clock division
+    static uint32_t flush_time;
     static std::array<hardware::ValueSmoother<4>, MAX_PARAMETERS> parameter_smoothers;
     static std::array<std::chrono::steady_clock::time_point, MAX_PARAMETERS> last_update_time;
     
     // Helper functions
     static MidiError send_bytes(const uint8_t* data, size_t length);
+    static MidiError reserve_tx(size_t length);  // Room for a whole message, or an error
+    static void queue_tx(uint8_t byte);
+    static void start_tx();
+    static void on_uart_irq();
+    static void pump_tx();
+    static void queue_rx(uint8_t byte);
+    static void parse_byte(uint8_t byte);
     static void handle_sysex();
-    static void handle_realtime_message(MessageType message);
+    static void start_sysex_stream();
+    static void end_sysex_stream(bool checksum_ok);
+    static void handle_channel_message(uint8_t status, uint8_t data);
+    static void handle_realtime_message(MessageType message, uint32_t timestamp);
     static uint8_t calculate_checksum(const uint8_t* data, size_t length);
     static bool verify_checksum(const std::vector<uint8_t>& message);
     static bool should_update_parameter(uint8_t parameter_index);
@@ -1,4 +1,5 @@
 #include "sysex.h"
+#include "bulk_dump.h"
 #include <algorithm>
 
 namespace pg1000 {
@@ -89,6 +90,40 @@ std::vector<uint8_t> SysEx::create_bulk_request() {
     return create_parameter_request();
 }
 
+std::vector<uint8_t> SysEx::create_data(SysExCommand cmd, uint32_t address, const uint8_t* data, size_t length) {
+    if (!data || length == 0 || length > SysExConst::MAX_PACKET_DATA) return std::vector<uint8_t>();
+
+    std::vector<uint8_t> msg;
+    msg.reserve(length + SysExConst::DATA_OVERHEAD);
+    write_data(cmd, address, data, length, [&msg](uint8_t byte) { msg.push_back(byte); });
+
+    return msg;
+}
+
+std::vector<uint8_t> SysEx::create_request(SysExCommand cmd, uint32_t address, uint32_t size) {
+    std::vector<uint8_t> msg;
+    msg.reserve(13);
+
+    add_header(msg, cmd);
+    add_address(msg, SysExAddress::from_linear(address));
+    add_address(msg, SysExAddress::from_linear(size));  // Size uses the same 7-bit encoding
+
+    add_checksum(msg);
+    msg.push_back(SysExConst::EOX);
+
+    return msg;
+}
+
+std::vector<uint8_t> SysEx::create_handshake(SysExCommand cmd) {
+    std::vector<uint8_t> msg;
+    msg.reserve(SysExConst::SHORT_MESSAGE_SIZE);
+
+    add_header(msg, cmd);
+    msg.push_back(SysExConst::EOX);
+
+    return msg;
+}
+
 bool SysEx::parse_message(const std::vector<uint8_t>& data) {
     if (!is_valid_message(data)) return false;
 
@@ -97,11 +132,14 @@ bool SysEx::parse_message(const std::vector<uint8_t>& data) {
 
     switch (cmd) {
         case SysExCommand::DT1: {
-            // Extract address and value
+            // Feed the data bytes (everything between address and checksum)
+            // through the same path as streamed packets
             SysExAddress addr{data[5], data[6], data[7]};
-            uint8_t value = data[8];
-            
-            // TODO: Update parameter based on address
+            BulkDump::begin_packet(addr.to_linear());
+            for (size_t i = 8; i < data.size() - 2; i++) {
+                BulkDump::write_byte(data[i]);
+            }
+            BulkDump::end_packet(true);  // Checksum verified by is_valid_message()
             return true;
         }
         
@@ -130,63 +168,14 @@ bool SysEx::is_valid_message(const std::vector<uint8_t>& data) {
 
 SysExAddress SysEx::get_parameter_address(const Parameter* param) {
     if (!param) return SysExAddress();
+    return SysExAddress::from_linear(get_edit_address(*param));
+}
 
-    SysExAddress base_addr;
-    uint8_t offset = 0;
-
-    // First determine base address based on parameter group
-    switch (param->group) {
-        case ParamGroup::UPPER_PARTIAL_1:
-            base_addr = UPPER_PARTIAL_1;
-            offset = param->partial_offset;
-            break;
-
-        case ParamGroup::UPPER_PARTIAL_2:
-            base_addr = UPPER_PARTIAL_2;
-            offset = param->partial_offset;
-            break;
-
-        case ParamGroup::UPPER_COMMON:
-            base_addr = UPPER_COMMON;
-            offset = param->common_offset;
-            break;
-
-        case ParamGroup::LOWER_PARTIAL_1:
-            base_addr = LOWER_PARTIAL_1;
-            offset = param->partial_offset;
-            break;
-
-        case ParamGroup::LOWER_PARTIAL_2:
-            base_addr = LOWER_PARTIAL_2;
-            offset = param->partial_offset;
-            break;
-
-        case ParamGroup::LOWER_COMMON:
-            base_addr = LOWER_COMMON;
-            offset = param->common_offset;
-            break;
-
-        case ParamGroup::PATCH:
-            base_addr = PATCH;
-            offset = param->patch_offset;
-            break;
-
-        default:
-            return SysExAddress();
-    }
-
-    // Add offset to base address
-    // Since addresses are 3 bytes, we need to handle carries
-    uint16_t total = base_addr.lsb + offset;
-    uint8_t new_lsb = total & 0x7F;
-    uint8_t carry = (total >> 7) & 0x7F;
-
-    // Mid byte can carry to MSB if needed
-    uint16_t new_mid = base_addr.mid + carry;
-    uint8_t new_msb = base_addr.msb + (new_mid >> 7);
-    new_mid &= 0x7F;
+bool SysEx::get_linear_address(const Parameter* param, uint16_t& address) {
+    if (!param) return false;
 
-    return SysExAddress(new_msb, new_mid, new_lsb);
+    address = get_edit_address(*param);
+    return is_edit_address_valid(address);
 }
 
 uint8_t SysEx::calculate_checksum(const std::vector<uint8_t>& data) {
@@ -203,7 +192,13 @@ uint8_t SysEx::calculate_checksum(const std::vector<uint8_t>& data) {
 }
 
 void SysEx::add_checksum(std::vector<uint8_t>& msg) {
-    msg.push_back(calculate_checksum(msg));
+    // calculate_checksum() expects a complete message, here the checksum
+    // and EOX are still missing so every byte after the Command-ID counts
+    uint8_t sum = 0;
+    for (size_t i = 5; i < msg.size(); i++) {
+        sum += msg[i];
+    }
+    msg.push_back((128 - (sum & 0x7F)) & 0x7F);
 }
 
 void SysEx::add_address(std::vector<uint8_t>& msg, const SysExAddress& addr) {
@@ -212,5 +207,13 @@ void SysEx::add_address(std::vector<uint8_t>& msg, const SysExAddress& addr) {
     msg.push_back(addr.lsb);
 }
 
+void SysEx::add_header(std::vector<uint8_t>& msg, SysExCommand cmd) {
+    msg.push_back(SysExConst::STATUS);
+    msg.push_back(SysExConst::ROLAND_ID);
+    msg.push_back(get_device_id());
+    msg.push_back(SysExConst::D50_ID);
+    msg.push_back(static_cast<uint8_t>(cmd));
+}
+
 } // namespace midi
 } // namespace pg1000
@@ -11,7 +11,16 @@ namespace midi {
 // SysEx Message Types
 enum class SysExCommand : uint8_t {
     RQ1 = 0x11,  // Request data (one way)
-    DT1 = 0x12   // Data set (two way)
+    DT1 = 0x12,  // Data set (two way)
+
+    // Handshake protocol
+    WSD = 0x40,  // Want to send data
+    RQD = 0x41,  // Request data
+    DAT = 0x42,  // Data set
+    ACK = 0x43,  // Acknowledge
+    EOD = 0x45,  // End of data
+    ERR = 0x4E,  // Communication error
+    RJC = 0x4F   // Rejection
 };
 
 // SysEx Constants
@@ -21,6 +30,9 @@ struct SysExConst {
     static constexpr uint8_t ROLAND_ID = 0x41;     // Roland manufacturer ID
     static constexpr uint8_t D50_ID = 0x14;        // D-50 model ID
     static constexpr uint16_t FULL_REQUEST_SIZE = 421; // Size for full parameter request
+    static constexpr uint16_t MAX_PACKET_DATA = 256;   // Data bytes per DT1/DAT packet
+    static constexpr uint8_t DATA_OVERHEAD = 10;       // Header, address, checksum and EOX around the data
+    static constexpr uint8_t SHORT_MESSAGE_SIZE = 6;   // ACK/EOD/ERR/RJC carry no address or checksum
 };
 
 // SysEx Address Structure
@@ -32,6 +44,17 @@ struct SysExAddress {
     // Constructor for easy initialization
     constexpr SysExAddress(uint8_t m = 0, uint8_t i = 0, uint8_t l = 0) 
         : msb(m), mid(i), lsb(l) {}
+
+    // Linear position in the address map (7 bits per address byte)
+    constexpr uint32_t to_linear() const {
+        return (static_cast<uint32_t>(msb) << 14) | (static_cast<uint32_t>(mid) << 7) | lsb;
+    }
+
+    static constexpr SysExAddress from_linear(uint32_t linear) {
+        return SysExAddress(static_cast<uint8_t>((linear >> 14) & 0x7F),
+                            static_cast<uint8_t>((linear >> 7) & 0x7F),
+                            static_cast<uint8_t>(linear & 0x7F));
+    }
 };
 
 // Base addresses for different sections
@@ -44,6 +67,12 @@ static constexpr SysExAddress LOWER_COMMON{0x00, 0x02, 0x40};     // 320-367
 static constexpr SysExAddress PATCH{0x00, 0x03, 0x00};            // 384-420
 static constexpr SysExAddress PATCH_WRITE{0x00, 0x20, 0x00};      // Patch write address
 
+static_assert(UPPER_COMMON.to_linear() == get_group_base(ParamGroup::UPPER_COMMON) &&
+              LOWER_PARTIAL_1.to_linear() == get_group_base(ParamGroup::LOWER_PARTIAL_1) &&
+              PATCH.to_linear() == get_group_base(ParamGroup::PATCH),
+              "SysEx block addresses out of step with the edit buffer layout");
+static_assert(SysExConst::FULL_REQUEST_SIZE == EDIT_BUFFER_SIZE, "Full request must cover the edit buffer");
+
 class SysEx {
 public:
     // Create SysEx messages
@@ -52,12 +81,76 @@ public:
     static std::vector<uint8_t> create_patch_write();
     static std::vector<uint8_t> create_bulk_request();
 
+    // Generic messages, addresses and sizes are linear
+    static std::vector<uint8_t> create_data(SysExCommand cmd, uint32_t address, const uint8_t* data, size_t length);
+    static std::vector<uint8_t> create_request(SysExCommand cmd, uint32_t address, uint32_t size);
+    static std::vector<uint8_t> create_handshake(SysExCommand cmd);
+
+    // Build a DT1/DAT frame one byte at a time into put(uint8_t). The
+    // checksum is summed as the data goes past, so data can be streamed
+    // from flash into the transmit ring without a staging buffer.
+    template <typename Put>
+    static void write_data(SysExCommand cmd, uint32_t address, const uint8_t* data, size_t length, Put&& put) {
+        SysExAddress addr = SysExAddress::from_linear(address);
+        put(SysExConst::STATUS);
+        put(SysExConst::ROLAND_ID);
+        put(get_device_id());
+        put(SysExConst::D50_ID);
+        put(static_cast<uint8_t>(cmd));
+        put(addr.msb);
+        put(addr.mid);
+        put(addr.lsb);
+
+        uint8_t sum = addr.msb + addr.mid + addr.lsb;
+        for (size_t i = 0; i < length; i++) {
+            uint8_t byte = data[i] & 0x7F;
+            sum += byte;
+            put(byte);
+        }
+
+        put(static_cast<uint8_t>((128 - (sum & 0x7F)) & 0x7F));
+        put(SysExConst::EOX);
+    }
+
+    // Request and handshake frames the same way, for the transmit ring
+    template <typename Put>
+    static void write_request(SysExCommand cmd, uint32_t address, uint32_t size, Put&& put) {
+        SysExAddress addr = SysExAddress::from_linear(address);
+        SysExAddress length = SysExAddress::from_linear(size);  // Same 7-bit encoding
+        put(SysExConst::STATUS);
+        put(SysExConst::ROLAND_ID);
+        put(get_device_id());
+        put(SysExConst::D50_ID);
+        put(static_cast<uint8_t>(cmd));
+        put(addr.msb);
+        put(addr.mid);
+        put(addr.lsb);
+        put(length.msb);
+        put(length.mid);
+        put(length.lsb);
+
+        uint8_t sum = addr.msb + addr.mid + addr.lsb + length.msb + length.mid + length.lsb;
+        put(static_cast<uint8_t>((128 - (sum & 0x7F)) & 0x7F));
+        put(SysExConst::EOX);
+    }
+
+    template <typename Put>
+    static void write_handshake(SysExCommand cmd, Put&& put) {
+        put(SysExConst::STATUS);
+        put(SysExConst::ROLAND_ID);
+        put(get_device_id());
+        put(SysExConst::D50_ID);
+        put(static_cast<uint8_t>(cmd));
+        put(SysExConst::EOX);
+    }
+
     // Message parsing
     static bool parse_message(const std::vector<uint8_t>& data);
     static bool is_valid_message(const std::vector<uint8_t>& data);
     
     // Address helpers
     static SysExAddress get_parameter_address(const Parameter* param);
+    static bool get_linear_address(const Parameter* param, uint16_t& address);
     static uint8_t calculate_checksum(const std::vector<uint8_t>& data);
 
     // Set MIDI channel for device ID
@@ -70,6 +163,7 @@ private:
     static uint8_t get_device_id() { return static_cast<uint8_t>(midi_channel - 1); }
     static void add_checksum(std::vector<uint8_t>& msg);
     static void add_address(std::vector<uint8_t>& msg, const SysExAddress& addr);
+    static void add_header(std::vector<uint8_t>& msg, SysExCommand cmd);
 };
 
 } // namespace midi
@@ -19,12 +19,13 @@ public:
     // Handle button presses
     static void handle_button_press(uint8_t button);
 
+    // Update LED states based on selection, also once the UI hands the
+    // COMMON LEDs back
+    static void update_leds();
+
 private:
     static bool upper_selected;
     static bool lower_selected;
-
-    // Update LED states based on selection
-    static void update_leds();
 };
 
 } // namespace parameters
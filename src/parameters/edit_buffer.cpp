@@ -0,0 +1,66 @@
+#include "edit_buffer.h"
+
+namespace pg1000 {
+namespace parameters {
+
+// Static member initialization
+std::array<uint8_t, EditBuffer::SIZE> EditBuffer::image = {};
+std::array<uint8_t, (EditBuffer::SIZE + 7) / 8> EditBuffer::dirty = {};
+uint16_t EditBuffer::dirty_count = 0;
+
+void EditBuffer::set(uint16_t address, uint8_t value) {
+    if (!is_edit_address_valid(address)) return;
+
+    value &= 0x7F;
+    if (image[address] == value) return;
+    image[address] = value;
+
+    uint8_t mask = 1 << (address & 0x07);
+    if (!(dirty[address >> 3] & mask)) {
+        dirty[address >> 3] |= mask;
+        dirty_count++;
+    }
+}
+
+void EditBuffer::store(uint16_t address, uint8_t value) {
+    if (address >= SIZE) return;
+
+    // The synth's value wins over an edit that hasn't gone out yet
+    image[address] = value & 0x7F;
+    clear_dirty(address, 1);
+}
+
+void EditBuffer::clear_dirty(uint16_t address, uint16_t length) {
+    for (uint16_t addr = address; addr < address + length && addr < SIZE; addr++) {
+        uint8_t mask = 1 << (addr & 0x07);
+        if (dirty[addr >> 3] & mask) {
+            dirty[addr >> 3] &= ~mask;
+            dirty_count--;
+        }
+    }
+}
+
+bool EditBuffer::next_dirty_run(uint16_t from, uint16_t& start, uint16_t& length) {
+    if (dirty_count == 0) return false;
+
+    uint16_t addr = from;
+    while (addr < SIZE && !is_dirty(addr)) {
+        addr++;
+    }
+    if (addr >= SIZE) return false;
+
+    uint16_t block_end = (addr / EDIT_BLOCK_SIZE + 1) * EDIT_BLOCK_SIZE;
+    if (block_end > SIZE) block_end = SIZE;
+
+    uint16_t last = addr;
+    for (uint16_t next = addr + 1; next < block_end && next - last <= MERGE_GAP; next++) {
+        if (is_dirty(next)) last = next;
+    }
+
+    start = addr;
+    length = last - addr + 1;
+    return true;
+}
+
+} // namespace parameters
+} // namespace pg1000
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include "parameters.h"
+
+namespace pg1000 {
+namespace parameters {
+
+// The controller's copy of the D-50 edit buffer [00-00-00] - [00-03-24],
+// laid out like the synth's address map so bulk dumps and DT1 data land
+// in it unchanged. This is the only place parameter values are kept.
+//
+// Local edits set a dirty bit until they have been sent to the synth.
+// Data coming from the synth is stored clean.
+class EditBuffer {
+public:
+    static constexpr uint16_t SIZE = EDIT_BUFFER_SIZE;
+    static constexpr uint8_t MERGE_GAP = 10;  // DT1 overhead, shorter clean gaps are cheaper to resend
+
+    // Image access
+    static uint8_t get(uint16_t address) { return (address < SIZE) ? image[address] : 0; }
+    static const uint8_t* data() { return image.data(); }
+
+    // Local edit, marked dirty if the value changed. Reserved bytes are ignored.
+    static void set(uint16_t address, uint8_t value);
+
+    // Data from the synth
+    static void store(uint16_t address, uint8_t value);
+
+    // Dirty tracking
+    static bool is_dirty(uint16_t address) {
+        return address < SIZE && (dirty[address >> 3] & (1 << (address & 0x07)));
+    }
+    static bool has_dirty() { return dirty_count != 0; }
+    static uint16_t get_dirty_count() { return dirty_count; }
+    static void clear_dirty(uint16_t address, uint16_t length);
+
+    // Next run of dirty bytes at or after from, to go out as one DT1.
+    // Runs stay within a block and bridge clean gaps shorter than
+    // MERGE_GAP. Returns false if nothing from there on is dirty.
+    static bool next_dirty_run(uint16_t from, uint16_t& start, uint16_t& length);
+
+private:
+    static std::array<uint8_t, SIZE> image;
+    static std::array<uint8_t, (SIZE + 7) / 8> dirty;  // One bit per address
+    static uint16_t dirty_count;
+};
+
+} // namespace parameters
+} // namespace pg1000
@@ -0,0 +1,98 @@
+#include "edit_history.h"
+#include "edit_buffer.h"
+#include "../midi/address_map.h"
+#include "pico/time.h"
+
+namespace pg1000 {
+namespace parameters {
+
+// Static member initialization
+std::array<EditHistory::Record, EditHistory::CAPACITY> EditHistory::records;
+uint16_t EditHistory::first = 0;
+uint16_t EditHistory::count = 0;
+uint16_t EditHistory::position = 0;
+uint16_t EditHistory::coalesce_from = 0;
+
+void EditHistory::record(uint16_t address, uint8_t old_value, uint8_t new_value) {
+    record(address, old_value, new_value, time_us_32());
+}
+
+void EditHistory::record(uint16_t address, uint8_t old_value, uint8_t new_value, uint32_t now_us) {
+    if (old_value == new_value) return;
+
+    // A new edit ends the redo branch
+    count = position;
+
+    // Look back through the recent records, a macro pot moves several
+    // addresses in turn
+    for (uint16_t step = count; step > coalesce_from && count - step < COALESCE_DEPTH; step--) {
+        Record& recent = at(step - 1);
+        if (now_us - recent.time_us >= COALESCE_US) break;
+        if (recent.address != address) continue;
+
+        recent.new_value = new_value;
+        recent.time_us = now_us;
+        if (step == count && recent.new_value == recent.old_value) {
+            // Moved back to where it started, nothing left to undo
+            count--;
+            position--;
+            if (coalesce_from > count) coalesce_from = count;
+        }
+        return;
+    }
+
+    if (count == CAPACITY) {
+        first = (first + 1) % CAPACITY;
+        count--;
+        position--;
+        if (coalesce_from > 0) coalesce_from--;
+    }
+
+    at(count) = {address, old_value, new_value, now_us};
+    count++;
+    position = count;
+}
+
+uint16_t EditHistory::undo(uint16_t steps) {
+    uint16_t done = 0;
+    while (done < steps && position > 0) {
+        position--;
+        const Record& record = at(position);
+        apply(record.address, record.old_value);
+        done++;
+    }
+    coalesce_from = position;
+    return done;
+}
+
+uint16_t EditHistory::redo(uint16_t steps) {
+    uint16_t done = 0;
+    while (done < steps && position < count) {
+        const Record& record = at(position);
+        apply(record.address, record.new_value);
+        position++;
+        done++;
+    }
+    coalesce_from = position;
+    return done;
+}
+
+const EditHistory::Record* EditHistory::get_record(uint16_t step) {
+    return (step < count) ? &at(step) : nullptr;
+}
+
+void EditHistory::clear() {
+    first = 0;
+    count = 0;
+    position = 0;
+    coalesce_from = 0;
+}
+
+void EditHistory::apply(uint16_t address, uint8_t value) {
+    // Marked dirty, so several steps go out together as DT1 runs
+    EditBuffer::set(address, value);
+    midi::AddressMap::apply(address, 1);
+}
+
+} // namespace parameters
+} // namespace pg1000
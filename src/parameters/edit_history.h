@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+
+namespace pg1000 {
+namespace parameters {
+
+// Undo/redo history of local parameter edits, a fixed ring in RAM.
+//
+// Each record holds the edit buffer address with the value before and
+// after. Moves of the same parameter in quick succession extend the last
+// record instead of adding one, so a pot sweep is a single undo step
+// (a macro pot sweep is one record per target).
+// When the ring is full the oldest record is dropped.
+class EditHistory {
+public:
+    struct Record {
+        uint16_t address;
+        uint8_t old_value;
+        uint8_t new_value;
+        uint32_t time_us;  // Last change, for coalescing
+    };
+
+    static constexpr size_t MEMORY_BUDGET = 2048;  // Bytes of RAM for the ring
+    static constexpr size_t CAPACITY = MEMORY_BUDGET / sizeof(Record);
+    static constexpr uint32_t COALESCE_US = 500000;
+    static constexpr uint8_t COALESCE_DEPTH = 8;   // Recent records searched for the same address
+
+    static_assert(sizeof(Record) == 8, "Record should pack into 8 bytes");
+    static_assert(CAPACITY <= UINT16_MAX, "Ring positions are 16 bit");
+
+    // Called for every local edit that changed a value
+    static void record(uint16_t address, uint8_t old_value, uint8_t new_value);
+    static void record(uint16_t address, uint8_t old_value, uint8_t new_value, uint32_t now_us);
+
+    // Step back or forward through the history, writing the values into the
+    // edit buffer where they're picked up by MIDI::send_dirty(). Returns the
+    // number of steps taken.
+    static uint16_t undo(uint16_t steps = 1);
+    static uint16_t redo(uint16_t steps = 1);
+
+    static uint16_t get_undo_count() { return position; }
+    static uint16_t get_redo_count() { return count - position; }
+    static const Record* get_record(uint16_t step);  // 0 is the oldest
+
+    // Forget everything, e.g. after a patch was loaded
+    static void clear();
+
+private:
+    static std::array<Record, CAPACITY> records;
+    static uint16_t first;     // Ring index of the oldest record
+    static uint16_t count;     // Records held
+    static uint16_t position;  // Records applied, the rest can be redone
+    static uint16_t coalesce_from;  // Records from here on may still be extended
+
+    static Record& at(uint16_t step) { return records[(first + step) % CAPACITY]; }
+    static void apply(uint16_t address, uint8_t value);
+};
+
+} // namespace parameters
+} // namespace pg1000
@@ -0,0 +1,20 @@
+#include "factory_banks.h"
+
+namespace pg1000 {
+namespace parameters {
+
+const char* FactoryBanks::get_bank_name(uint8_t bank) {
+    return (bank < FACTORY_BANK_COUNT) ? FACTORY_BANKS[bank].name : nullptr;
+}
+
+uint8_t FactoryBanks::get_patch_count(uint8_t bank) {
+    return (bank < FACTORY_BANK_COUNT) ? FACTORY_BANKS[bank].count : 0;
+}
+
+PatchView FactoryBanks::get_patch(uint8_t bank, uint8_t patch) {
+    if (bank >= FACTORY_BANK_COUNT || patch >= FACTORY_BANKS[bank].count) return PatchView();
+    return PatchView(FACTORY_BANKS[bank].records + static_cast<uint32_t>(patch) * PatchView::SIZE);
+}
+
+} // namespace parameters
+} // namespace pg1000
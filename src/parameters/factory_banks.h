@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include "patch_view.h"
+
+namespace pg1000 {
+namespace parameters {
+
+// Read-only patch bank compiled into the firmware. The records are packed
+// PatchView::SIZE byte images, read in place from flash through XIP.
+struct FactoryBank {
+    const char* name;
+    const uint8_t* records;
+    uint8_t count;
+};
+
+// Generated from banks/*.syx by tools/syx2bank.py at build time
+extern const FactoryBank FACTORY_BANKS[];
+extern const uint8_t FACTORY_BANK_COUNT;
+
+class FactoryBanks {
+public:
+    static uint8_t get_bank_count() { return FACTORY_BANK_COUNT; }
+    static const char* get_bank_name(uint8_t bank);
+    static uint8_t get_patch_count(uint8_t bank);
+
+    // Empty view if bank or patch doesn't exist
+    static PatchView get_patch(uint8_t bank, uint8_t patch);
+};
+
+} // namespace parameters
+} // namespace pg1000
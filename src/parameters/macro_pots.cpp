@@ -0,0 +1,206 @@
+#include "macro_pots.h"
+#include "parameter_table.h"
+#include "pot_scaling.h"
+#include "edit_buffer.h"
+#include "../midi/address_map.h"
+#include "../hardware/adc.h"
+
+namespace pg1000 {
+namespace parameters {
+
+namespace {
+
+constexpr uint8_t CURVE_MAX = MacroPots::CURVE_STEPS - 1;
+
+// Curves come from the pot taper table, so macros and parameter pots
+// share one response. INVERTED is the linear taper read from the top.
+constexpr PotTaper taper_of(MacroCurve curve) {
+    switch (curve) {
+        case MacroCurve::EXPONENTIAL: return PotTaper::ANTILOG;
+        case MacroCurve::LOGARITHMIC: return PotTaper::LOG;
+        default:                      return PotTaper::LINEAR;
+    }
+}
+
+// Position 0-127 to 0-ADC_MAX along the curve
+constexpr uint16_t shape(MacroCurve curve, uint8_t position) {
+    uint16_t reading = static_cast<uint16_t>((position * pot_scaling::ADC_MAX + CURVE_MAX / 2) / CURVE_MAX);
+    if (curve == MacroCurve::INVERTED) reading = pot_scaling::ADC_MAX - reading;
+    return pot_scaling::TAPERS[static_cast<size_t>(taper_of(curve))][reading];
+}
+
+static_assert(shape(MacroCurve::EXPONENTIAL, CURVE_MAX) == pot_scaling::ADC_MAX &&
+              shape(MacroCurve::LOGARITHMIC, 0) == 0 && shape(MacroCurve::INVERTED, 0) == pot_scaling::ADC_MAX,
+              "Curves must span the whole range");
+
+constexpr bool names_equal(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+// Offset of a table parameter within its block, looked up by name
+constexpr uint8_t offset_of(const char* name) {
+    for (const auto& param : PARAMETERS) {
+        if (names_equal(param.name, name)) return param.offset;
+    }
+    return 0xFF;
+}
+
+constexpr MacroTarget target(ParamGroup group, const char* name, uint8_t min_value, uint8_t max_value, MacroCurve curve) {
+    return {static_cast<uint16_t>(get_group_base(group) + offset_of(name)), min_value, max_value, curve};
+}
+
+constexpr ParamGroup PARTIALS[] = {
+    ParamGroup::UPPER_PARTIAL_1, ParamGroup::UPPER_PARTIAL_2,
+    ParamGroup::LOWER_PARTIAL_1, ParamGroup::LOWER_PARTIAL_2
+};
+
+// Pots 46-54 are free, 55 is the morph pot
+constexpr std::array<Macro, 4> PRESETS = {{
+    {"Cutoff All", 46, 4, {{
+        target(PARTIALS[0], "TVF Cutoff Freq", 0, 100, MacroCurve::EXPONENTIAL),
+        target(PARTIALS[1], "TVF Cutoff Freq", 0, 100, MacroCurve::EXPONENTIAL),
+        target(PARTIALS[2], "TVF Cutoff Freq", 0, 100, MacroCurve::EXPONENTIAL),
+        target(PARTIALS[3], "TVF Cutoff Freq", 0, 100, MacroCurve::EXPONENTIAL),
+    }}},
+    {"Resonance All", 47, 4, {{
+        target(PARTIALS[0], "TVF Resonance", 0, 30, MacroCurve::LINEAR),
+        target(PARTIALS[1], "TVF Resonance", 0, 30, MacroCurve::LINEAR),
+        target(PARTIALS[2], "TVF Resonance", 0, 30, MacroCurve::LINEAR),
+        target(PARTIALS[3], "TVF Resonance", 0, 30, MacroCurve::LINEAR),
+    }}},
+    {"Brightness", 48, 8, {{
+        target(PARTIALS[0], "TVF Cutoff Freq", 30, 100, MacroCurve::LOGARITHMIC),
+        target(PARTIALS[1], "TVF Cutoff Freq", 30, 100, MacroCurve::LOGARITHMIC),
+        target(PARTIALS[2], "TVF Cutoff Freq", 30, 100, MacroCurve::LOGARITHMIC),
+        target(PARTIALS[3], "TVF Cutoff Freq", 30, 100, MacroCurve::LOGARITHMIC),
+        target(PARTIALS[0], "TVF ENV Depth", 0, 60, MacroCurve::LINEAR),
+        target(PARTIALS[1], "TVF ENV Depth", 0, 60, MacroCurve::LINEAR),
+        target(PARTIALS[2], "TVF ENV Depth", 0, 60, MacroCurve::LINEAR),
+        target(PARTIALS[3], "TVF ENV Depth", 0, 60, MacroCurve::LINEAR),
+    }}},
+    {"Chorus Mix", 49, 4, {{
+        target(ParamGroup::UPPER_COMMON, "Chorus Depth", 0, 100, MacroCurve::LINEAR),
+        target(ParamGroup::UPPER_COMMON, "Chorus Balance", 0, 100, MacroCurve::LINEAR),
+        target(ParamGroup::LOWER_COMMON, "Chorus Depth", 0, 100, MacroCurve::LINEAR),
+        target(ParamGroup::LOWER_COMMON, "Chorus Balance", 0, 100, MacroCurve::LINEAR),
+    }}},
+}};
+
+constexpr bool presets_valid() {
+    for (const auto& macro : PRESETS) {
+        if (macro.target_count > Macro::MAX_TARGETS) return false;
+        for (uint8_t i = 0; i < macro.target_count; i++) {
+            if (!is_edit_address_valid(macro.targets[i].address)) return false;
+        }
+    }
+    return true;
+}
+static_assert(presets_valid(), "Macro preset targets an unknown parameter or reserved byte");
+
+} // namespace
+
+// Static member initialization
+std::array<Macro, MacroPots::SLOT_COUNT> MacroPots::slots;
+
+void MacroPots::init() {
+    for (uint8_t slot = 0; slot < SLOT_COUNT; slot++) {
+        if (!load_preset(slot, slot)) clear(slot);
+    }
+}
+
+uint8_t MacroPots::get_preset_count() {
+    return PRESETS.size();
+}
+
+const Macro* MacroPots::get_preset(uint8_t preset) {
+    return (preset < PRESETS.size()) ? &PRESETS[preset] : nullptr;
+}
+
+bool MacroPots::load_preset(uint8_t slot, uint8_t preset) {
+    if (slot >= SLOT_COUNT || preset >= PRESETS.size()) return false;
+    slots[slot] = PRESETS[preset];
+    return true;
+}
+
+bool MacroPots::set_pot(uint8_t slot, uint8_t pot) {
+    if (slot >= SLOT_COUNT) return false;
+    slots[slot].pot = pot;
+    return true;
+}
+
+bool MacroPots::set_target(uint8_t slot, uint8_t index, const MacroTarget& target) {
+    if (slot >= SLOT_COUNT || index >= Macro::MAX_TARGETS) return false;
+    if (!is_edit_address_valid(target.address) || target.curve >= MacroCurve::COUNT) return false;
+    slots[slot].targets[index] = target;
+    return true;
+}
+
+bool MacroPots::set_target_count(uint8_t slot, uint8_t count) {
+    if (slot >= SLOT_COUNT || count > Macro::MAX_TARGETS) return false;
+    slots[slot].target_count = count;
+    return true;
+}
+
+void MacroPots::clear(uint8_t slot) {
+    if (slot >= SLOT_COUNT) return;
+    slots[slot] = {"", NO_POT, 0, {}};
+}
+
+uint8_t MacroPots::map(const MacroTarget& target, uint8_t position) {
+    if (position > CURVE_MAX) position = CURVE_MAX;
+    int shaped = shape(target.curve, position);
+
+    // max_value below min_value runs the target backwards
+    constexpr int full = pot_scaling::ADC_MAX;
+    int span = static_cast<int>(target.max_value) - target.min_value;
+    int offset = (span * shaped + (span >= 0 ? full / 2 : -full / 2)) / full;
+    return static_cast<uint8_t>(target.min_value + offset);
+}
+
+bool MacroPots::apply(uint8_t pot, uint8_t position) {
+    bool changed = false;
+    for (const auto& macro : slots) {
+        if (macro.pot != pot) continue;
+        for (uint8_t i = 0; i < macro.target_count; i++) {
+            const MacroTarget& target = macro.targets[i];
+            uint8_t value = map(target, position);
+            if (EditBuffer::get(target.address) == value) continue;
+
+            set_edit_value(target.address, value);
+            midi::AddressMap::apply(target.address, 1);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool MacroPots::update() {
+    bool changed = false;
+
+    for (uint8_t slot = 0; slot < SLOT_COUNT; slot++) {
+        uint8_t pot = slots[slot].pot;
+        if (pot == NO_POT || slots[slot].target_count == 0) continue;
+
+        // A pot shared by several slots is read once, apply() covers them all
+        bool seen = false;
+        for (uint8_t other = 0; other < slot; other++) {
+            if (slots[other].pot == pot) seen = true;
+        }
+        if (seen) continue;
+
+        uint8_t chip = pot / hardware::ADC::CHANNELS_PER_CHIP;
+        uint8_t channel = pot % hardware::ADC::CHANNELS_PER_CHIP;
+        if (hardware::ADC::has_changed(chip, channel)) {
+            uint8_t position = hardware::ADC::get_value(chip, channel) * CURVE_STEPS / (hardware::ADC::MAX_VALUE + 1);
+            if (apply(pot, position)) changed = true;
+        }
+    }
+    return changed;
+}
+
+} // namespace parameters
+} // namespace pg1000
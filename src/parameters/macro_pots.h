@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include "parameters.h"
+
+namespace pg1000 {
+namespace parameters {
+
+// Response curves, the pot taper curves of pot_scaling.h
+enum class MacroCurve : uint8_t {
+    LINEAR,
+    EXPONENTIAL,   // Slow start, fine control at the low end
+    LOGARITHMIC,   // Fast start, fine control at the high end
+    INVERTED,      // Full at the bottom, falls linearly
+    COUNT
+};
+
+// One parameter driven by a macro, in raw edit buffer units
+struct MacroTarget {
+    uint16_t address;
+    uint8_t min_value;   // Value at the bottom of the pot
+    uint8_t max_value;   // Value at the top
+    MacroCurve curve;
+};
+
+// A pot driving several targets. Targets don't have to be in the
+// parameter table, so one macro can reach all four partials.
+struct Macro {
+    static constexpr uint8_t MAX_TARGETS = 8;
+
+    const char* name;
+    uint8_t pot;
+    uint8_t target_count;
+    std::array<MacroTarget, MAX_TARGETS> targets;
+};
+
+class MacroPots {
+public:
+    static constexpr uint8_t SLOT_COUNT = 4;
+    static constexpr uint8_t NO_POT = 0xFF;
+    static constexpr uint8_t CURVE_STEPS = 128;  // Pot resolution fed through the curves
+
+    // Fill the slots from the presets
+    static void init();
+
+    // Built-in mappings
+    static uint8_t get_preset_count();
+    static const Macro* get_preset(uint8_t preset);
+
+    // Runtime table
+    static bool load_preset(uint8_t slot, uint8_t preset);
+    static bool set_pot(uint8_t slot, uint8_t pot);
+    static bool set_target(uint8_t slot, uint8_t index, const MacroTarget& target);
+    static bool set_target_count(uint8_t slot, uint8_t count);
+    static void clear(uint8_t slot);
+    static const Macro* get_slot(uint8_t slot) { return slot < SLOT_COUNT ? &slots[slot] : nullptr; }
+
+    // Value of one target for a pot position in 0-127
+    static uint8_t map(const MacroTarget& target, uint8_t position);
+
+    // Apply a pot position to every macro on that pot, true if any
+    // target changed
+    static bool apply(uint8_t pot, uint8_t position);
+
+    // Read the macro pots once per scan, true if anything changed. The
+    // edits of the whole scan are left dirty together, so one
+    // MIDI::send_dirty() sends them as the fewest DT1 messages.
+    static bool update();
+
+private:
+    static std::array<Macro, SLOT_COUNT> slots;
+};
+
+} // namespace parameters
+} // namespace pg1000
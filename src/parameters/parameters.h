@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 #include <array>
 
 namespace pg1000 {
@@ -29,26 +30,59 @@ enum class ParamGroup {
 };
 
 
-// Parameter definition
+// Edit buffer layout [00-00-00] - [00-03-24], linear addresses
+// (7 bits per address byte)
+static constexpr uint16_t EDIT_BUFFER_SIZE = 421;
+static constexpr uint8_t EDIT_BLOCK_SIZE = 64;   // Each partial/common/patch block starts on a multiple of 64
+
+// Used bytes at the start of each block, the rest of the block is reserved
+static constexpr std::array<uint8_t, 7> EDIT_BLOCK_LENGTHS = {54, 54, 48, 54, 54, 48, 37};
+
+// Parameter definition. The table is constexpr and stays in flash; the
+// values live in the edit buffer (see EditBuffer).
 
 struct Parameter {
     const char* name;           // Parameter name
     ParamGroup group;          // Which section this belongs to
     ParamType type;           // Parameter type
-    uint8_t id;              // Unique parameter identifier
-    union {
-        uint8_t partial_offset; // Offset for partial parameters (WG, TVF, TVA)
-        uint8_t common_offset;  // Offset for common parameters
-        uint8_t patch_offset;   // Offset for patch parameters
-    };
-    uint8_t value;            // Current value
-    uint8_t prev_value;       // Previous value
+    uint8_t offset;           // Offset from the group's base address
     int8_t min_value;        // Minimum allowed value
     int8_t max_value;        // Maximum allowed value
     uint8_t pot_number;       // Which potentiometer controls this
     bool active;             // Is this parameter currently active?
 };
 
+// Linear base address of a parameter group
+constexpr uint16_t get_group_base(ParamGroup group) {
+    switch (group) {
+        case ParamGroup::UPPER_PARTIAL_1: return 0;
+        case ParamGroup::UPPER_PARTIAL_2: return 64;
+        case ParamGroup::UPPER_COMMON:
+        case ParamGroup::COMMON:          return 128;  // Shared settings live in the upper common block
+        case ParamGroup::LOWER_PARTIAL_1: return 192;
+        case ParamGroup::LOWER_PARTIAL_2: return 256;
+        case ParamGroup::LOWER_COMMON:    return 320;
+        case ParamGroup::PATCH:           return 384;
+    }
+    return 0;
+}
+
+constexpr bool is_partial_group(ParamGroup group) {
+    return group == ParamGroup::UPPER_PARTIAL_1 || group == ParamGroup::UPPER_PARTIAL_2 ||
+           group == ParamGroup::LOWER_PARTIAL_1 || group == ParamGroup::LOWER_PARTIAL_2;
+}
+
+// Linear edit buffer address of a parameter
+constexpr uint16_t get_edit_address(const Parameter& param) {
+    return get_group_base(param.group) + param.offset;
+}
+
+// True if the address holds data rather than a reserved byte
+constexpr bool is_edit_address_valid(uint16_t address) {
+    return address < EDIT_BUFFER_SIZE &&
+           (address % EDIT_BLOCK_SIZE) < EDIT_BLOCK_LENGTHS[address / EDIT_BLOCK_SIZE];
+}
+
 // Parameter value filtering state
 struct ParameterState {
     float current_value;
@@ -59,7 +93,18 @@ struct ParameterState {
 int get_parameter_count();
 const Parameter* get_parameter(int index);
 const Parameter* get_parameter_by_pot(uint8_t pot_number);
+int get_parameter_index(const Parameter* param);  // -1 if not in the table
+
+// Values, kept in the edit buffer. Partial parameters follow the
+// PartialSelector: they're read from the first selected partial and
+// written to all of them.
+uint16_t get_parameter_address(const Parameter* param);
+uint8_t get_parameter_value(const Parameter* param);
+void set_parameter_value(const Parameter* param, uint8_t value);  // Unfiltered local edit, marked dirty
 void update_parameter_value(const Parameter* param, uint8_t new_value);
+void set_edit_value(uint16_t address, uint8_t value);  // Local edit of any edit buffer byte, marked dirty
+void sync_parameter_filter(int index);  // Value changed by the synth
+void sync_parameter_filter(int index, uint16_t address);  // Only if the pots read from address
 float get_filtered_value(const Parameter* param);
 
 } // namespace pg1000
@@ -4,16 +4,10 @@ namespace pg1000 {
 namespace parameters {
 
 // Static member initialization
-bool PartialSelector::upper1_selected = false;
-bool PartialSelector::upper2_selected = false;
-bool PartialSelector::lower1_selected = false;
-bool PartialSelector::lower2_selected = false;
+uint8_t PartialSelector::selection = 0;
 
 void PartialSelector::init() {
-    upper1_selected = false;
-    upper2_selected = false;
-    lower1_selected = false;
-    lower2_selected = false;
+    selection = 0;
     update_leds();
 }
 
@@ -36,31 +30,36 @@ void PartialSelector::update() {
 void PartialSelector::handle_button_press(uint8_t button) {
     switch (button) {
         case hardware::GPIO::BTN_PARTIAL_UP1:
-            upper1_selected = !upper1_selected;
+            selection ^= UPPER1;
             break;
         case hardware::GPIO::BTN_PARTIAL_UP2:
-            upper2_selected = !upper2_selected;
+            selection ^= UPPER2;
             break;
         case hardware::GPIO::BTN_PARTIAL_LOW1:
-            lower1_selected = !lower1_selected;
+            selection ^= LOWER1;
             break;
         case hardware::GPIO::BTN_PARTIAL_LOW2:
-            lower2_selected = !lower2_selected;
+            selection ^= LOWER2;
             break;
     }
     update_leds();
+
+    // Pot filters pick up from the newly targeted partial
+    for (int i = 0; i < get_parameter_count(); i++) {
+        if (is_partial_group(get_parameter(i)->group)) sync_parameter_filter(i);
+    }
 }
 
 bool PartialSelector::is_partial_selected(ParamGroup group) {
     switch (group) {
         case ParamGroup::UPPER_PARTIAL_1:
-            return upper1_selected;
+            return is_upper1_selected();
         case ParamGroup::UPPER_PARTIAL_2:
-            return upper2_selected;
+            return is_upper2_selected();
         case ParamGroup::LOWER_PARTIAL_1:
-            return lower1_selected;
+            return is_lower1_selected();
         case ParamGroup::LOWER_PARTIAL_2:
-            return lower2_selected;
+            return is_lower2_selected();
         default:
             return true;  // Non-partial parameters are always available
     }
@@ -68,13 +67,13 @@ bool PartialSelector::is_partial_selected(ParamGroup group) {
 
 void PartialSelector::update_leds() {
     hardware::GPIO::set_led(hardware::GPIO::LED_PARTIAL_UP1, 
-        upper1_selected ? hardware::LedState::ON : hardware::LedState::OFF);
+        is_upper1_selected() ? hardware::LedState::ON : hardware::LedState::OFF);
     hardware::GPIO::set_led(hardware::GPIO::LED_PARTIAL_UP2, 
-        upper2_selected ? hardware::LedState::ON : hardware::LedState::OFF);
+        is_upper2_selected() ? hardware::LedState::ON : hardware::LedState::OFF);
     hardware::GPIO::set_led(hardware::GPIO::LED_PARTIAL_LOW1, 
-        lower1_selected ? hardware::LedState::ON : hardware::LedState::OFF);
+        is_lower1_selected() ? hardware::LedState::ON : hardware::LedState::OFF);
     hardware::GPIO::set_led(hardware::GPIO::LED_PARTIAL_LOW2, 
-        lower2_selected ? hardware::LedState::ON : hardware::LedState::OFF);
+        is_lower2_selected() ? hardware::LedState::ON : hardware::LedState::OFF);
 }
 
 } // namespace parameters
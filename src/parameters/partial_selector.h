@@ -1,35 +1,72 @@
 #pragma once
 
+#include <cstdint>
+#include <array>
 #include "../hardware/gpio.h"
 #include "parameters.h"
 
 namespace pg1000 {
 namespace parameters {
 
+// Edit buffer block bases a partial parameter is written to
+struct PartialTargets {
+    uint8_t count;
+    std::array<uint16_t, 4> bases;
+};
+
+// Target set for each selection (bit 0 Upper 1 .. bit 3 Lower 2), Upper 1
+// when none is selected
+constexpr std::array<PartialTargets, 16> build_partial_targets() {
+    constexpr ParamGroup partials[] = {
+        ParamGroup::UPPER_PARTIAL_1, ParamGroup::UPPER_PARTIAL_2,
+        ParamGroup::LOWER_PARTIAL_1, ParamGroup::LOWER_PARTIAL_2
+    };
+    std::array<PartialTargets, 16> sets{};
+    for (uint8_t mask = 0; mask < sets.size(); mask++) {
+        uint8_t selected = mask ? mask : 0x01;
+        for (uint8_t partial = 0; partial < 4; partial++) {
+            if (selected & (1 << partial)) {
+                sets[mask].bases[sets[mask].count++] = get_group_base(partials[partial]);
+            }
+        }
+    }
+    return sets;
+}
+
+inline constexpr std::array<PartialTargets, 16> PARTIAL_TARGETS = build_partial_targets();
+
+// Which partials the partial pots edit. With several selected, one pot
+// move writes the same value to each of them.
 class PartialSelector {
 public:
     static void init();
     static void update();
     
     // Selection state queries
-    static bool is_upper1_selected() { return upper1_selected; }
-    static bool is_upper2_selected() { return upper2_selected; }
-    static bool is_lower1_selected() { return lower1_selected; }
-    static bool is_lower2_selected() { return lower2_selected; }
+    static bool is_upper1_selected() { return selection & UPPER1; }
+    static bool is_upper2_selected() { return selection & UPPER2; }
+    static bool is_lower1_selected() { return selection & LOWER1; }
+    static bool is_lower2_selected() { return selection & LOWER2; }
     
     // Group selection checks
-    static bool is_any_upper_selected() { return upper1_selected || upper2_selected; }
-    static bool is_any_lower_selected() { return lower1_selected || lower2_selected; }
+    static bool is_any_upper_selected() { return selection & (UPPER1 | UPPER2); }
+    static bool is_any_lower_selected() { return selection & (LOWER1 | LOWER2); }
     static bool is_partial_selected(ParamGroup group);
 
+    // Partials the pots write to. Every selection's set is built at
+    // compile time, so retargeting the pots is just a change of index.
+    static const PartialTargets& get_targets() { return PARTIAL_TARGETS[selection]; }
+
     // Handle button presses
     static void handle_button_press(uint8_t button);
 
 private:
-    static bool upper1_selected;
-    static bool upper2_selected;
-    static bool lower1_selected;
-    static bool lower2_selected;
+    static constexpr uint8_t UPPER1 = 0x01;
+    static constexpr uint8_t UPPER2 = 0x02;
+    static constexpr uint8_t LOWER1 = 0x04;
+    static constexpr uint8_t LOWER2 = 0x08;
+
+    static uint8_t selection;  // UPPER1 | UPPER2 | LOWER1 | LOWER2
 
     // Update LED states based on selection
     static void update_leds();
@@ -0,0 +1,58 @@
+#include "patch_codec.h"
+
+namespace pg1000 {
+namespace parameters {
+
+int PatchCodec::encode(const uint8_t* image, const uint8_t* reference, uint8_t* out, uint16_t max_length) {
+    auto ref = [reference](uint16_t address) -> uint8_t {
+        return reference ? reference[address] : 0;
+    };
+
+    uint16_t length = 0;
+    uint16_t address = 0;
+
+    while (true) {
+        // Unchanged bytes
+        uint16_t start = address;
+        while (address < SIZE && image[address] == ref(address)) {
+            address++;
+        }
+        if (address >= SIZE) break;  // Rest matches the reference
+
+        uint16_t skip = address - start;
+        while (skip > MAX_RUN) {
+            if (length + RUN_OVERHEAD > max_length) return -1;
+            if (out) {
+                out[length] = MAX_RUN;
+                out[length + 1] = 0;
+            }
+            length += RUN_OVERHEAD;
+            skip -= MAX_RUN;
+        }
+
+        // Changed bytes, carrying on over gaps too short to be worth a new run
+        uint16_t last = address;
+        for (uint16_t next = address + 1;
+             next < SIZE && next - address < MAX_RUN && next - last <= RUN_OVERHEAD;
+             next++) {
+            if (image[next] != ref(next)) last = next;
+        }
+        uint16_t count = last - address + 1;
+
+        if (length + RUN_OVERHEAD + count > max_length) return -1;
+        if (out) {
+            out[length] = static_cast<uint8_t>(skip);
+            out[length + 1] = static_cast<uint8_t>(count);
+            for (uint16_t i = 0; i < count; i++) {
+                out[length + RUN_OVERHEAD + i] = image[address + i];
+            }
+        }
+        length += RUN_OVERHEAD + count;
+        address = last + 1;
+    }
+
+    return length;
+}
+
+} // namespace parameters
+} // namespace pg1000
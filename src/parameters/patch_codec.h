@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include "parameters.h"
+
+namespace pg1000 {
+namespace parameters {
+
+// Delta coding of a patch image against a reference image, as runs of
+//
+//   skip, count, count literal bytes
+//
+// where skip is the number of bytes equal to the reference. Bytes after
+// the last run are equal to the reference, so an unchanged patch encodes
+// to nothing. A null reference means an all-zero image.
+class PatchCodec {
+public:
+    static constexpr uint16_t SIZE = EDIT_BUFFER_SIZE;
+    static constexpr uint8_t RUN_OVERHEAD = 2;  // Skip and count bytes
+    static constexpr uint8_t MAX_RUN = 255;
+
+    // Encoded length, or -1 if it would exceed max_length. With a null
+    // out only the length is worked out.
+    static int encode(const uint8_t* image, const uint8_t* reference, uint8_t* out, uint16_t max_length);
+
+    // Calls put(address, value) for every byte of the image in order.
+    // False on malformed data, possibly after some bytes were put.
+    template <typename Put>
+    static bool decode(const uint8_t* data, uint16_t length, const uint8_t* reference, Put&& put) {
+        uint16_t address = 0;
+        uint16_t pos = 0;
+
+        while (pos < length) {
+            if (length - pos < RUN_OVERHEAD) return false;
+            uint8_t skip = data[pos++];
+            uint8_t count = data[pos++];
+            if (address + skip + count > SIZE || length - pos < count) return false;
+
+            for (uint8_t i = 0; i < skip; i++, address++) {
+                put(address, reference ? reference[address] : 0);
+            }
+            for (uint8_t i = 0; i < count; i++, address++) {
+                put(address, data[pos++]);
+            }
+        }
+
+        for (; address < SIZE; address++) {
+            put(address, reference ? reference[address] : 0);
+        }
+        return true;
+    }
+
+    static bool decode(const uint8_t* data, uint16_t length, const uint8_t* reference, uint8_t* image) {
+        return decode(data, length, reference, [image](uint16_t address, uint8_t value) { image[address] = value; });
+    }
+};
+
+} // namespace parameters
+} // namespace pg1000
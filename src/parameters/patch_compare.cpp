@@ -0,0 +1,67 @@
+#include "patch_compare.h"
+#include "edit_buffer.h"
+#include "../midi/address_map.h"
+#include "../midi/sysex.h"
+#include "../hardware/hardware.h"
+#include <cstring>
+#include <cstdio>
+
+namespace pg1000 {
+namespace parameters {
+
+// Start, 8 data bits and stop per MIDI byte
+static constexpr uint32_t BYTE_TIME_US = 10 * 1000000 / hardware::Config::MIDI_BAUD_RATE;
+
+// Static member initialization
+std::array<uint8_t, PatchCompare::SIZE> PatchCompare::original = {};
+std::array<uint8_t, PatchCompare::SIZE> PatchCompare::edited = {};
+bool PatchCompare::comparing = false;
+PatchCompare::Transfer PatchCompare::last_transfer = {};
+
+void PatchCompare::capture() {
+    memcpy(original.data(), EditBuffer::data(), SIZE);
+    comparing = false;
+}
+
+const PatchCompare::Transfer& PatchCompare::toggle() {
+    if (comparing) {
+        load(edited);
+    } else {
+        memcpy(edited.data(), EditBuffer::data(), SIZE);
+        load(original);
+    }
+    comparing = !comparing;
+
+    // Same runs as MIDI::send_dirty() will send
+    last_transfer = {};
+    last_transfer.bytes = EditBuffer::get_dirty_count();
+    uint16_t start;
+    uint16_t length;
+    uint16_t from = 0;
+    while (EditBuffer::next_dirty_run(from, start, length)) {
+        last_transfer.messages++;
+        last_transfer.wire_bytes += length + midi::SysExConst::DATA_OVERHEAD;
+        from = start + length;
+    }
+    last_transfer.wire_us = last_transfer.wire_bytes * BYTE_TIME_US;
+
+    printf("Compare %s: %u bytes changed, %u DT1, %u bytes in %lu us\n",
+           comparing ? "original" : "edit", last_transfer.bytes, last_transfer.messages,
+           last_transfer.wire_bytes, static_cast<unsigned long>(last_transfer.wire_us));
+    return last_transfer;
+}
+
+void PatchCompare::leave() {
+    if (comparing) toggle();
+}
+
+void PatchCompare::load(const std::array<uint8_t, SIZE>& image) {
+    // Unchanged bytes stay clean
+    for (uint16_t address = 0; address < SIZE; address++) {
+        EditBuffer::set(address, image[address]);
+    }
+    midi::AddressMap::apply(0, SIZE);
+}
+
+} // namespace parameters
+} // namespace pg1000
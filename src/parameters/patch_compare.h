@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include "parameters.h"
+
+namespace pg1000 {
+namespace parameters {
+
+// A/B compare between the edited patch and the patch as it was loaded.
+//
+// Toggling writes the other image into the edit buffer, which marks just
+// the bytes that differ dirty. MIDI::send_dirty() then sends those as the
+// fewest DT1 messages, so the switch costs the difference, not a dump.
+class PatchCompare {
+public:
+    static constexpr uint16_t SIZE = EDIT_BUFFER_SIZE;
+
+    // What the last toggle put on the wire
+    struct Transfer {
+        uint16_t bytes;     // Changed bytes
+        uint8_t messages;   // DT1 messages
+        uint16_t wire_bytes;
+        uint32_t wire_us;   // At the MIDI baud rate
+    };
+
+    // Take the edit buffer as the original, after a patch was loaded
+    static void capture();
+
+    // Switch between the edit and the original. Call MIDI::send_dirty()
+    // afterwards to send the difference.
+    static const Transfer& toggle();
+
+    // Back to the edit if the original is showing, before editing again
+    static void leave();
+
+    static bool is_comparing() { return comparing; }
+    static const Transfer& get_last_transfer() { return last_transfer; }
+
+private:
+    static std::array<uint8_t, SIZE> original;
+    static std::array<uint8_t, SIZE> edited;  // Held while the original is showing
+    static bool comparing;
+    static Transfer last_transfer;
+
+    static void load(const std::array<uint8_t, SIZE>& image);
+};
+
+} // namespace parameters
+} // namespace pg1000
@@ -0,0 +1,309 @@
+#include "patch_library.h"
+#include "edit_buffer.h"
+#include "edit_history.h"
+#include "patch_compare.h"
+#include "patch_codec.h"
+#include "factory_banks.h"
+#include "pico/time.h"
+#include <cstring>
+#include <cstdio>
+
+namespace pg1000 {
+namespace parameters {
+
+using hardware::Flash;
+
+// Static member initialization
+std::array<uint32_t, PatchLibrary::PATCH_COUNT> PatchLibrary::index;
+uint8_t PatchLibrary::active_half = 0;
+uint32_t PatchLibrary::generation = 0;
+uint32_t PatchLibrary::write_offset = PatchLibrary::HALF_SIZE;
+uint32_t PatchLibrary::next_sequence = 0;
+uint32_t PatchLibrary::last_recall_us = 0;
+std::array<uint8_t, PatchLibrary::PATCH_SIZE> PatchLibrary::image_buffer;
+std::array<uint8_t, Flash::page_align(PatchLibrary::MAX_RECORD_SIZE) + Flash::PAGE_SIZE> PatchLibrary::page_buffer;
+
+void PatchLibrary::init() {
+    index.fill(NO_RECORD);
+    generation = 0;
+    write_offset = HALF_SIZE;
+    next_sequence = 0;
+
+    uint32_t generation0 = 0;
+    uint32_t generation1 = 0;
+    bool valid0 = read_half_header(0, generation0);
+    bool valid1 = read_half_header(1, generation1);
+
+    if (!valid0 && !valid1) {
+        printf("Patch library empty, formatting\n");
+        if (!Flash::erase(half_offset(0), HALF_SIZE) || !write_half(0, 1)) return;
+        active_half = 0;
+        generation = 1;
+        write_offset = FIRST_RECORD;
+        return;
+    }
+
+    active_half = (valid1 && (!valid0 || generation1 > generation0)) ? 1 : 0;
+    generation = active_half ? generation1 : generation0;
+    scan_half();
+
+    printf("Patch library: %d patches, %lu/%lu bytes stored, generation %lu, %lu bytes free\n",
+           get_used_count(), static_cast<unsigned long>(get_stored_bytes()),
+           static_cast<unsigned long>(get_raw_bytes()), static_cast<unsigned long>(generation),
+           static_cast<unsigned long>(get_free_space()));
+}
+
+bool PatchLibrary::load(uint8_t patch, uint8_t* image) {
+    if (!is_used(patch) || !image) return false;
+    return decode(index[patch], image);
+}
+
+uint8_t PatchLibrary::get_used_count() {
+    uint8_t count = 0;
+    for (uint32_t offset : index) {
+        if (offset != NO_RECORD) count++;
+    }
+    return count;
+}
+
+uint32_t PatchLibrary::get_stored_bytes() {
+    uint32_t bytes = 0;
+    for (uint32_t offset : index) {
+        if (offset == NO_RECORD) continue;
+        RecordHeader header;
+        memcpy(&header, Flash::read(offset), sizeof(header));
+        bytes += record_align(sizeof(RecordHeader) + header.length);
+    }
+    return bytes;
+}
+
+bool PatchLibrary::save(uint8_t patch) {
+    return save(patch, EditBuffer::data());
+}
+
+bool PatchLibrary::save(uint8_t patch, const uint8_t* image) {
+    if (patch >= PATCH_COUNT || !image || generation == 0) return false;
+
+    RecordHeader header = {RECORD_MAGIC, FORMAT_VERSION, patch, 0, PATCH_SIZE, Encoding::RAW,
+                           NO_REFERENCE, NO_REFERENCE, {0xFF, 0xFF, 0xFF}, 0, 0};
+
+    // Smallest delta against the zero image or any factory patch, raw if
+    // nothing beats the image itself
+    int best = PatchCodec::encode(image, nullptr, nullptr, PATCH_SIZE - 1);
+    if (best >= 0) header.encoding = Encoding::DELTA;
+
+    for (uint8_t bank = 0; bank < FactoryBanks::get_bank_count() && best != 0; bank++) {
+        for (uint8_t number = 0; number < FactoryBanks::get_patch_count(bank) && best != 0; number++) {
+            uint16_t limit = (best >= 0 ? best : PATCH_SIZE) - 1;
+            int length = PatchCodec::encode(image, FactoryBanks::get_patch(bank, number).data(), nullptr, limit);
+            if (length < 0) continue;
+
+            best = length;
+            header.encoding = Encoding::DELTA;
+            header.reference_bank = bank;
+            header.reference_patch = number;
+        }
+    }
+
+    const uint8_t* data = image;
+    if (header.encoding == Encoding::DELTA) {
+        const uint8_t* reference = nullptr;
+        get_reference(header, reference);
+        header.length = PatchCodec::encode(image, reference, image_buffer.data(), PATCH_SIZE);
+        data = image_buffer.data();
+    }
+    header.image_crc = crc32(0, image, PATCH_SIZE);
+
+    if (write_offset + record_align(sizeof(RecordHeader) + header.length) > HALF_SIZE && !compact()) {
+        printf("Patch library compaction failed\n");
+        return false;
+    }
+    header.sequence = next_sequence++;
+    return append(header, data);
+}
+
+bool PatchLibrary::recall(uint8_t patch) {
+    uint32_t start = time_us_32();
+    if (!load(patch, image_buffer.data())) return false;
+
+    // Unchanged bytes stay clean
+    for (uint16_t address = 0; address < PATCH_SIZE; address++) {
+        EditBuffer::set(address, image_buffer[address]);
+    }
+    for (int i = 0; i < get_parameter_count(); i++) {
+        sync_parameter_filter(i);
+    }
+    EditHistory::clear();
+    PatchCompare::capture();
+    last_recall_us = time_us_32() - start;
+    return true;
+}
+
+bool PatchLibrary::read_half_header(uint8_t half, uint32_t& half_generation) {
+    HalfHeader header;
+    memcpy(&header, Flash::read(half_offset(half)), sizeof(header));
+
+    if (header.magic != HALF_MAGIC || header.version != FORMAT_VERSION) return false;
+    if (crc32(0, reinterpret_cast<const uint8_t*>(&header), offsetof(HalfHeader, crc)) != header.crc) return false;
+
+    half_generation = header.generation;
+    return true;
+}
+
+bool PatchLibrary::write_half(uint8_t half, uint32_t half_generation) {
+    HalfHeader header = {HALF_MAGIC, FORMAT_VERSION, 0xFF, half_generation, 0};
+    header.crc = crc32(0, reinterpret_cast<const uint8_t*>(&header), offsetof(HalfHeader, crc));
+
+    page_buffer.fill(0xFF);
+    memcpy(page_buffer.data(), &header, sizeof(header));
+    return Flash::program(half_offset(half), page_buffer.data(), Flash::PAGE_SIZE);
+}
+
+void PatchLibrary::scan_half() {
+    uint32_t base = half_offset(active_half);
+    uint32_t offset = FIRST_RECORD;
+
+    while (offset + sizeof(RecordHeader) <= HALF_SIZE) {
+        RecordHeader header;
+        memcpy(&header, Flash::read(base + offset), sizeof(header));
+
+        if (header.magic == 0xFFFF) break;  // Erased, end of the log
+
+        if (header.magic != RECORD_MAGIC || header.length > PATCH_SIZE) {
+            // No way to find the next record, so don't append after this;
+            // the next save compacts into the other half
+            printf("Patch library: bad record at %lu\n", static_cast<unsigned long>(offset));
+            offset = HALF_SIZE;
+            break;
+        }
+
+        // Records that fail the check (interrupted writes) are skipped
+        if (check_record(base + offset, header)) {
+            index[header.patch] = base + offset;
+            if (header.sequence >= next_sequence) next_sequence = header.sequence + 1;
+        }
+        offset += record_align(sizeof(RecordHeader) + header.length);
+    }
+
+    write_offset = (offset < HALF_SIZE) ? offset : HALF_SIZE;
+}
+
+bool PatchLibrary::check_record(uint32_t offset, RecordHeader& header) {
+    memcpy(&header, Flash::read(offset), sizeof(header));
+
+    if (header.magic != RECORD_MAGIC || header.version != FORMAT_VERSION) return false;
+    if (header.patch >= PATCH_COUNT || header.length > PATCH_SIZE) return false;
+    if (header.encoding == Encoding::RAW ? header.length != PATCH_SIZE : header.encoding != Encoding::DELTA) return false;
+
+    uint32_t crc = crc32(0, reinterpret_cast<const uint8_t*>(&header), offsetof(RecordHeader, crc));
+    crc = crc32(crc, Flash::read(offset) + sizeof(header), header.length);
+    return crc == header.crc;
+}
+
+bool PatchLibrary::get_reference(const RecordHeader& header, const uint8_t*& reference) {
+    if (header.reference_bank == NO_REFERENCE) {
+        reference = nullptr;
+        return true;
+    }
+    // A delta against a factory patch that's no longer built in can't be decoded
+    reference = FactoryBanks::get_patch(header.reference_bank, header.reference_patch).data();
+    return reference != nullptr;
+}
+
+bool PatchLibrary::decode(uint32_t offset, uint8_t* image) {
+    RecordHeader header;
+    memcpy(&header, Flash::read(offset), sizeof(header));
+    const uint8_t* data = Flash::read(offset) + sizeof(header);
+
+    if (header.encoding == Encoding::RAW) {
+        memcpy(image, data, PATCH_SIZE);
+    } else {
+        const uint8_t* reference = nullptr;
+        if (!get_reference(header, reference)) return false;
+        if (!PatchCodec::decode(data, header.length, reference, image)) return false;
+    }
+
+    // Also catches a factory bank that changed since the patch was saved
+    return crc32(0, image, PATCH_SIZE) == header.image_crc;
+}
+
+bool PatchLibrary::append(const RecordHeader& header, const uint8_t* data) {
+    uint32_t size = sizeof(RecordHeader) + header.length;
+    if (write_offset + record_align(size) > HALF_SIZE) return false;
+
+    // Put the record straight where program_record() wants it
+    uint8_t* record = page_buffer.data() + (write_offset & (Flash::PAGE_SIZE - 1));
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), data, header.length);
+
+    uint32_t crc = crc32(0, record, offsetof(RecordHeader, crc));
+    crc = crc32(crc, data, header.length);
+    memcpy(record + offsetof(RecordHeader, crc), &crc, sizeof(crc));
+
+    uint32_t offset = half_offset(active_half) + write_offset;
+    if (!program_record(offset, record, size)) return false;
+
+    index[header.patch] = offset;
+    write_offset += record_align(size);
+    return true;
+}
+
+bool PatchLibrary::program_record(uint32_t offset, const uint8_t* record, uint32_t size) {
+    // Pad to whole pages with 0xFF, which leaves the bytes around the
+    // record as they are in flash
+    uint32_t lead = offset & (Flash::PAGE_SIZE - 1);
+    uint32_t total = Flash::page_align(lead + size);
+    if (total > page_buffer.size()) return false;
+
+    memmove(page_buffer.data() + lead, record, size);
+    memset(page_buffer.data(), 0xFF, lead);
+    memset(page_buffer.data() + lead + size, 0xFF, total - lead - size);
+    return Flash::program(offset - lead, page_buffer.data(), total);
+}
+
+bool PatchLibrary::compact() {
+    uint8_t target = active_half ^ 1;
+    uint32_t base = half_offset(target);
+    if (!Flash::erase(base, HALF_SIZE)) return false;
+
+    // Copy the latest record of each patch, packed, through RAM
+    std::array<uint32_t, PATCH_COUNT> new_index;
+    new_index.fill(NO_RECORD);
+    uint32_t offset = FIRST_RECORD;
+
+    for (uint8_t patch = 0; patch < PATCH_COUNT; patch++) {
+        if (index[patch] == NO_RECORD) continue;
+
+        RecordHeader header;
+        memcpy(&header, Flash::read(index[patch]), sizeof(header));
+        uint32_t size = sizeof(RecordHeader) + header.length;
+        if (!program_record(base + offset, Flash::read(index[patch]), size)) return false;
+
+        new_index[patch] = base + offset;
+        offset += record_align(size);
+    }
+
+    // The new half only becomes valid once its header is in place
+    if (!write_half(target, generation + 1)) return false;
+
+    active_half = target;
+    generation++;
+    index = new_index;
+    write_offset = offset;
+    printf("Patch library compacted, generation %lu\n", static_cast<unsigned long>(generation));
+    return true;
+}
+
+uint32_t PatchLibrary::crc32(uint32_t crc, const uint8_t* data, size_t length) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+} // namespace parameters
+} // namespace pg1000
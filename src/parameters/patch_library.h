@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include "parameters.h"
+#include "../hardware/flash.h"
+
+namespace pg1000 {
+namespace parameters {
+
+// Patch library in on-board flash, 128 edit buffer images.
+//
+// Storage is a log at the end of flash, split in two halves. Saving a
+// patch appends a CRC-checked record to the active half, and the newest
+// record for a patch wins. When the active half is full, the latest
+// record of each patch is copied to the other half, which then takes
+// over with a higher generation number. Its header is written last, so a
+// power cut at any point leaves the previous state intact.
+//
+// Records hold a delta (see PatchCodec) against whichever reference gives
+// the smallest result: an embedded factory patch or the all-zero image.
+// Records are packed on 4 byte boundaries, pages are programmed more than
+// once with the bytes outside the record left erased.
+class PatchLibrary {
+public:
+    static constexpr uint8_t PATCH_COUNT = 128;
+    static constexpr uint16_t PATCH_SIZE = EDIT_BUFFER_SIZE;
+    static constexpr uint8_t FORMAT_VERSION = 2;
+
+    // Two halves of 15 sectors at the end of flash
+    static constexpr uint32_t HALF_SECTORS = 15;
+    static constexpr uint32_t HALF_SIZE = HALF_SECTORS * hardware::Flash::SECTOR_SIZE;
+    static constexpr uint32_t REGION_OFFSET = hardware::Flash::SIZE - 2 * HALF_SIZE;
+
+    // Scan the log and build the index, formats the region if it's blank
+    static void init();
+
+    static bool is_used(uint8_t patch) { return patch < PATCH_COUNT && index[patch] != NO_RECORD; }
+    static uint8_t get_used_count();
+
+    // Decode a patch into a PATCH_SIZE buffer
+    static bool load(uint8_t patch, uint8_t* image);
+
+    // Save an image (the edit buffer by default)
+    static bool save(uint8_t patch);
+    static bool save(uint8_t patch, const uint8_t* image);
+
+    // Load a patch into the edit buffer. Only bytes that differ are marked
+    // dirty, so MIDI::send_dirty() sends the difference as few DT1 runs.
+    static bool recall(uint8_t patch);
+
+    // Statistics
+    static uint32_t get_generation() { return generation; }
+    static uint32_t get_free_space() { return HALF_SIZE - write_offset; }
+    static uint32_t get_stored_bytes();  // Record bytes of the live patches
+    static uint32_t get_raw_bytes() { return static_cast<uint32_t>(get_used_count()) * PATCH_SIZE; }
+    static uint32_t get_last_recall_us() { return last_recall_us; }
+
+private:
+    static constexpr uint16_t RECORD_MAGIC = 0x5052;  // "PR"
+    static constexpr uint16_t HALF_MAGIC = 0x5048;    // "PH"
+    static constexpr uint32_t NO_RECORD = 0xFFFFFFFF;
+    static constexpr uint8_t NO_REFERENCE = 0xFF;     // Delta against the all-zero image
+    static constexpr uint32_t RECORD_ALIGN = 4;
+
+    enum class Encoding : uint8_t {
+        RAW,
+        DELTA
+    };
+
+    struct RecordHeader {
+        uint16_t magic;
+        uint8_t version;
+        uint8_t patch;
+        uint32_t sequence;        // Increases with every record written
+        uint16_t length;          // Data bytes following the header
+        Encoding encoding;
+        uint8_t reference_bank;   // Factory patch the delta is against
+        uint8_t reference_patch;
+        uint8_t reserved[3];
+        uint32_t image_crc;       // CRC-32 of the decoded image
+        uint32_t crc;             // CRC-32 of the fields above and the data
+    };
+
+    struct HalfHeader {
+        uint16_t magic;
+        uint8_t version;
+        uint8_t reserved;
+        uint32_t generation; // Highest valid generation is the active half
+        uint32_t crc;
+    };
+
+    static constexpr uint32_t record_align(uint32_t size) {
+        return (size + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+    }
+    static constexpr uint32_t MAX_RECORD_SIZE = (sizeof(RecordHeader) + PATCH_SIZE + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+    static constexpr uint32_t FIRST_RECORD = hardware::Flash::PAGE_SIZE;  // After the half header
+
+    static_assert(FIRST_RECORD + (PATCH_COUNT + 1) * MAX_RECORD_SIZE <= HALF_SIZE,
+                  "A compacted half must hold every patch uncompressed and one more record");
+
+    static std::array<uint32_t, PATCH_COUNT> index;  // Flash offset of each patch's latest record
+    static uint8_t active_half;
+    static uint32_t generation;
+    static uint32_t write_offset;    // Next free byte in the active half
+    static uint32_t next_sequence;
+    static uint32_t last_recall_us;
+
+    // Scratch for encoding and decoding
+    static std::array<uint8_t, PATCH_SIZE> image_buffer;
+
+    // Flash can't be programmed from flash. A record can start anywhere
+    // in a page, so the page buffer covers one page more than the record.
+    static std::array<uint8_t, hardware::Flash::page_align(MAX_RECORD_SIZE) + hardware::Flash::PAGE_SIZE> page_buffer;
+
+    static uint32_t half_offset(uint8_t half) { return REGION_OFFSET + half * HALF_SIZE; }
+    static bool read_half_header(uint8_t half, uint32_t& half_generation);
+    static bool write_half(uint8_t half, uint32_t half_generation);
+    static void scan_half();
+    static bool check_record(uint32_t offset, RecordHeader& header);
+    static bool get_reference(const RecordHeader& header, const uint8_t*& reference);
+    static bool decode(uint32_t offset, uint8_t* image);
+    static bool append(const RecordHeader& header, const uint8_t* data);
+    static bool program_record(uint32_t offset, const uint8_t* record, uint32_t size);
+    static bool compact();
+
+    static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t length);
+};
+
+} // namespace parameters
+} // namespace pg1000
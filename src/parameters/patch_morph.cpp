@@ -0,0 +1,181 @@
+#include "patch_morph.h"
+#include "edit_buffer.h"
+#include "patch_library.h"
+#include "../midi/address_map.h"
+#include "../midi/sysex.h"
+#include "../hardware/adc.h"
+#include "../hardware/hardware.h"
+#include "pico/time.h"
+#include <cstring>
+#include <cstdio>
+
+namespace pg1000 {
+namespace parameters {
+
+// Start, 8 data bits and stop per MIDI byte
+static constexpr uint32_t BYTE_TIME_US = 10 * 1000000 / hardware::Config::MIDI_BAUD_RATE;
+static constexpr uint16_t DT1_OVERHEAD = midi::SysExConst::DATA_OVERHEAD;
+
+// Static member initialization
+std::array<uint8_t, PatchMorph::SIZE> PatchMorph::image_a = {};
+std::array<uint8_t, PatchMorph::SIZE> PatchMorph::image_b = {};
+bool PatchMorph::active = false;
+uint16_t PatchMorph::position = 0;
+uint32_t PatchMorph::credit_us = 0;
+uint32_t PatchMorph::last_update_us = 0;
+uint32_t PatchMorph::start_us = 0;
+PatchMorph::Stats PatchMorph::stats = {};
+
+void PatchMorph::start(const uint8_t* a, const uint8_t* b) {
+    memcpy(image_a.data(), a, SIZE);
+    memcpy(image_b.data(), b, SIZE);
+
+    active = true;
+    credit_us = 0;
+    last_update_us = time_us_32();
+    start_us = last_update_us;
+    stats = {};
+}
+
+bool PatchMorph::start_from_library(uint8_t patch_a, uint8_t patch_b) {
+    // Decode straight into the morph images
+    if (!PatchLibrary::load(patch_a, image_a.data()) || !PatchLibrary::load(patch_b, image_b.data())) {
+        return false;
+    }
+    start(image_a.data(), image_b.data());
+    return true;
+}
+
+void PatchMorph::stop() {
+    if (!active) return;
+    active = false;
+    print_stats();
+}
+
+void PatchMorph::set_position(uint16_t new_position) {
+    position = (new_position > POSITION_MAX) ? POSITION_MAX : new_position;
+}
+
+uint8_t PatchMorph::get_target(uint16_t address) {
+    uint8_t a = image_a[address];
+    uint8_t b = image_b[address];
+    if (a == b) return a;
+
+    const Parameter* param = midi::AddressMap::get_parameter(address);
+    if (!param || param->type == ParamType::ENUM) {
+        return (position < (POSITION_MAX + 1) / 2) ? a : b;
+    }
+
+    // Rounded, so both ends give exactly A and B
+    uint32_t weighted = static_cast<uint32_t>(a) * (POSITION_MAX - position) +
+                        static_cast<uint32_t>(b) * position;
+    return static_cast<uint8_t>((weighted + POSITION_MAX / 2) / POSITION_MAX);
+}
+
+void PatchMorph::update() {
+    if (!active) return;
+
+    constexpr uint8_t chip = POT / hardware::ADC::CHANNELS_PER_CHIP;
+    constexpr uint8_t channel = POT % hardware::ADC::CHANNELS_PER_CHIP;
+    if (hardware::ADC::has_changed(chip, channel)) {
+        set_position(hardware::ADC::get_value(chip, channel));
+    }
+    update(time_us_32());
+}
+
+void PatchMorph::update(uint32_t now_us) {
+    if (!active) return;
+
+    // Unused credit is capped, so a pause doesn't buy a long burst later
+    credit_us += (now_us - last_update_us) * LINK_SHARE_PERCENT / 100;
+    if (credit_us > MAX_BURST * BYTE_TIME_US) credit_us = MAX_BURST * BYTE_TIME_US;
+    last_update_us = now_us;
+    stats.elapsed_us = now_us - start_us;
+
+    while (send_run(credit_us / BYTE_TIME_US)) {
+    }
+}
+
+uint8_t PatchMorph::get_priority(uint16_t address, uint8_t target) {
+    uint8_t current = EditBuffer::get(address);
+    if (current == target) return 0;
+    uint8_t distance = (current > target) ? current - target : target - current;
+
+    // Distance as a share of the parameter's range, a switch counts in full
+    const Parameter* param = midi::AddressMap::get_parameter(address);
+    if (!param || param->type == ParamType::ENUM) return 127;
+    int range = param->max_value - param->min_value;
+    if (range <= 0) return 127;
+    int priority = distance * 127 / range;
+    return static_cast<uint8_t>(priority > 127 ? 127 : (priority < 1 ? 1 : priority));
+}
+
+bool PatchMorph::send_run(uint32_t budget) {
+    if (budget < DT1_OVERHEAD + 1u) return false;
+
+    // The byte furthest from its target
+    uint16_t best = SIZE;
+    uint8_t best_priority = 0;
+    for (uint16_t address = 0; address < SIZE; address++) {
+        if (!is_edit_address_valid(address)) continue;
+        uint8_t priority = get_priority(address, get_target(address));
+        if (priority > best_priority) {
+            best_priority = priority;
+            best = address;
+        }
+    }
+    if (best == SIZE) return false;
+
+    // Grow the run over changed bytes in the same block, bridging gaps the
+    // same way EditBuffer::next_dirty_run() does
+    uint16_t block_start = best - (best % EDIT_BLOCK_SIZE);
+    uint16_t block_end = block_start + EDIT_BLOCK_LENGTHS[best / EDIT_BLOCK_SIZE];
+    uint32_t max_length = budget - DT1_OVERHEAD;
+    if (max_length > midi::SysExConst::MAX_PACKET_DATA) max_length = midi::SysExConst::MAX_PACKET_DATA;
+
+    uint16_t first = best;
+    uint16_t last = best;
+    for (uint16_t address = best + 1; address < block_end && address - last <= EditBuffer::MERGE_GAP; address++) {
+        if (address - first + 1u > max_length) break;
+        if (EditBuffer::get(address) != get_target(address)) last = address;
+    }
+    for (int address = best - 1; address >= block_start && first - address <= EditBuffer::MERGE_GAP; address--) {
+        if (last - address + 1u > max_length) break;
+        if (EditBuffer::get(address) != get_target(address)) first = address;
+    }
+
+    uint16_t length = last - first + 1;
+    for (uint16_t address = first; address <= last; address++) {
+        uint8_t target = get_target(address);
+        if (EditBuffer::get(address) == target) continue;
+
+        EditBuffer::set(address, target);
+        uint8_t slot = midi::AddressMap::get_slot(address);
+        if (slot != midi::AddressMap::UNMAPPED) stats.updates[slot]++;
+    }
+    midi::AddressMap::apply(first, length);
+
+    credit_us -= (length + DT1_OVERHEAD) * BYTE_TIME_US;
+    stats.wire_bytes += length + DT1_OVERHEAD;
+    stats.messages++;
+    return true;
+}
+
+void PatchMorph::print_stats() {
+    uint32_t elapsed_ms = stats.elapsed_us / 1000;
+    if (elapsed_ms == 0) return;
+
+    printf("Morph: %lu ms, %u DT1, %lu bytes (%lu bytes/s)\n",
+           static_cast<unsigned long>(elapsed_ms), stats.messages,
+           static_cast<unsigned long>(stats.wire_bytes),
+           static_cast<unsigned long>(stats.wire_bytes * 1000 / elapsed_ms));
+    for (size_t i = 0; i < PARAMETERS.size(); i++) {
+        if (stats.updates[i] == 0) continue;
+        printf("  %-22s %5u updates, %3lu.%lu Hz\n", PARAMETERS[i].name, stats.updates[i],
+               static_cast<unsigned long>(stats.updates[i] * 1000UL / elapsed_ms),
+               static_cast<unsigned long>(stats.updates[i] * 10000UL / elapsed_ms % 10));
+    }
+}
+
+} // namespace parameters
+} // namespace pg1000
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include "parameters.h"
+#include "parameter_table.h"
+
+namespace pg1000 {
+namespace parameters {
+
+// Morph between two patches with one pot.
+//
+// Parameters in the table that aren't ENUM are interpolated, every other
+// byte (enums, names, anything unmapped) switches over at the halfway
+// point. The synth is moved towards the target under a byte budget: the
+// bytes furthest from their target go first, together with nearby bytes
+// of the same block as one DT1, and the budget is a share of the MIDI
+// link with a small burst allowance. The synth never falls more than the
+// burst behind the pot, so a fast sweep skips steps instead of lagging.
+//
+// Bytes are written into the edit buffer and go out with the regular
+// flush (MIDI::send_dirty()).
+class PatchMorph {
+public:
+    static constexpr uint16_t SIZE = EDIT_BUFFER_SIZE;
+    static constexpr uint8_t POT = 55;                    // Chip 6 channel 7, not used by the table
+    static constexpr uint16_t POSITION_MAX = 1023;        // 10 bit pot
+    static constexpr uint8_t LINK_SHARE_PERCENT = 75;     // Rest is left for edits and echoes
+    static constexpr uint16_t MAX_BURST = 64;             // Bytes of credit, about 20 ms of link time
+
+    struct Stats {
+        uint32_t elapsed_us;
+        uint32_t wire_bytes;
+        uint16_t messages;
+        std::array<uint16_t, PARAMETERS.size()> updates;  // Values sent per parameter
+    };
+
+    static void start(const uint8_t* image_a, const uint8_t* image_b);
+    static bool start_from_library(uint8_t patch_a, uint8_t patch_b);
+    static void stop();
+    static bool is_active() { return active; }
+
+    static void set_position(uint16_t position);
+    static uint16_t get_position() { return position; }
+    static uint8_t get_target(uint16_t address);
+
+    // Read the pot and spend the budget, call from the main loop
+    static void update();
+    static void update(uint32_t now_us);
+
+    static const Stats& get_stats() { return stats; }
+    static void print_stats();
+
+private:
+    static std::array<uint8_t, SIZE> image_a;
+    static std::array<uint8_t, SIZE> image_b;
+    static bool active;
+    static uint16_t position;
+    static uint32_t credit_us;       // Link time available for sending
+    static uint32_t last_update_us;
+    static uint32_t start_us;
+    static Stats stats;
+
+    static uint8_t get_priority(uint16_t address, uint8_t target);
+    static bool send_run(uint32_t budget);
+};
+
+} // namespace parameters
+} // namespace pg1000
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include "parameters.h"
+
+namespace pg1000 {
+namespace parameters {
+
+// Read-only view of one patch image in edit buffer layout, wherever it
+// lives (embedded bank in flash, patch library, edit buffer). Never
+// copies; an empty view has no data.
+class PatchView {
+public:
+    static constexpr uint16_t SIZE = EDIT_BUFFER_SIZE;
+
+    constexpr PatchView() : bytes(nullptr) {}
+    constexpr explicit PatchView(const uint8_t* data) : bytes(data) {}
+
+    constexpr bool empty() const { return bytes == nullptr; }
+    constexpr uint16_t size() const { return bytes ? SIZE : 0; }
+    constexpr const uint8_t* data() const { return bytes; }
+    constexpr const uint8_t* begin() const { return bytes; }
+    constexpr const uint8_t* end() const { return bytes ? bytes + SIZE : nullptr; }
+    constexpr uint8_t operator[](uint16_t address) const { return bytes[address]; }
+
+private:
+    const uint8_t* bytes;
+};
+
+} // namespace parameters
+} // namespace pg1000
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include "parameters.h"
+#include "parameter_table.h"
+
+namespace pg1000 {
+namespace parameters {
+
+// Pot reading (0-1023) to raw parameter value (0 to max - min) without
+// a division at run time. The reading goes through a taper table, then a
+// multiply by the number of steps and a shift by the ADC resolution.
+//
+// Every distinct (min, max, type) in PARAMETERS gets one scale entry,
+// built and checked at compile time.
+enum class PotTaper : uint8_t {
+    LINEAR,
+    LOG,       // Fast start, fine control at the top
+    ANTILOG,   // Fine control at the bottom, e.g. short envelope times
+    COUNT
+};
+
+namespace pot_scaling {
+
+constexpr uint8_t ADC_BITS = 10;
+constexpr uint16_t ADC_MAX = (1 << ADC_BITS) - 1;
+
+constexpr PotTaper default_taper(ParamType type) {
+    return (type == ParamType::CONTINUOUS_50) ? PotTaper::ANTILOG : PotTaper::LINEAR;
+}
+
+// Square law curves, close to audio taper pots. MacroPots shapes its
+// macros with the same table.
+constexpr std::array<std::array<uint16_t, ADC_MAX + 1>, static_cast<size_t>(PotTaper::COUNT)> build_tapers() {
+    std::array<std::array<uint16_t, ADC_MAX + 1>, static_cast<size_t>(PotTaper::COUNT)> tapers{};
+    for (uint32_t x = 0; x <= ADC_MAX; x++) {
+        uint32_t rest = ADC_MAX - x;
+        tapers[static_cast<size_t>(PotTaper::LINEAR)][x] = static_cast<uint16_t>(x);
+        tapers[static_cast<size_t>(PotTaper::LOG)][x] = static_cast<uint16_t>(ADC_MAX - (rest * rest + ADC_MAX / 2) / ADC_MAX);
+        tapers[static_cast<size_t>(PotTaper::ANTILOG)][x] = static_cast<uint16_t>((x * x + ADC_MAX / 2) / ADC_MAX);
+    }
+    return tapers;
+}
+
+inline constexpr auto TAPERS = build_tapers();
+
+struct Scale {
+    int8_t min_value;
+    int8_t max_value;
+    ParamType type;
+    PotTaper taper;
+    uint16_t steps;  // max - min + 1, the reciprocal-free multiplier
+};
+
+constexpr bool same_scale(const Parameter& a, const Parameter& b) {
+    return a.min_value == b.min_value && a.max_value == b.max_value && a.type == b.type;
+}
+
+constexpr size_t count_scales() {
+    size_t count = 0;
+    for (size_t i = 0; i < PARAMETERS.size(); i++) {
+        bool first = true;
+        for (size_t j = 0; j < i; j++) {
+            if (same_scale(PARAMETERS[i], PARAMETERS[j])) first = false;
+        }
+        if (first) count++;
+    }
+    return count;
+}
+
+inline constexpr size_t SCALE_COUNT = count_scales();
+
+constexpr std::array<Scale, SCALE_COUNT> build_scales() {
+    std::array<Scale, SCALE_COUNT> scales{};
+    size_t count = 0;
+    for (size_t i = 0; i < PARAMETERS.size(); i++) {
+        const Parameter& param = PARAMETERS[i];
+        bool first = true;
+        for (size_t j = 0; j < i; j++) {
+            if (same_scale(param, PARAMETERS[j])) first = false;
+        }
+        if (!first) continue;
+        scales[count++] = {param.min_value, param.max_value, param.type, default_taper(param.type),
+                           static_cast<uint16_t>(param.max_value - param.min_value + 1)};
+    }
+    return scales;
+}
+
+inline constexpr std::array<Scale, SCALE_COUNT> SCALES = build_scales();
+
+// Scale entry of each parameter
+constexpr std::array<uint8_t, PARAMETERS.size()> build_scale_index() {
+    std::array<uint8_t, PARAMETERS.size()> index{};
+    for (size_t i = 0; i < PARAMETERS.size(); i++) {
+        for (size_t s = 0; s < SCALE_COUNT; s++) {
+            const Scale& scale = SCALES[s];
+            if (scale.min_value == PARAMETERS[i].min_value && scale.max_value == PARAMETERS[i].max_value &&
+                scale.type == PARAMETERS[i].type) {
+                index[i] = static_cast<uint8_t>(s);
+                break;
+            }
+        }
+    }
+    return index;
+}
+
+inline constexpr std::array<uint8_t, PARAMETERS.size()> SCALE_INDEX = build_scale_index();
+
+constexpr uint8_t apply(const Scale& scale, uint16_t reading) {
+    uint32_t tapered = TAPERS[static_cast<size_t>(scale.taper)][reading > ADC_MAX ? ADC_MAX : reading];
+    return static_cast<uint8_t>((tapered * scale.steps) >> ADC_BITS);
+}
+
+// Starts at 0, ends at max - min, never goes down and never skips a value
+constexpr bool scale_valid(const Scale& scale) {
+    if (scale.steps < 1 || scale.steps > ADC_MAX + 1) return false;
+    if (apply(scale, 0) != 0 || apply(scale, ADC_MAX) != scale.steps - 1) return false;
+    for (uint16_t reading = 1; reading <= ADC_MAX; reading++) {
+        int step = apply(scale, reading) - apply(scale, reading - 1);
+        if (step < 0 || step > 1) return false;
+    }
+    return true;
+}
+
+constexpr bool scales_valid() {
+    for (const auto& scale : SCALES) {
+        if (!scale_valid(scale)) return false;
+    }
+    return true;
+}
+
+static_assert(scales_valid(), "Pot scale not monotonic or not covering its range");
+
+} // namespace pot_scaling
+
+// Raw value of a table parameter for a pot reading
+inline uint8_t scale_pot(int parameter_index, uint16_t reading) {
+    if (parameter_index < 0 || parameter_index >= static_cast<int>(PARAMETERS.size())) return 0;
+    return pot_scaling::apply(pot_scaling::SCALES[pot_scaling::SCALE_INDEX[parameter_index]], reading);
+}
+
+} // namespace parameters
+} // namespace pg1000
@@ -0,0 +1,58 @@
+#include "frame_scheduler.h"
+#include "../midi/midi.h"
+
+namespace pg1000 {
+namespace ui {
+
+static constexpr uint32_t WINDOW_US = 1000000;
+
+// Static member initialization
+uint8_t FrameScheduler::frame_rate = DEFAULT_FRAME_RATE;
+uint32_t FrameScheduler::frame_us = 1000000 / DEFAULT_FRAME_RATE;
+uint32_t FrameScheduler::next_frame_us = 0;
+uint32_t FrameScheduler::frame_start_us = 0;
+uint32_t FrameScheduler::window_start_us = 0;
+FrameScheduler::Stats FrameScheduler::window = {};
+FrameScheduler::Stats FrameScheduler::stats = {};
+
+void FrameScheduler::set_frame_rate(uint8_t frames_per_second) {
+    if (frames_per_second == 0) frames_per_second = 1;
+    if (frames_per_second > MAX_FRAME_RATE) frames_per_second = MAX_FRAME_RATE;
+    frame_rate = frames_per_second;
+    frame_us = 1000000 / frames_per_second;
+}
+
+bool FrameScheduler::frame_due(uint32_t now_us) {
+    if (static_cast<int32_t>(now_us - next_frame_us) < 0) return false;
+
+    // The flush runs later in this pass, the frame on the next one
+    if (midi::MIDI::is_flush_due(now_us)) {
+        window.deferred++;
+        return false;
+    }
+    return true;
+}
+
+void FrameScheduler::begin_frame(uint32_t now_us) {
+    frame_start_us = now_us;
+
+    // Keep the cadence, unless we fell a whole frame behind
+    next_frame_us += frame_us;
+    if (static_cast<int32_t>(now_us - next_frame_us) >= 0) {
+        next_frame_us = now_us + frame_us;
+    }
+}
+
+void FrameScheduler::end_frame(uint32_t now_us) {
+    window.display_us += now_us - frame_start_us;
+    window.frames++;
+
+    if (now_us - window_start_us >= WINDOW_US) {
+        stats = window;
+        window = {};
+        window_start_us = now_us;
+    }
+}
+
+} // namespace ui
+} // namespace pg1000
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+namespace pg1000 {
+namespace ui {
+
+// Paces display refreshes. The UI only marks its state as changed; at
+// each frame boundary the latest state is rendered into the framebuffer
+// and the changed cells are flushed, so in-between states are dropped.
+// A MIDI flush that is due at the same time goes first.
+class FrameScheduler {
+public:
+    static constexpr uint8_t DEFAULT_FRAME_RATE = 30;  // About what the LCD can visibly show
+    static constexpr uint8_t MAX_FRAME_RATE = 100;
+
+    static void set_frame_rate(uint8_t frames_per_second);
+    static uint8_t get_frame_rate() { return frame_rate; }
+
+    // True when a frame should be drawn now
+    static bool frame_due(uint32_t now_us);
+
+    // Around the rendering and flush, for the time budget
+    static void begin_frame(uint32_t now_us);
+    static void end_frame(uint32_t now_us);
+
+    // Figures for the last full second
+    struct Stats {
+        uint32_t display_us;   // Main loop time spent rendering and flushing
+        uint16_t frames;
+        uint16_t deferred;     // Frames held back for a MIDI flush
+    };
+    static const Stats& get_stats() { return stats; }
+
+private:
+    static uint8_t frame_rate;
+    static uint32_t frame_us;
+    static uint32_t next_frame_us;
+    static uint32_t frame_start_us;
+
+    static uint32_t window_start_us;
+    static Stats window;
+    static Stats stats;
+};
+
+} // namespace ui
+} // namespace pg1000
@@ -1,8 +1,21 @@
 #include "interface.h"
+#include <algorithm>
+#include "frame_scheduler.h"
+#include "value_format.h"
 #include "../hardware/display.h"
 #include "../hardware/gpio.h"
 #include "../midi/midi.h"
-#include <cstdio>
+#include "../midi/bulk_dump.h"
+#include "../midi/handshake.h"
+#include "../parameters/patch_library.h"
+#include "../parameters/edit_history.h"
+#include "../parameters/patch_compare.h"
+#include "../parameters/patch_morph.h"
+#include "../parameters/patch_view.h"
+#include "../parameters/pot_scaling.h"
+#include "../parameters/edit_buffer.h"
+#include "../hardware/adc.h"
+#include "../midi/address_map.h"
 #include "pico/time.h"
 #include "../parameters/common_selector.h"
 
@@ -15,10 +28,28 @@ MenuItem Interface::current_menu_item = MenuItem::MIDI_CHANNEL;
 const Parameter* Interface::current_parameter = nullptr;
 uint32_t Interface::last_button_time = 0;
 bool Interface::display_needs_update = true;
+uint8_t Interface::selected_patch = 0;
+PatchAction Interface::patch_action = PatchAction::LOAD;
+uint8_t Interface::morph_patch_a = 0;
+bool Interface::enter_armed = false;
+uint8_t Interface::history_keys = 0;
+bool Interface::history_chord = false;
+std::array<uint8_t, midi::Handshake::PATCH_STRIDE> Interface::d50_patch = {};
+bool Interface::d50_reading = false;
+
+// Internal patch memory is the edit buffer layout, padded to whole blocks
+static_assert(midi::Handshake::PATCH_STRIDE >= EDIT_BUFFER_SIZE, "D-50 patch smaller than the edit buffer");
 
 bool Interface::init() {
     current_parameter = get_parameter(0);
+
+    // INC and DEC repeat while held, faster the longer they're held
+    hardware::GPIO::set_auto_repeat(KEY_INC, true);
+    hardware::GPIO::set_auto_repeat(KEY_DEC, true);
     hardware::Display::show_message("D50 Controller", "Initializing...");
+
+    // Match the synth's current patch
+    midi::MIDI::request_all_parameters();
     return true;
 }
 
@@ -28,43 +59,159 @@ void Interface::execute_menu_item() {
             set_mode(Mode::MIDI_CHANNEL_SELECT);
             display_needs_update = true;
             break;
-        // Other menu items...
+        case MenuItem::SAVE_CONFIG:
+        case MenuItem::LOAD_CONFIG:
+            patch_action = (current_menu_item == MenuItem::SAVE_CONFIG) ? PatchAction::SAVE : PatchAction::LOAD;
+            set_mode(Mode::PATCH_SELECT);
+            break;
+        case MenuItem::MORPH:
+            if (parameters::PatchMorph::is_active()) {
+                parameters::PatchMorph::stop();
+                hardware::Display::show_message("Morph", "Off");
+                set_mode(Mode::NORMAL);
+            } else {
+                patch_action = PatchAction::MORPH_A;
+                set_mode(Mode::PATCH_SELECT);
+            }
+            break;
+        case MenuItem::D50_WRITE:
+        case MenuItem::D50_READ:
+            patch_action = (current_menu_item == MenuItem::D50_WRITE) ? PatchAction::D50_WRITE : PatchAction::D50_READ;
+            selected_patch %= midi::Handshake::PATCHES_PER_BANK;
+            set_mode(Mode::PATCH_SELECT);
+            break;
+        default:
+            break;
     }
 }
 
-void Interface::update_midi_channel_mode() {
-    // Called from main update() function
-    if (hardware::GPIO::get_button(8)) { // EXIT button
-        set_mode(Mode::NORMAL);
-        return;
+void Interface::next_menu_item() {
+    int item = (static_cast<int>(current_menu_item) + 1) % MENU_ITEM_COUNT;
+    current_menu_item = static_cast<MenuItem>(item);
+    display_needs_update = true;
+}
+
+void Interface::prev_menu_item() {
+    int item = (static_cast<int>(current_menu_item) + MENU_ITEM_COUNT - 1) % MENU_ITEM_COUNT;
+    current_menu_item = static_cast<MenuItem>(item);
+    display_needs_update = true;
+}
+
+void Interface::update_patch_select_display() {
+    // D-50 style numbering in two groups, A11-A88 and B11-B88, and I11-I88
+    // for the synth's own internal memory
+    LineBuffer line;
+    line.append(is_d50_action() ? 'I' : static_cast<char>('A' + selected_patch / 64))
+        .append_number((selected_patch % 64) / 8 + 1)
+        .append_number(selected_patch % 8 + 1);
+    if (!is_d50_action() && !parameters::PatchLibrary::is_used(selected_patch)) line.append(" (empty)");
+    const char* title = "Load Patch";
+    switch (patch_action) {
+        case PatchAction::SAVE:      title = "Save Patch"; break;
+        case PatchAction::MORPH_A:   title = "Morph From"; break;
+        case PatchAction::MORPH_B:   title = "Morph To"; break;
+        case PatchAction::D50_WRITE: title = "Write to D-50"; break;
+        case PatchAction::D50_READ:  title = "Read from D-50"; break;
+        default: break;
+    }
+    hardware::Display::show_message(title, line.view());
+}
+
+void Interface::map_patch_select_buttons(uint8_t button) {
+    uint8_t count = is_d50_action() ? midi::Handshake::PATCHES_PER_BANK : parameters::PatchLibrary::PATCH_COUNT;
+
+    switch (button) {
+        case KEY_INC:
+            selected_patch = (selected_patch + 1) % count;
+            break;
+        case KEY_DEC:
+            selected_patch = (selected_patch + count - 1) % count;
+            break;
+        case KEY_ENTER:
+            if (patch_action == PatchAction::SAVE) {
+                bool ok = parameters::PatchLibrary::save(selected_patch);
+                hardware::Display::show_message("Save Patch", ok ? "Saved" : "Save failed");
+            } else if (patch_action == PatchAction::MORPH_A) {
+                morph_patch_a = selected_patch;
+                patch_action = PatchAction::MORPH_B;
+                display_needs_update = true;
+                break;  // Stay for the second patch
+            } else if (patch_action == PatchAction::MORPH_B) {
+                bool ok = parameters::PatchMorph::start_from_library(morph_patch_a, selected_patch);
+                hardware::Display::show_message("Morph", ok ? "Use pot 56" : "Empty patch");
+            } else if (is_d50_action()) {
+                start_d50_transfer();
+            } else {
+                parameters::PatchMorph::stop();
+                if (parameters::PatchLibrary::recall(selected_patch)) {
+                    // Only the bytes that differ from the current sound go out
+                    midi::MIDI::send_dirty();
+                }
+            }
+            set_mode(Mode::NORMAL);
+            break;
+        case KEY_EXIT:
+            set_mode(Mode::NORMAL);
+            break;
+    }
+}
+
+void Interface::start_d50_transfer() {
+    bool ok;
+    d50_reading = (patch_action == PatchAction::D50_READ);
+    if (d50_reading) {
+        ok = midi::Handshake::receive_patch(selected_patch, d50_patch.data());
+    } else {
+        // The edit, with the reserved tail of the last block cleared
+        const uint8_t* edit = parameters::EditBuffer::data();
+        std::copy(edit, edit + EDIT_BUFFER_SIZE, d50_patch.begin());
+        std::fill(d50_patch.begin() + EDIT_BUFFER_SIZE, d50_patch.end(), 0);
+        ok = midi::Handshake::send_patch(selected_patch, d50_patch.data());
+    }
+
+    // The D-50 has to be waiting in bulk load for a write
+    hardware::Display::show_message(d50_reading ? "Read from D-50" : "Write to D-50",
+                                    ok ? "Working..." : "Link busy");
+}
+
+void Interface::finish_d50_transfer() {
+    bool ok = (midi::Handshake::get_state() == midi::TransferState::COMPLETE);
+    if (ok && d50_reading) {
+        parameters::PatchMorph::stop();
+        ok = (midi::MIDI::send_patch(parameters::PatchView(d50_patch.data())) == midi::MidiError::OK);
     }
+    hardware::Display::show_message(d50_reading ? "Read from D-50" : "Write to D-50", ok ? "Done" : "Failed");
+}
+
+void Interface::update_midi_channel_mode() {
+    // Channel selection handled by button mapping
 }
 
 void Interface::update_midi_channel_display() {
-    char buffer[17];
-    snprintf(buffer, sizeof(buffer), "MIDI CH > %02d", midi::MIDI::get_midi_channel());
-    hardware::Display::show_message("Channel Select", buffer);
+    LineBuffer line;
+    line.append("MIDI CH > ").append_number(midi::MIDI::get_midi_channel(), 2);
+    hardware::Display::show_message("Channel Select", line.view());
 }
 
 void Interface::map_midi_channel_buttons(uint8_t button) {
     uint8_t current_channel = midi::MIDI::get_midi_channel();
     
     switch (button) {
-        case 0: // UPPER button - increment
+        case KEY_INC:
             if (current_channel < 16) {
                 midi::MIDI::set_midi_channel(current_channel + 1);
                 display_needs_update = true;
             }
             break;
             
-        case 1: // LOWER button - decrement
+        case KEY_DEC:
             if (current_channel > 1) {
                 midi::MIDI::set_midi_channel(current_channel - 1);
                 display_needs_update = true;
             }
             break;
             
-        case 8: // EXIT button
+        case KEY_EXIT:
             set_mode(Mode::NORMAL);
             break;
     }
@@ -95,18 +242,18 @@ bool Interface::is_common_parameter(ParamGroup group) {
 void Interface::update_parameter_value(const Parameter* param, uint8_t value) {
     if (!param || !can_edit_parameter(param)) return;
 
-    
-    // Existing parameter update logic
-    const_cast<Parameter*>(param)->value = value;
-    midi::MIDI::send_sysex(param);
+    // Sent from the edit buffer by the MIDI flush
+    set_parameter_value(param, value);
     display_needs_update = true;
 }
 
 void Interface::update_parameter_value(int16_t change) {
     if (!current_parameter || !can_edit_parameter(current_parameter)) return;
     
-    int16_t new_value = current_parameter->value + change;
-    new_value = std::max<int16_t>(0, std::min<int16_t>(current_parameter->max_value, new_value));
+    int16_t new_value = get_parameter_value(current_parameter) + change;
+    // Raw values run from 0 to max - min, as with the pots
+    int16_t raw_max = current_parameter->max_value - current_parameter->min_value;
+    new_value = std::max<int16_t>(0, std::min<int16_t>(raw_max, new_value));
     
     update_parameter_value(current_parameter, static_cast<uint8_t>(new_value));
 }
@@ -122,12 +269,116 @@ void Interface::update_parameter_edit_display() {
         return;
     }
 
-    char value_str[16];
-    snprintf(value_str, sizeof(value_str), "Value: %d", current_parameter->value);
-    hardware::Display::show_message(current_parameter->name, value_str);
+    LineBuffer line;
+    line.append("Value: ").append_value(current_parameter, get_parameter_value(current_parameter));
+    hardware::Display::show_message(current_parameter->name, line.view());
+}
+
+void Interface::toggle_compare() {
+    parameters::PatchMorph::stop();
+    const auto& transfer = parameters::PatchCompare::toggle();
+    midi::MIDI::send_dirty();
+
+    LineBuffer line;
+    line.append_number(transfer.wire_bytes).append("B ")
+        .append_number((transfer.wire_us + 999) / 1000).append("ms");
+    hardware::Display::show_message(parameters::PatchCompare::is_comparing() ? "Compare: Orig" : "Compare: Edit",
+                                    line.view());
+}
+
+void Interface::press_history_key(uint8_t button) {
+    uint8_t bit = (button == KEY_COMPARE) ? 0x01 : 0x02;
+    if (history_keys & ~bit) {
+        // The other one is held, undo with REQUEST held, redo with COMPARE
+        step_history(button == KEY_REQUEST);
+        history_chord = true;
+    }
+    history_keys |= bit;
+}
+
+void Interface::release_history_key(uint8_t button) {
+    history_keys &= (button == KEY_COMPARE) ? ~0x01 : ~0x02;
+    if (history_keys) return;
+
+    // Released on its own, without taking part in an undo or redo
+    if (!history_chord) {
+        if (button == KEY_COMPARE) {
+            toggle_compare();
+        } else {
+            midi::MIDI::request_all_parameters();
+        }
+    }
+    history_chord = false;
+}
+
+void Interface::step_history(bool forward) {
+    using parameters::EditHistory;
+
+    // History steps are edits to the edited patch
+    parameters::PatchMorph::stop();
+    parameters::PatchCompare::leave();
+
+    bool done = forward ? EditHistory::redo() : EditHistory::undo();
+    if (!done) {
+        hardware::Display::show_message(forward ? "Nothing to Redo" : "Nothing to Undo");
+        return;
+    }
+    midi::MIDI::send_dirty();
+
+    // The step just taken
+    uint16_t step = forward ? EditHistory::get_undo_count() - 1 : EditHistory::get_undo_count();
+    const EditHistory::Record* record = EditHistory::get_record(step);
+    const Parameter* param = record ? midi::AddressMap::get_parameter(record->address) : nullptr;
+
+    LineBuffer line;
+    line.append(forward ? "Redo" : "Undo");
+    if (param) line.append(' ').append_value(param, get_parameter_value(param));
+    hardware::Display::show_message(param ? param->name : "Edit", line.view());
+}
+
+void Interface::update_pots() {
+    for (int i = 0; i < get_parameter_count(); i++) {
+        const Parameter* param = get_parameter(i);
+        uint8_t chip = param->pot_number / hardware::ADC::CHANNELS_PER_CHIP;
+        uint8_t channel = param->pot_number % hardware::ADC::CHANNELS_PER_CHIP;
+        if (!param->active || !hardware::ADC::has_changed(chip, channel)) continue;
+
+        // Goes out with the next MIDI flush
+        update_parameter_value(param, parameters::scale_pot(i, hardware::ADC::get_value(chip, channel)));
+    }
+}
+
+void Interface::process_button_events() {
+    hardware::ButtonEvent event;
+    while (hardware::GPIO::next_event(event)) {
+        switch (event.type) {
+            case hardware::ButtonEventType::PRESS:
+            case hardware::ButtonEventType::REPEAT:
+                handle_button_press(event.button);
+                break;
+            case hardware::ButtonEventType::RELEASE:
+                handle_button_release(event.button);
+                break;
+            case hardware::ButtonEventType::HOLD:
+                handle_button_hold(event.button);
+                break;
+            case hardware::ButtonEventType::DOUBLE_PRESS:
+                handle_button_double_press(event.button);
+                break;
+        }
+    }
 }
 
 void Interface::update() {
+    update_pots();
+    process_button_events();
+    if (midi::BulkDump::take_completed()) {
+        display_needs_update = true;  // Every value may have changed
+    }
+    if (midi::Handshake::take_finished()) {
+        finish_d50_transfer();
+    }
+
     switch (current_mode) {
         case Mode::NORMAL:
             update_normal_mode();
@@ -144,16 +395,32 @@ void Interface::update() {
         case Mode::MIDI_CHANNEL_SELECT:
             update_midi_channel_mode();
             break;
+        case Mode::PATCH_SELECT:
+            // Driven by button events, see map_patch_select_buttons()
+            break;
     }
-    
-    if (display_needs_update) {
-        update_display();
-        display_needs_update = false;
+
+    // The latest state at each frame boundary, only the cells that
+    // changed go to the LCD
+    uint32_t now = time_us_32();
+    if (FrameScheduler::frame_due(now)) {
+        FrameScheduler::begin_frame(now);
+        if (display_needs_update) {
+            update_display();
+            display_needs_update = false;
+        }
+        hardware::Display::flush();
+        FrameScheduler::end_frame(time_us_32());
     }
 }
 
 void Interface::handle_button_press(uint8_t button) {
     last_button_time = time_us_32();
+
+    if (is_history_key(button)) {
+        press_history_key(button);
+        return;
+    }
     
     switch (current_mode) {
         case Mode::NORMAL:
@@ -171,11 +438,40 @@ void Interface::handle_button_press(uint8_t button) {
         case Mode::MIDI_CHANNEL_SELECT:
             map_midi_channel_buttons(button);
             break;
+        case Mode::PATCH_SELECT:
+            map_patch_select_buttons(button);
+            break;
     }
     
     display_needs_update = true;
 }
 
+void Interface::handle_button_release(uint8_t button) {
+    last_button_time = time_us_32();
+
+    if (is_history_key(button)) {
+        release_history_key(button);
+        return;
+    }
+
+    // A short ENTER in NORMAL mode opens the editor
+    if (button == KEY_ENTER && enter_armed) {
+        enter_armed = false;
+        if (current_mode == Mode::NORMAL) set_mode(Mode::PARAMETER_EDIT);
+    }
+}
+
+void Interface::handle_button_hold(uint8_t button) {
+    if (current_mode == Mode::NORMAL && button == KEY_MENU && enter_armed) {
+        enter_armed = false;
+        set_mode(Mode::MENU);
+    }
+}
+
+void Interface::handle_button_double_press(uint8_t button) {
+    // No double press actions, a second press always acts as a press
+}
+
 void Interface::set_mode(Mode mode) {
     if (mode != current_mode) {
         current_mode = mode;
@@ -183,18 +479,20 @@ void Interface::set_mode(Mode mode) {
         
         switch (mode) {
             case Mode::NORMAL:
-                hardware::GPIO::set_led(0, hardware::LedState::ON);
-                hardware::GPIO::set_led(1, hardware::LedState::OFF);
+                parameters::CommonSelector::update_leds();
                 break;
             case Mode::MENU:
-                hardware::GPIO::set_led(0, hardware::LedState::BLINK_SLOW);
-                hardware::GPIO::set_led(1, hardware::LedState::BLINK_SLOW);
+                // INC and DEC are live
+                hardware::GPIO::set_led(hardware::GPIO::LED_COMMON_UPPER, hardware::LedState::BLINK_SLOW);
+                hardware::GPIO::set_led(hardware::GPIO::LED_COMMON_LOWER, hardware::LedState::BLINK_SLOW);
                 break;
             case Mode::PARAMETER_EDIT:
-                hardware::GPIO::set_led(0, hardware::LedState::BLINK_FAST);
+                hardware::GPIO::set_led(hardware::GPIO::LED_COMMON_UPPER, hardware::LedState::BLINK_FAST);
                 break;
             case Mode::SYSTEM_CONFIG:
-                hardware::GPIO::set_led(1, hardware::LedState::BLINK_FAST);
+                hardware::GPIO::set_led(hardware::GPIO::LED_COMMON_LOWER, hardware::LedState::BLINK_FAST);
+                break;
+            default:
                 break;
         }
     }
@@ -233,10 +531,8 @@ void Interface::prev_parameter() {
 }
 
 void Interface::update_normal_mode() {
-    if (hardware::GPIO::get_button(4) && 
-        (time_us_32() - last_button_time > 1000000)) {
-        set_mode(Mode::MENU);
-    }
+    // ENTER opens the editor on release, or the menu when held, see
+    // handle_button_release() and handle_button_hold()
 }
 
 void Interface::update_menu_mode() {
@@ -246,14 +542,6 @@ void Interface::update_menu_mode() {
 void Interface::update_parameter_edit_mode() {
     if (!current_parameter) {
         set_mode(Mode::NORMAL);
-        return;
-    }
-    
-    if (hardware::GPIO::get_button(5)) {  // INC button
-        update_parameter_value(1);
-    }
-    if (hardware::GPIO::get_button(6)) {  // DEC button
-        update_parameter_value(-1);
     }
 }
 
@@ -278,16 +566,36 @@ void Interface::update_display() {
         case Mode::MIDI_CHANNEL_SELECT:
             update_midi_channel_display();
             break;
+        case Mode::PATCH_SELECT:
+            update_patch_select_display();
+            break;
     }
 }
 
 void Interface::update_normal_display() {
     if (current_parameter) {
+        // Raw values run from 0 to max - min, signed ranges get a bar from zero
+        uint8_t value = get_parameter_value(current_parameter);
+        char value_text[ValueFormatter::MAX_LENGTH];
+        uint8_t length = ValueFormatter::format(current_parameter, value, value_text);
         hardware::Display::show_parameter(
             current_parameter->name,
-            current_parameter->value,
-            current_parameter->max_value
+            std::string_view(value_text, length),
+            value,
+            current_parameter->max_value - current_parameter->min_value,
+            (current_parameter->min_value < 0) ? -current_parameter->min_value : 0
         );
+
+        // The pitch envelope as a graph, where the display can draw one
+        bool common = is_common_parameter(current_parameter->group) || current_parameter->group == ParamGroup::COMMON;
+        if (common && current_parameter->offset >= PENV_TIME_OFFSET && current_parameter->offset < PENV_TIME_OFFSET + 4) {
+            uint16_t base = get_parameter_address(current_parameter) - current_parameter->offset;
+            uint8_t times[4];
+            uint8_t levels[5];
+            for (uint8_t i = 0; i < 4; i++) times[i] = parameters::EditBuffer::get(base + PENV_TIME_OFFSET + i);
+            for (uint8_t i = 0; i < 5; i++) levels[i] = parameters::EditBuffer::get(base + PENV_LEVEL_OFFSET + i);
+            hardware::Display::show_envelope(times, levels);
+        }
     }
 }
 
@@ -297,7 +605,36 @@ void Interface::update_menu_display() {
         case MenuItem::MIDI_CHANNEL:
             menu_text = "MIDI Channel";
             break;
-        // Add other menu items
+        case MenuItem::SYSEX_ENABLE:
+            menu_text = "SysEx Enable";
+            break;
+        case MenuItem::CC_ENABLE:
+            menu_text = "CC Enable";
+            break;
+        case MenuItem::DISPLAY_CONTRAST:
+            menu_text = "Contrast";
+            break;
+        case MenuItem::CALIBRATE:
+            menu_text = "Calibrate";
+            break;
+        case MenuItem::SAVE_CONFIG:
+            menu_text = "Save Patch";
+            break;
+        case MenuItem::LOAD_CONFIG:
+            menu_text = "Load Patch";
+            break;
+        case MenuItem::MORPH:
+            menu_text = parameters::PatchMorph::is_active() ? "Morph Off" : "Morph";
+            break;
+        case MenuItem::D50_WRITE:
+            menu_text = "Write to D-50";
+            break;
+        case MenuItem::D50_READ:
+            menu_text = "Read from D-50";
+            break;
+        case MenuItem::FACTORY_RESET:
+            menu_text = "Factory Reset";
+            break;
     }
     hardware::Display::show_message("MENU", menu_text);
 }
@@ -309,42 +646,67 @@ void Interface::update_system_config_display() {
 }
 
 void Interface::map_normal_mode_buttons(uint8_t button) {
+    // The COMMON and PARTIAL buttons belong to the selectors here
     switch (button) {
-        case 0:  // UPPER
-            break;
-        case 1:  // LOWER
-            break;
-        case 5:  // INC
-            next_parameter();
-            break;
-        case 6:  // DEC
-            prev_parameter();
+        case KEY_ENTER:
+            enter_armed = true;
             break;
-        case 7:  // ENTER
-            set_mode(Mode::PARAMETER_EDIT);
+        case KEY_EXIT:
+            set_mode(Mode::MIDI_CHANNEL_SELECT);
             break;
     }
 }
 
 void Interface::map_menu_mode_buttons(uint8_t button) {
     switch (button) {
-        case 7:  // ENTER
+        case KEY_INC:
+            next_menu_item();
+            break;
+        case KEY_DEC:
+            prev_menu_item();
+            break;
+        case KEY_ENTER:
             execute_menu_item();
             break;
-        case 8:  // EXIT
+        case KEY_EXIT:
             set_mode(Mode::NORMAL);
             break;
     }
 }
 
 void Interface::map_parameter_edit_buttons(uint8_t button) {
-    if (button == 8) {  // EXIT
-        set_mode(Mode::NORMAL);
+    // INC and DEC auto-repeat, one step per press or repeat. Both held
+    // resets the value to zero, -min_value for a signed range.
+    if ((button == KEY_INC || button == KEY_DEC) &&
+        hardware::GPIO::get_button(KEY_INC) && hardware::GPIO::get_button(KEY_DEC)) {
+        if (current_parameter) {
+            uint8_t zero = (current_parameter->min_value < 0) ? -current_parameter->min_value : 0;
+            update_parameter_value(current_parameter, zero);
+        }
+        return;
+    }
+
+    switch (button) {
+        case KEY_INC:
+            update_parameter_value(1);
+            break;
+        case KEY_DEC:
+            update_parameter_value(-1);
+            break;
+        case KEY_NEXT:
+            next_parameter();
+            break;
+        case KEY_PREV:
+            prev_parameter();
+            break;
+        case KEY_EXIT:
+            set_mode(Mode::NORMAL);
+            break;
     }
 }
 
 void Interface::map_system_config_buttons(uint8_t button) {
-    if (button == 8) {  // EXIT
+    if (button == KEY_EXIT) {
         set_mode(Mode::NORMAL);
     }
 }
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <cstdint>
+#include <array>
 #include "../parameters/parameters.h"
+#include "../hardware/gpio.h"
+#include "../midi/handshake.h"
 
 namespace pg1000 {
 namespace ui {
@@ -12,7 +15,18 @@ enum class Mode {
     MENU,           // Menu navigation
     PARAMETER_EDIT, // Direct parameter value editing
     SYSTEM_CONFIG,  // System configuration
-    MIDI_CHANNEL_SELECT  // New mode for MIDI channel selection
+    MIDI_CHANNEL_SELECT,  // New mode for MIDI channel selection
+    PATCH_SELECT    // Choosing a library slot or D-50 patch to save to or load from
+};
+
+// What choosing a slot in PATCH_SELECT does
+enum class PatchAction {
+    LOAD,
+    SAVE,
+    MORPH_A,    // First patch of a morph
+    MORPH_B,
+    D50_WRITE,  // Edit into a D-50 internal patch, by handshake
+    D50_READ    // D-50 internal patch into the edit
 };
 
 // Menu Items
@@ -24,8 +38,12 @@ enum class MenuItem {
     CALIBRATE,
     SAVE_CONFIG,
     LOAD_CONFIG,
+    MORPH,
+    D50_WRITE,
+    D50_READ,
     FACTORY_RESET
 };
+static constexpr int MENU_ITEM_COUNT = static_cast<int>(MenuItem::FACTORY_RESET) + 1;
 
 class Interface {
 public:
@@ -37,6 +55,7 @@ public:
    static void handle_button_press(uint8_t button);
    static void handle_button_release(uint8_t button);
    static void handle_button_hold(uint8_t button);
+   static void handle_button_double_press(uint8_t button);
 
    // Mode management
    static Mode get_current_mode() { return current_mode; }
@@ -61,12 +80,59 @@ private:
    static const Parameter* current_parameter;
    static uint32_t last_button_time;
    static bool display_needs_update;
+   static uint8_t selected_patch;
+   static PatchAction patch_action;
+   static uint8_t morph_patch_a;
+   static bool enter_armed;  // ENTER pressed in NORMAL mode, acts on release unless held
+   static uint8_t history_keys;   // KEY_COMPARE and KEY_REQUEST held, as bits
+   static bool history_chord;     // Undo or redo since both were last up
+   static std::array<uint8_t, midi::Handshake::PATCH_STRIDE> d50_patch;  // Handshake transfer buffer
+   static bool d50_reading;       // Running transfer is a D50_READ
 
     // MIDI Channel selection mode functions
     static void update_midi_channel_mode();
     static void update_midi_channel_display();
     static void map_midi_channel_buttons(uint8_t button);
 
+    // Undo/redo of parameter edits, A/B compare
+    static bool is_history_key(uint8_t button) { return button == KEY_COMPARE || button == KEY_REQUEST; }
+    static void press_history_key(uint8_t button);
+    static void release_history_key(uint8_t button);
+    static void step_history(bool forward);
+    static void toggle_compare();
+
+    // Patch library save/load
+    static void update_patch_select_display();
+    static void map_patch_select_buttons(uint8_t button);
+
+    // D-50 internal memory, a handshake transfer runs behind the UI
+    static bool is_d50_action() { return patch_action == PatchAction::D50_WRITE || patch_action == PatchAction::D50_READ; }
+    static void start_d50_transfer();
+    static void finish_d50_transfer();
+
+   // Panel buttons by their UI role. The selectors only follow their
+   // buttons in NORMAL mode, so in the other modes the COMMON and PARTIAL
+   // buttons are free to navigate. In NORMAL mode only ENTER and EXIT
+   // are used: ENTER opens the editor, or the menu when held, and EXIT
+   // opens channel select.
+   static constexpr uint8_t KEY_INC = hardware::GPIO::BTN_COMMON_UPPER;
+   static constexpr uint8_t KEY_DEC = hardware::GPIO::BTN_COMMON_LOWER;
+   static constexpr uint8_t KEY_PREV = hardware::GPIO::BTN_PARTIAL_UP1;   // Parameter, while editing
+   static constexpr uint8_t KEY_NEXT = hardware::GPIO::BTN_PARTIAL_UP2;
+   static constexpr uint8_t KEY_ENTER = hardware::GPIO::BTN_MANUAL;
+   static constexpr uint8_t KEY_EXIT = hardware::GPIO::BTN_MIDI_CHANNEL;
+   static constexpr uint8_t KEY_MENU = KEY_ENTER;  // Held in NORMAL mode
+
+   // PREV VALUE and PARAM REQ work in every mode and act on release, so
+   // either can be held for the other: PREV VALUE with PARAM REQ held
+   // undoes, PARAM REQ with PREV VALUE held redoes
+   static constexpr uint8_t KEY_COMPARE = hardware::GPIO::BTN_PREV_VALUE;
+   static constexpr uint8_t KEY_REQUEST = hardware::GPIO::BTN_PARAM_REQ;
+
+   // Pitch envelope in the common block: times 1-4, then levels 0, 1, 2, sustain, end
+   static constexpr uint8_t PENV_TIME_OFFSET = 13;
+   static constexpr uint8_t PENV_LEVEL_OFFSET = 17;
+
    // Display functions
    static void update_display();
    static void update_normal_display();
@@ -74,6 +140,12 @@ private:
    static void update_parameter_edit_display();
    static void update_system_config_display();
 
+   // Button events from the GPIO queue
+   static void process_button_events();
+
+   // Parameter pots, scaled through the tables in pot_scaling.h
+   static void update_pots();
+
    // Mode updates
    static void update_normal_mode();
    static void update_menu_mode();
@@ -0,0 +1,199 @@
+#include "value_format.h"
+#include "../parameters/parameter_table.h"
+
+namespace pg1000 {
+namespace ui {
+
+namespace {
+
+constexpr const char* NOTE_NAMES[12] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+constexpr uint8_t NOTE_C1 = 24;   // MIDI note of WG Pitch Coarse 0
+constexpr uint8_t NOTE_A1 = 33;   // MIDI note of bias point 0
+constexpr uint8_t BIAS_NOTES = 64;
+
+// D-50 value names
+constexpr const char* KEYFOLLOW[] = {"-1", "-1/2", "-1/4", "0", "1/8", "1/4", "3/8", "1/2", "5/8",
+                                     "3/4", "7/8", "1", "5/4", "3/2", "2", "s1", "s2"};
+constexpr const char* LFO_MODE[] = {"OFF", "(+)", "(-)", "A&L"};
+constexpr const char* ENV_MODE[] = {"OFF", "(+)", "(-)"};
+constexpr const char* BENDER_MODE[] = {"OFF", "KF", "NORM"};
+constexpr const char* WAVEFORM[] = {"SQU", "SAW"};
+constexpr const char* LFO_WAVEFORM[] = {"TRI", "SAW", "SQU", "RND"};
+constexpr const char* LFO_SYNC[] = {"OFF", "ON", "KEY"};
+constexpr const char* LOW_EQ_FREQ[] = {"63", "75", "88", "105", "125", "150", "175", "210",
+                                       "250", "300", "350", "420", "500", "600", "700", "840"};
+constexpr const char* HIGH_EQ_FREQ[] = {"250", "300", "350", "420", "500", "600", "700", "840",
+                                        "1.0k", "1.2k", "1.4k", "1.7k", "2.0k", "2.4k", "2.8k", "3.4k",
+                                        "4.0k", "4.8k", "5.7k", "6.7k", "8.0k", "9.5k"};
+constexpr const char* HIGH_EQ_Q[] = {"0.3", "0.5", "0.7", "1.0", "1.4", "2.0", "3.0", "4.2", "6.0"};
+constexpr const char* KEY_MODE[] = {"U", "L", "UL"};
+
+template <size_t N>
+constexpr ValueFormat list(const char* const (&names)[N]) {
+    return {ValueStyle::LIST, 0, names, static_cast<uint8_t>(N)};
+}
+
+constexpr ValueFormat number(int8_t offset) {
+    return {ValueStyle::NUMBER, offset, nullptr, 0};
+}
+
+constexpr bool names_equal(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+constexpr ValueFormat format_of(const Parameter& param) {
+    auto is = [&param](const char* name) { return names_equal(param.name, name); };
+
+    // Parameters whose units the type alone doesn't tell
+    if (is("WG Pitch Coarse")) return {ValueStyle::NOTE, 0, nullptr, 0};
+    if (is("WG Pitch Fine")) return number(-50);
+    if (is("WG PW Velocity Range")) return number(-7);
+    if (is("TVF Bias Point/Dir") || is("TVA Bias Point Dir")) return {ValueStyle::BIAS_POINT, 0, nullptr, 0};
+    if (is("P-ENV Time Keyfollow")) return number(0);
+    if (is("Structure")) return number(1);
+
+    if (is("WG Mod LFO Mode")) return list(LFO_MODE);
+    if (is("WG Mod P-ENV Mode")) return list(ENV_MODE);
+    if (is("WG Mod Bender Mode")) return list(BENDER_MODE);
+    if (is("WG Waveform")) return list(WAVEFORM);
+    if (is("LFO-1 Waveform")) return list(LFO_WAVEFORM);
+    if (is("LFO-1 Sync")) return list(LFO_SYNC);
+    if (is("Low EQ Freq")) return list(LOW_EQ_FREQ);
+    if (is("High EQ Freq")) return list(HIGH_EQ_FREQ);
+    if (is("High EQ Q")) return list(HIGH_EQ_Q);
+    if (is("Portamento Mode") || is("Hold Mode")) return list(KEY_MODE);
+
+    switch (param.type) {
+        case ParamType::KEYFOLLOW: return list(KEYFOLLOW);
+        case ParamType::BIPOLAR_50: return number(-50);
+        case ParamType::BIPOLAR_24: return number(-24);
+        case ParamType::BIPOLAR_12: return number(-12);
+        case ParamType::BIPOLAR_7: return number(-7);
+        default: return number(param.min_value);
+    }
+}
+
+constexpr std::array<ValueFormat, PARAMETERS.size()> build_formats() {
+    std::array<ValueFormat, PARAMETERS.size()> formats{};
+    for (size_t i = 0; i < PARAMETERS.size(); i++) {
+        formats[i] = format_of(PARAMETERS[i]);
+    }
+    return formats;
+}
+
+constexpr auto FORMATS = build_formats();
+
+constexpr size_t text_length(const char* text) {
+    size_t length = 0;
+    while (text[length]) length++;
+    return length;
+}
+
+// Every raw value has a name or a number that fits in front of the bar
+constexpr bool formats_valid() {
+    for (size_t i = 0; i < PARAMETERS.size(); i++) {
+        const ValueFormat& format = FORMATS[i];
+        int range = PARAMETERS[i].max_value - PARAMETERS[i].min_value;
+        if (format.style == ValueStyle::LIST) {
+            if (range >= format.count) return false;
+            for (uint8_t n = 0; n < format.count; n++) {
+                if (text_length(format.names[n]) > ValueFormatter::MAX_LENGTH) return false;
+            }
+        }
+        if (format.style == ValueStyle::NOTE && range > 96) return false;
+        if (format.style == ValueStyle::BIAS_POINT && range != 2 * BIAS_NOTES - 1) return false;
+    }
+    return true;
+}
+static_assert(formats_valid(), "Value name list too short or a name too long for the display");
+
+uint8_t copy(const char* text, char* out) {
+    uint8_t length = 0;
+    while (text[length] && length < ValueFormatter::MAX_LENGTH) {
+        out[length] = text[length];
+        length++;
+    }
+    return length;
+}
+
+uint8_t format_note(uint8_t note, char* out) {
+    uint8_t length = copy(NOTE_NAMES[note % 12], out);
+    out[length++] = static_cast<char>('0' + note / 12 - 1);
+    return length;
+}
+
+} // namespace
+
+ValueFormat ValueFormatter::get_format(const Parameter* param) {
+    int index = get_parameter_index(param);
+    if (index >= 0) return FORMATS[index];
+    return number(param ? param->min_value : 0);
+}
+
+uint8_t ValueFormatter::format(const Parameter* param, uint8_t raw, char* out) {
+    ValueFormat format = get_format(param);
+    switch (format.style) {
+        case ValueStyle::NOTE:
+            return format_note(NOTE_C1 + raw, out);
+        case ValueStyle::BIAS_POINT:
+            out[0] = (raw < BIAS_NOTES) ? '<' : '>';
+            return 1 + format_note(NOTE_A1 + raw % BIAS_NOTES, out + 1);
+        case ValueStyle::LIST:
+            if (raw < format.count) return copy(format.names[raw], out);
+            break;
+        default:
+            break;
+    }
+    return format_number(raw + format.offset, out, format.offset < 0);
+}
+
+uint8_t ValueFormatter::format_number(int32_t value, char* out, bool plus_sign, uint8_t min_digits) {
+    uint8_t length = 0;
+    uint32_t magnitude = (value < 0) ? -static_cast<uint32_t>(value) : value;
+    if (value < 0) {
+        out[length++] = '-';
+    } else if (plus_sign && value > 0) {
+        out[length++] = '+';
+    }
+
+    // Digits come out backwards
+    char digits[10];
+    uint8_t count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    while (count < min_digits && count < sizeof(digits)) digits[count++] = '0';
+
+    while (count > 0) out[length++] = digits[--count];
+    return length;
+}
+
+LineBuffer& LineBuffer::append(std::string_view piece) {
+    for (char c : piece) append(c);
+    return *this;
+}
+
+LineBuffer& LineBuffer::append(char c) {
+    if (length < SIZE) text[length++] = c;
+    return *this;
+}
+
+LineBuffer& LineBuffer::append_number(int32_t value, uint8_t min_digits) {
+    char digits[12];
+    uint8_t count = ValueFormatter::format_number(value, digits, false, min_digits);
+    return append(std::string_view(digits, count));
+}
+
+LineBuffer& LineBuffer::append_value(const Parameter* param, uint8_t raw) {
+    char value[ValueFormatter::MAX_LENGTH];
+    uint8_t count = ValueFormatter::format(param, raw, value);
+    return append(std::string_view(value, count));
+}
+
+} // namespace ui
+} // namespace pg1000
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <string_view>
+#include "../parameters/parameters.h"
+
+namespace pg1000 {
+namespace ui {
+
+// How a parameter's raw edit buffer value is shown
+enum class ValueStyle : uint8_t {
+    NUMBER,      // raw + offset, with a sign when the range goes negative
+    NOTE,        // C1 upwards
+    BIAS_POINT,  // <A1-<C7, >A1->C7
+    LIST         // One name per value
+};
+
+struct ValueFormat {
+    ValueStyle style;
+    int8_t offset;              // NUMBER: shown = raw + offset
+    const char* const* names;   // LIST
+    uint8_t count;
+};
+
+// Text of values in the units the D-50 shows, from tables built at
+// compile time. No snprintf, nothing on the heap.
+class ValueFormatter {
+public:
+    static constexpr uint8_t MAX_LENGTH = 4;  // Fits in front of the bar
+
+    // Writes the value of a table parameter to out (MAX_LENGTH chars, not
+    // NUL terminated) and returns the length
+    static uint8_t format(const Parameter* param, uint8_t raw, char* out);
+
+    // Decimal digits, zero padded to min_digits, returns the length
+    static uint8_t format_number(int32_t value, char* out, bool plus_sign = false, uint8_t min_digits = 1);
+
+    static ValueFormat get_format(const Parameter* param);
+};
+
+// One LCD line assembled from pieces
+class LineBuffer {
+public:
+    static constexpr uint8_t SIZE = 16;
+
+    LineBuffer& append(std::string_view text);
+    LineBuffer& append(char c);
+    LineBuffer& append_number(int32_t value, uint8_t min_digits = 1);
+    LineBuffer& append_value(const Parameter* param, uint8_t raw);
+
+    std::string_view view() const { return std::string_view(text.data(), length); }
+
+private:
+    std::array<char, SIZE> text = {};
+    uint8_t length = 0;
+};
+
+} // namespace ui
+} // namespace pg1000
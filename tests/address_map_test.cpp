@@ -0,0 +1,86 @@
+// AddressMap: DT1 data from the synth for any partial is matched to its
+// parameter, and only moves the pot filter if the pots read that partial
+
+#include "check.h"
+#include "host.h"
+#include "../src/midi/midi.h"
+#include "../src/midi/address_map.h"
+#include "../src/parameters/parameter_table.h"
+#include "../src/parameters/partial_selector.h"
+#include "../src/parameters/edit_buffer.h"
+#include "../src/hardware/gpio.h"
+#include <vector>
+
+using namespace pg1000;
+using hardware::GPIO;
+using midi::AddressMap;
+using parameters::PartialSelector;
+
+static constexpr int CUTOFF = 10;  // Slot in PARAMETERS
+
+// A DT1 from the synth, one byte
+static void receive_dt1(uint16_t address, uint8_t value) {
+    std::vector<uint8_t> message;
+    midi::SysEx::write_data(midi::SysExCommand::DT1, address, &value, 1,
+                            [&](uint8_t byte) { message.push_back(byte); });
+    host::uart_receive(message.data(), message.size());
+    midi::MIDI::process_incoming();
+}
+
+static void test_every_partial_block_is_mapped() {
+    const ParamGroup partials[] = {
+        ParamGroup::UPPER_PARTIAL_1, ParamGroup::UPPER_PARTIAL_2,
+        ParamGroup::LOWER_PARTIAL_1, ParamGroup::LOWER_PARTIAL_2
+    };
+    bool all = true;
+    for (int i = 0; i < get_parameter_count(); i++) {
+        const Parameter* param = get_parameter(i);
+        if (!is_partial_group(param->group)) {
+            all = all && AddressMap::get_slot(get_edit_address(*param)) == i;
+            continue;
+        }
+        for (ParamGroup partial : partials) {
+            all = all && AddressMap::get_slot(get_group_base(partial) + param->offset) == i;
+        }
+    }
+    CHECK(all);
+
+    // Reserved bytes stay unmapped
+    CHECK_EQ(AddressMap::get_slot(get_group_base(ParamGroup::UPPER_PARTIAL_2) + 60), AddressMap::UNMAPPED);
+    CHECK(AddressMap::get_parameter(get_group_base(ParamGroup::LOWER_PARTIAL_2) + 13) == get_parameter(CUTOFF));
+}
+
+static void test_filter_follows_the_read_partial() {
+    const Parameter* cutoff = get_parameter(CUTOFF);
+    const uint16_t lower1 = get_group_base(ParamGroup::LOWER_PARTIAL_1) + cutoff->offset;
+    const uint16_t upper2 = get_group_base(ParamGroup::UPPER_PARTIAL_2) + cutoff->offset;
+
+    // Pots on Lower Partial 1
+    PartialSelector::handle_button_press(GPIO::BTN_PARTIAL_LOW1);
+    CHECK_EQ(get_parameter_address(cutoff), lower1);
+
+    receive_dt1(lower1, 77);
+    CHECK_EQ(get_parameter_value(cutoff), 77);
+    CHECK(get_filtered_value(cutoff) == 77.0f);
+
+    // Another partial's value lands in the buffer, the filter stays
+    receive_dt1(upper2, 12);
+    CHECK_EQ(parameters::EditBuffer::get(upper2), 12);
+    CHECK(get_filtered_value(cutoff) == 77.0f);
+
+    // Selecting it picks the value up
+    PartialSelector::handle_button_press(GPIO::BTN_PARTIAL_LOW1);
+    PartialSelector::handle_button_press(GPIO::BTN_PARTIAL_UP2);
+    CHECK(get_filtered_value(cutoff) == 12.0f);
+    PartialSelector::handle_button_press(GPIO::BTN_PARTIAL_UP2);
+}
+
+int main() {
+    host::set_time_us(1'000'000);
+    midi::MIDI::init();
+    PartialSelector::init();
+
+    test_every_partial_block_is_mapped();
+    test_filter_follows_the_read_partial();
+    return check::failures;
+}
@@ -0,0 +1,133 @@
+// BulkDump: packets only reach the edit buffer with a good checksum, and
+// a sync asks again for what it's missing
+
+#include "check.h"
+#include "host.h"
+#include "../src/midi/midi.h"
+#include "../src/midi/bulk_dump.h"
+#include "../src/parameters/edit_buffer.h"
+#include <vector>
+
+using namespace pg1000;
+using midi::BulkDump;
+using midi::BulkDumpState;
+using parameters::EditBuffer;
+
+static uint8_t synth_value(uint32_t address) {
+    return (address * 3) & 0x7F;
+}
+
+// A DT1 from the synth, with one data byte changed after the checksum
+// when corrupt is set
+static void receive_dt1(uint32_t address, uint32_t length, bool corrupt = false) {
+    std::vector<uint8_t> data;
+    for (uint32_t i = 0; i < length; i++) data.push_back(synth_value(address + i));
+
+    std::vector<uint8_t> message;
+    midi::SysEx::write_data(midi::SysExCommand::DT1, address, data.data(), data.size(),
+                            [&](uint8_t byte) { message.push_back(byte); });
+    if (corrupt) message[midi::SYSEX_HEADER_SIZE] ^= 0x01;
+
+    // In pieces, as the UART interrupt would hand them over
+    for (size_t i = 0; i < message.size(); i += 64) {
+        size_t piece = std::min<size_t>(64, message.size() - i);
+        host::uart_receive(&message[i], piece);
+        midi::MIDI::process_incoming();
+    }
+}
+
+static bool sent_request(uint32_t address, uint32_t size) {
+    auto addr = midi::SysExAddress::from_linear(address);
+    auto length = midi::SysExAddress::from_linear(size);
+    const uint8_t expected[] = {0xF0, 0x41, 0x00, 0x14, 0x11, addr.msb, addr.mid, addr.lsb,
+                                length.msb, length.mid, length.lsb};
+    if (host::uart_tx.size() != 13) return false;
+    uint8_t sum = 0;
+    for (size_t i = 0; i < sizeof(expected); i++) {
+        if (host::uart_tx[i] != expected[i]) return false;
+        if (i >= 5) sum += expected[i];
+    }
+    return host::uart_tx[11] == ((128 - (sum & 0x7F)) & 0x7F) && host::uart_tx[12] == 0xF7;
+}
+
+static void wait_quiet() {
+    host::advance_us(BulkDump::QUIET_US + 1);
+    midi::MIDI::process_incoming();
+}
+
+static void test_bad_packet_is_requested_again() {
+    EditBuffer::store(300, 5);
+    CHECK(synth_value(300) != 5);
+
+    host::uart_tx.clear();
+    midi::MIDI::request_all_parameters();
+    CHECK(sent_request(0, BulkDump::IMAGE_SIZE));
+
+    receive_dt1(0, 256);
+    receive_dt1(256, BulkDump::IMAGE_SIZE - 256, true);
+    CHECK(BulkDump::get_state() == BulkDumpState::RECEIVING);
+    CHECK_EQ(BulkDump::get_received_count(), 256);
+    CHECK_EQ(EditBuffer::get(10), synth_value(10));
+    CHECK_EQ(EditBuffer::get(300), 5);  // None of the bad packet was stored
+
+    host::uart_tx.clear();
+    wait_quiet();
+    CHECK(sent_request(256, BulkDump::IMAGE_SIZE - 256));
+    CHECK_EQ(BulkDump::get_retries(), 1);
+
+    receive_dt1(256, BulkDump::IMAGE_SIZE - 256);
+    CHECK(BulkDump::get_state() == BulkDumpState::COMPLETE);
+    CHECK(BulkDump::take_completed());
+    CHECK_EQ(EditBuffer::get(300), synth_value(300));
+}
+
+static void test_gap_in_the_middle() {
+    midi::MIDI::request_all_parameters();
+    receive_dt1(0, 100);
+    receive_dt1(200, BulkDump::IMAGE_SIZE - 200);
+
+    host::uart_tx.clear();
+    wait_quiet();
+    CHECK(sent_request(100, 100));
+    receive_dt1(100, 100);
+    CHECK(BulkDump::get_state() == BulkDumpState::COMPLETE);
+}
+
+static void test_gives_up() {
+    midi::MIDI::request_all_parameters();
+    receive_dt1(0, 256, true);
+
+    for (int i = 0; i < BulkDump::MAX_RETRIES; i++) {
+        host::uart_tx.clear();
+        wait_quiet();
+        CHECK(sent_request(0, BulkDump::IMAGE_SIZE));
+        CHECK(BulkDump::get_state() == BulkDumpState::RECEIVING);
+    }
+
+    host::uart_tx.clear();
+    wait_quiet();
+    CHECK(host::uart_tx.empty());
+    CHECK(BulkDump::get_state() == BulkDumpState::FAILED);
+}
+
+static void test_bad_echo_outside_a_sync() {
+    EditBuffer::store(20, 1);
+    uint32_t bad = BulkDump::get_bad_packets();
+    receive_dt1(20, 1, true);
+    CHECK_EQ(EditBuffer::get(20), 1);
+    CHECK_EQ(BulkDump::get_bad_packets(), bad + 1);
+
+    receive_dt1(20, 1);
+    CHECK_EQ(EditBuffer::get(20), synth_value(20));
+}
+
+int main() {
+    host::set_time_us(1'000'000);
+    midi::MIDI::init();
+
+    test_bad_packet_is_requested_again();
+    test_gap_in_the_middle();
+    test_gives_up();
+    test_bad_echo_outside_a_sync();
+    return check::failures;
+}
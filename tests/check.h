@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdio>
+
+// Checks for the host tests. A failed check is reported and counted, and
+// main() returns the count so ctest sees the failure.
+namespace check {
+inline int failures = 0;
+}
+
+#define CHECK(condition)                                                          \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            check::failures++;                                                    \
+        }                                                                         \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                \
+    do {                                                                          \
+        long long a_ = static_cast<long long>(actual);                            \
+        long long e_ = static_cast<long long>(expected);                          \
+        if (a_ != e_) {                                                           \
+            std::printf("%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, \
+                        #actual, a_, e_);                                         \
+            check::failures++;                                                    \
+        }                                                                         \
+    } while (0)
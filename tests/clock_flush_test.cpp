@@ -0,0 +1,148 @@
+// Edits while a sequencer runs: with MIDI clock coming in and the
+// transport running, DT1 goes out on the predicted time of the next
+// sixteenth, otherwise after the usual update interval. START and active
+// sensing count from their own timestamps.
+
+#include "check.h"
+#include "host.h"
+#include "../src/midi/midi.h"
+#include "../src/midi/clock_tracker.h"
+#include "../src/parameters/edit_buffer.h"
+#include "pico/time.h"
+
+using namespace pg1000;
+using midi::ClockTracker;
+using parameters::EditBuffer;
+
+static constexpr uint32_t CLOCK_US = 20'833;  // 120 BPM
+static constexpr uint32_t TICK_US = 250;      // Main loop period
+
+static uint32_t next_clock = 0;
+static uint32_t clock_count = 0;   // Clocks since START, the first is the downbeat
+static bool clock_running = false;
+
+static void receive(uint8_t byte) {
+    host::uart_receive(&byte, 1);
+}
+
+// Main loop for the given time, with the sequencer sending clock. Returns
+// when the first byte went out, 0 if nothing did.
+static uint32_t run(uint32_t duration_us) {
+    host::uart_tx.clear();
+    uint32_t sent_at = 0;
+    uint32_t end = time_us_32() + duration_us;
+    while (static_cast<int32_t>(time_us_32() - end) < 0) {
+        if (clock_running && static_cast<int32_t>(time_us_32() - next_clock) >= 0) {
+            receive(0xF8);
+            next_clock += CLOCK_US;
+            clock_count++;
+        }
+        midi::MIDI::process_incoming();
+        if (sent_at == 0 && !host::uart_tx.empty()) sent_at = time_us_32();
+        host::advance_us(TICK_US);
+    }
+    return sent_at;
+}
+
+static void start_sequencer() {
+    receive(0xFA);
+    clock_running = true;
+    next_clock = time_us_32();
+    clock_count = 0;
+    run(CLOCK_US * 30);
+}
+
+static void test_without_clock() {
+    EditBuffer::set(13, (EditBuffer::get(13) + 1) & 0x7F);
+    uint32_t edited = time_us_32();
+    uint32_t sent = run(50'000);
+    CHECK(sent != 0);
+    CHECK(sent - edited <= midi::MIN_UPDATE_INTERVAL + TICK_US);
+}
+
+static void test_edit_waits_for_sixteenth() {
+    start_sequencer();
+    CHECK(ClockTracker::has_clock());
+    CHECK(ClockTracker::get_transport() == midi::Transport::RUNNING);
+
+    // One clock past a sixteenth, so it waits most of the next one
+    while (clock_count % 6 != 2) run(TICK_US);
+    uint32_t last_clock = next_clock - CLOCK_US;
+    EditBuffer::set(13, (EditBuffer::get(13) + 1) & 0x7F);
+    uint32_t sent = run(200'000);
+
+    // Within a main loop pass of where the next division falls
+    uint32_t division = last_clock + 5 * CLOCK_US;
+    CHECK(sent != 0);
+    CHECK(static_cast<int32_t>(sent - division) >= -static_cast<int32_t>(TICK_US));
+    CHECK(sent - division <= 2 * TICK_US);
+    CHECK_EQ(host::uart_tx[0], 0xF0);
+}
+
+static void test_stopped_or_disabled_sends_at_once() {
+    receive(0xFC);
+    run(CLOCK_US);
+    CHECK(ClockTracker::get_transport() == midi::Transport::STOPPED);
+    test_without_clock();
+
+    receive(0xFB);
+    midi::MIDI::set_flush_division(0);
+    run(CLOCK_US);
+    test_without_clock();
+    midi::MIDI::set_flush_division(midi::FLUSH_DIVISION);
+}
+
+static void test_first_division_after_start() {
+    // Stopped with the clock running, START half way between two clocks.
+    // The sequencer restarts its grid there, the downbeat is one clock on.
+    receive(0xFC);
+    run(CLOCK_US * 12);
+    run(CLOCK_US / 2);
+    uint32_t started = time_us_32();
+    receive(0xFA);
+    next_clock = started + CLOCK_US;
+    clock_count = 0;
+    midi::MIDI::process_incoming();
+
+    EditBuffer::set(13, (EditBuffer::get(13) + 1) & 0x7F);
+    uint32_t sent = run(200'000);
+    uint32_t downbeat = started + CLOCK_US;
+    CHECK(sent != 0);
+    CHECK(static_cast<int32_t>(sent - downbeat) >= -static_cast<int32_t>(TICK_US));
+    CHECK(sent - downbeat <= 2 * TICK_US);
+    CHECK_EQ(ClockTracker::get_beat_count(), 0);
+
+    // The START to downbeat gap isn't taken for a clock interval
+    run(CLOCK_US * 24);
+    CHECK(ClockTracker::get_bpm_x100() >= 11'990 && ClockTracker::get_bpm_x100() <= 12'010);
+}
+
+static void test_sensing_keeps_link_up() {
+    // Sensing that only reaches the parser, as from loopback, still counts
+    // at its own time
+    clock_running = false;
+    receive(0xFE);
+    run(100'000);
+    CHECK(midi::ClockTracker::is_link_up());
+    run(ClockTracker::SENSING_TIMEOUT_US);
+    CHECK(!midi::ClockTracker::is_link_up());
+
+    midi::MIDI::set_loopback(true);
+    const uint8_t sensing = 0xFE;
+    midi::MIDI::loopback_receive(&sensing, 1);
+    run(TICK_US);
+    CHECK(midi::ClockTracker::is_link_up());
+    midi::MIDI::set_loopback(false);
+}
+
+int main() {
+    host::set_time_us(1'000'000);
+    midi::MIDI::init();
+
+    test_without_clock();
+    test_edit_waits_for_sixteenth();
+    test_stopped_or_disabled_sends_at_once();
+    test_first_division_after_start();
+    test_sensing_keeps_link_up();
+    return check::failures;
+}
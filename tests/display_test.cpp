@@ -0,0 +1,234 @@
+// Display on the character LCD: what reaches the HD44780 through its
+// PCF8574 backpack, what it costs on the bus, and how the queue recovers
+// from lost writes
+
+#include "check.h"
+#include "host.h"
+#include "i2c_bus.h"
+#include "../src/hardware/display.h"
+#include <cstring>
+#include <string>
+
+using namespace pg1000;
+using hardware::Display;
+using hardware::I2C;
+
+// HD44780 in 4-bit mode behind a PCF8574: P0 RS, P2 E, P4-P7 data.
+// Latches a nibble on the falling edge of E.
+class Lcd : public host::I2CDevice {
+public:
+    char ddram[0x80];
+    uint8_t cgram[64];
+
+    Lcd() {
+        memset(ddram, ' ', sizeof(ddram));
+        memset(cgram, 0, sizeof(cgram));
+    }
+
+    std::string row(uint8_t n) const { return std::string(&ddram[n * 0x40], Display::COLS); }
+
+    void write(const uint8_t* data, size_t length) override {
+        for (size_t i = 0; i < length; i++) {
+            bool enable = data[i] & 0x04;
+            if (last_enable && !enable) latch(data[i]);
+            last_enable = enable;
+        }
+    }
+    void read(uint8_t*, size_t) override {}
+
+private:
+    bool last_enable = false;
+    bool four_bit = false;
+    bool high_done = false;
+    uint8_t high = 0;
+    bool in_cgram = false;
+    uint8_t address = 0;
+
+    void latch(uint8_t pins) {
+        uint8_t nibble = pins & 0xF0;
+        if (!four_bit) {
+            // 8-bit mode, only the upper data lines are wired
+            if (nibble == 0x20) four_bit = true;
+            return;
+        }
+        if (!high_done) {
+            high = nibble;
+            high_done = true;
+            return;
+        }
+        high_done = false;
+        uint8_t value = high | (nibble >> 4);
+        if (pins & 0x01) {
+            data(value);
+        } else {
+            command(value);
+        }
+    }
+
+    void command(uint8_t value) {
+        if (value & 0x80) {
+            in_cgram = false;
+            address = value & 0x7F;
+        } else if (value & 0x40) {
+            in_cgram = true;
+            address = value & 0x3F;
+        } else if (value == 0x01) {
+            memset(ddram, ' ', sizeof(ddram));
+            in_cgram = false;
+            address = 0;
+        }
+    }
+
+    void data(uint8_t value) {
+        if (in_cgram) {
+            cgram[address] = value;
+            address = (address + 1) & 0x3F;
+        } else {
+            ddram[address] = static_cast<char>(value);
+            address = (address + 1) & 0x7F;
+        }
+    }
+};
+
+static Lcd lcd;
+
+static void settle() {
+    for (int i = 0; i < 200 && Display::is_busy(); i++) host::advance_us(1000);
+    host::advance_us(1000);  // Last stream through the bus
+}
+
+// I2C1 bytes, address bytes included, to bring the LCD up to date
+static uint32_t flush_bytes() {
+    uint32_t start = host::get_i2c_bytes(I2C::Bus::BUS1);
+    Display::flush();
+    settle();
+    return host::get_i2c_bytes(I2C::Bus::BUS1) - start;
+}
+
+// Each LCD byte is two nibbles, each sent with E high then low
+static constexpr uint32_t BYTES_PER_OP = 4;
+
+// Both rows rewritten, as before the diff: two I2C writes of an address
+// and 16 cells each
+static constexpr uint32_t FULL_SCREEN = 2 * (1 + (1 + Display::COLS) * BYTES_PER_OP);
+
+static void test_value_step_bus_bytes() {
+    Display::show_parameter("TVF Cutoff Freq", "50", 50, 100);
+    flush_bytes();
+    CHECK(lcd.row(0) == std::string("TVF Cutoff Freq "));
+
+    // Nothing changed, nothing sent
+    Display::show_parameter("TVF Cutoff Freq", "50", 50, 100);
+    CHECK_EQ(flush_bytes(), 0);
+
+    // One digit and the bar's leading cell: two runs of address and one
+    // cell, in one I2C write
+    Display::show_parameter("TVF Cutoff Freq", "51", 51, 100);
+    uint32_t step = flush_bytes();
+    CHECK_EQ(step, 1 + 4 * BYTES_PER_OP);
+    CHECK(step * 8 <= FULL_SCREEN);
+    CHECK(lcd.row(1).substr(0, 4) == std::string(" 51 "));
+
+    // A bigger step: the tens digit, then one run over two bar cells
+    Display::show_parameter("TVF Cutoff Freq", "61", 61, 100);
+    CHECK_EQ(flush_bytes(), 1 + 5 * BYTES_PER_OP);
+
+    // Another parameter changes most of the name row as well
+    Display::show_parameter("TVF Resonance", "12", 12, 30);
+    CHECK(flush_bytes() < FULL_SCREEN);
+}
+
+// Bar cells of the second row, glyph slots as digits
+static std::string bar_cells() {
+    std::string cells = lcd.row(1).substr(4);
+    for (char& c : cells) {
+        if (c >= 1 && c <= 6) c = static_cast<char>('0' + c);
+    }
+    return cells;
+}
+
+static void test_signed_bar_grows_from_zero() {
+    // -50..+50: zero in the middle, one column left of it at 0
+    Display::show_parameter("TVA Velocity Rng", "0", 50, 100, 50);
+    flush_bytes();
+    CHECK(bar_cells() == std::string("     6      "));
+    CHECK_EQ(lcd.cgram[6 * 8], 0x01);
+
+    Display::show_parameter("TVA Velocity Rng", "+50", 100, 100, 50);
+    flush_bytes();
+    CHECK(bar_cells() == std::string("      555555"));
+
+    // -12..0: zero at the right end, so -6 fills the right half
+    Display::show_parameter("TVA Bias Level", "-6", 6, 12, 12);
+    flush_bytes();
+    CHECK(bar_cells() == std::string("      555555"));
+
+    Display::show_parameter("TVA Bias Level", "0", 12, 12, 12);
+    flush_bytes();
+    CHECK(bar_cells() == std::string("           6"));
+
+    Display::show_parameter("TVA Bias Level", "-12", 0, 12, 12);
+    flush_bytes();
+    CHECK(bar_cells() == std::string(12, '5'));
+
+    // -7..+7, a step is about four columns either way
+    Display::show_parameter("TVF Bias Level", "-1", 6, 14, 7);
+    flush_bytes();
+    CHECK(bar_cells() == std::string("     6      "));
+    CHECK_EQ(lcd.cgram[6 * 8], 0x0F);
+    Display::show_parameter("TVF Bias Level", "+1", 8, 14, 7);
+    flush_bytes();
+    CHECK(bar_cells() == std::string("      4     "));
+}
+
+static void test_full_queue_drops_and_resyncs() {
+    // Screens written faster than the bus drains. Nothing blocks, or
+    // this would never return with the clock standing still.
+    for (int i = 0; i < 20; i++) {
+        std::string line(Display::COLS, static_cast<char>('A' + i));
+        Display::show_message(line, line);
+        Display::flush();
+    }
+    CHECK(Display::get_queue_stats().dropped > 0);
+
+    settle();
+    uint32_t resyncs = Display::get_queue_stats().resyncs;
+    Display::flush();
+    CHECK_EQ(Display::get_queue_stats().resyncs, resyncs + 1);
+    settle();
+
+    CHECK(lcd.row(0) == std::string(Display::COLS, 'T'));
+    CHECK(lcd.row(1) == std::string(Display::COLS, 'T'));
+
+    // Bar glyphs went again too
+    CHECK_EQ(lcd.cgram[5 * 8], 0x1F);
+    CHECK_EQ(lcd.cgram[1 * 8], 0x10);
+}
+
+static void test_lost_stream_resyncs() {
+    host::attach_i2c(I2C::Bus::BUS1, I2C::ADDR_LCD, nullptr);  // NACKs
+    Display::show_message("Unplugged", "");
+    Display::flush();
+    settle();
+
+    host::attach_i2c(I2C::Bus::BUS1, I2C::ADDR_LCD, &lcd);
+    Display::show_message("Back", "again");
+    Display::flush();
+    settle();
+    CHECK(lcd.row(0) == std::string("Back            "));
+    CHECK(lcd.row(1) == std::string("again           "));
+}
+
+int main() {
+    host::attach_i2c(I2C::Bus::BUS1, I2C::ADDR_LCD, &lcd);
+    Display::init(hardware::DisplayType::LCD_16X2);
+    Display::flush();
+    settle();
+    CHECK(lcd.row(0) == std::string(Display::COLS, ' '));
+
+    test_value_step_bus_bytes();
+    test_signed_bar_grows_from_zero();
+    test_full_queue_drops_and_resyncs();
+    test_lost_stream_resyncs();
+    return check::failures;
+}
@@ -0,0 +1,133 @@
+// EditHistory: coalescing of quick moves and the ring wrapping when full
+
+#include "check.h"
+#include "../src/parameters/edit_history.h"
+#include "../src/parameters/edit_buffer.h"
+
+using namespace pg1000::parameters;
+
+static uint32_t now_us = 0;
+
+// A local edit of one step, as a pot or INC would make it
+static void edit(uint16_t address, uint32_t after_us) {
+    now_us += after_us;
+    uint8_t old_value = EditBuffer::get(address);
+    uint8_t new_value = (old_value + 1) & 0x7F;
+    EditBuffer::set(address, new_value);
+    EditHistory::record(address, old_value, new_value, now_us);
+}
+
+static void test_sweep_is_one_step() {
+    EditHistory::clear();
+    EditBuffer::set(10, 0);
+
+    // 100 steps 1 ms apart
+    for (int i = 0; i < 100; i++) edit(10, 1000);
+    CHECK_EQ(EditHistory::get_undo_count(), 1);
+
+    CHECK_EQ(EditHistory::undo(), 1);
+    CHECK_EQ(EditBuffer::get(10), 0);
+    CHECK_EQ(EditHistory::redo(), 1);
+    CHECK_EQ(EditBuffer::get(10), 100);
+}
+
+static void test_pause_starts_a_new_step() {
+    EditHistory::clear();
+    edit(10, 1000);
+    edit(10, EditHistory::COALESCE_US);
+    CHECK_EQ(EditHistory::get_undo_count(), 2);
+}
+
+static void test_back_to_start_leaves_nothing() {
+    EditHistory::clear();
+    now_us += EditHistory::COALESCE_US;
+    EditHistory::record(11, 0, 5, now_us += 10);
+    EditHistory::record(11, 5, 0, now_us += 10);
+    CHECK_EQ(EditHistory::get_undo_count(), 0);
+    CHECK_EQ(EditHistory::get_redo_count(), 0);
+}
+
+static void test_interleaved_addresses() {
+    // A macro pot moves four addresses in turn, one record each
+    EditHistory::clear();
+    now_us += EditHistory::COALESCE_US;
+    for (int i = 0; i < 50; i++) {
+        for (uint16_t address = 40; address < 44; address++) edit(address, 100);
+    }
+    CHECK_EQ(EditHistory::get_undo_count(), 4);
+
+    // Beyond COALESCE_DEPTH addresses the oldest stops being extended
+    EditHistory::clear();
+    now_us += EditHistory::COALESCE_US;
+    for (int i = 0; i < 2; i++) {
+        for (uint16_t address = 40; address < 40 + EditHistory::COALESCE_DEPTH + 1; address++) edit(address, 100);
+    }
+    CHECK_EQ(EditHistory::get_undo_count(), 2 * (EditHistory::COALESCE_DEPTH + 1));
+}
+
+static void test_wraparound() {
+    EditHistory::clear();
+    EditBuffer::set(20, 0);
+    EditBuffer::set(21, 0);
+
+    // Twice the capacity, each its own step
+    const uint16_t edits = 2 * EditHistory::CAPACITY + 3;
+    for (uint16_t i = 0; i < edits; i++) edit((i % 2) ? 20 : 21, EditHistory::COALESCE_US);
+    CHECK_EQ(EditHistory::get_undo_count(), EditHistory::CAPACITY);
+
+    // The oldest surviving record is the first one not dropped
+    const EditHistory::Record* oldest = EditHistory::get_record(0);
+    CHECK(oldest != nullptr);
+    if (oldest) CHECK_EQ(oldest->address, ((edits - EditHistory::CAPACITY) % 2) ? 20 : 21);
+    CHECK(EditHistory::get_record(EditHistory::CAPACITY) == nullptr);
+
+    // All the way back gets to where the ring starts, not further
+    uint8_t end20 = EditBuffer::get(20);
+    uint8_t end21 = EditBuffer::get(21);
+    CHECK_EQ(EditHistory::undo(UINT16_MAX), EditHistory::CAPACITY);
+    uint16_t dropped = edits - EditHistory::CAPACITY;
+    CHECK_EQ(EditBuffer::get(20), (dropped / 2) & 0x7F);
+    CHECK_EQ(EditBuffer::get(21), ((dropped + 1) / 2) & 0x7F);
+
+    CHECK_EQ(EditHistory::redo(UINT16_MAX), EditHistory::CAPACITY);
+    CHECK_EQ(EditBuffer::get(20), end20);
+    CHECK_EQ(EditBuffer::get(21), end21);
+
+    // Wrapped once more from the middle
+    EditHistory::undo(10);
+    for (uint16_t i = 0; i < EditHistory::CAPACITY; i++) edit(22, EditHistory::COALESCE_US);
+    CHECK_EQ(EditHistory::get_undo_count(), EditHistory::CAPACITY);
+    CHECK_EQ(EditHistory::get_redo_count(), 0);
+}
+
+static void test_new_edit_drops_redo() {
+    EditHistory::clear();
+    for (int i = 0; i < 5; i++) edit(30, EditHistory::COALESCE_US);
+    EditHistory::undo(3);
+    CHECK_EQ(EditHistory::get_redo_count(), 3);
+
+    edit(31, EditHistory::COALESCE_US);
+    CHECK_EQ(EditHistory::get_undo_count(), 3);
+    CHECK_EQ(EditHistory::get_redo_count(), 0);
+}
+
+static void test_undo_does_not_extend() {
+    // An edit right after an undo is a new step, not part of the undone one
+    EditHistory::clear();
+    edit(32, EditHistory::COALESCE_US);
+    edit(33, EditHistory::COALESCE_US);
+    EditHistory::undo();
+    edit(32, 10);
+    CHECK_EQ(EditHistory::get_undo_count(), 2);
+}
+
+int main() {
+    test_sweep_is_one_step();
+    test_pause_starts_a_new_step();
+    test_back_to_start_leaves_nothing();
+    test_interleaved_addresses();
+    test_wraparound();
+    test_new_edit_drops_redo();
+    test_undo_does_not_extend();
+    return check::failures;
+}
@@ -0,0 +1,106 @@
+// FactoryBanks: the bank generated from banks/Starter.syx is read in place
+// from the const table, and a patch from it goes to the synth as the DT1
+// packets of the edit buffer blocks
+
+#include "check.h"
+#include "host.h"
+#include "../src/parameters/factory_banks.h"
+#include "../src/parameters/edit_buffer.h"
+#include "../src/midi/midi.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace pg1000;
+using parameters::FactoryBanks;
+using parameters::PatchView;
+
+static constexpr uint16_t PATCH_NAME = 384;  // Patch block, 18 characters
+static constexpr uint8_t PATCH_NAME_LENGTH = 18;
+
+// D-50 character set
+static std::string patch_name(const PatchView& view) {
+    static const char chars[] = " ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-";
+    std::string name;
+    for (uint8_t i = 0; i < PATCH_NAME_LENGTH; i++) {
+        uint8_t code = view[PATCH_NAME + i];
+        name += (code < sizeof(chars) - 1) ? chars[code] : '?';
+    }
+    return name.substr(0, name.find_last_not_of(' ') + 1);
+}
+
+// Banks are in file name order, others may be added around it
+static uint8_t starter = 0;
+
+static void test_bank_is_embedded() {
+    const uint8_t count = FactoryBanks::get_bank_count();
+    while (starter < count && std::string(FactoryBanks::get_bank_name(starter)) != "Starter") starter++;
+    CHECK(starter < count);
+    CHECK_EQ(FactoryBanks::get_patch_count(starter), 64);
+
+    CHECK(patch_name(FactoryBanks::get_patch(starter, 0)) == "Pad Pad 11");
+    CHECK(patch_name(FactoryBanks::get_patch(starter, 9)) == "Brass Bass 22");
+    CHECK(patch_name(FactoryBanks::get_patch(starter, 63)) == "Organ Lead 88");
+
+    CHECK(FactoryBanks::get_patch(starter, 64).empty());
+    CHECK(FactoryBanks::get_patch(count, 0).empty());
+    CHECK(FactoryBanks::get_bank_name(count) == nullptr);
+}
+
+static void test_views_point_into_table() {
+    // Every view is the record itself, back to back in the table, never a copy
+    const uint8_t* records = parameters::FACTORY_BANKS[starter].records;
+    for (uint8_t patch = 0; patch < FactoryBanks::get_patch_count(starter); patch++) {
+        PatchView view = FactoryBanks::get_patch(starter, patch);
+        CHECK(view.data() == records + patch * PatchView::SIZE);
+        CHECK(FactoryBanks::get_patch(starter, patch).data() == view.data());
+    }
+}
+
+// DT1 for one block, built by hand
+static void append_dt1(std::vector<uint8_t>& out, uint16_t address, const uint8_t* data, uint8_t length) {
+    uint8_t header[] = {0xF0, 0x41, 0x00, 0x14, 0x12,
+                        static_cast<uint8_t>(address >> 14), static_cast<uint8_t>((address >> 7) & 0x7F),
+                        static_cast<uint8_t>(address & 0x7F)};
+    out.insert(out.end(), header, header + sizeof(header));
+    uint32_t sum = header[5] + header[6] + header[7];
+    for (uint8_t i = 0; i < length; i++) {
+        out.push_back(data[i]);
+        sum += data[i];
+    }
+    out.push_back((128 - (sum & 0x7F)) & 0x7F);
+    out.push_back(0xF7);
+}
+
+static void test_send_patch_from_flash() {
+    PatchView view = FactoryBanks::get_patch(starter, 9);
+    std::vector<uint8_t> expected;
+    for (size_t block = 0; block < EDIT_BLOCK_LENGTHS.size(); block++) {
+        uint16_t address = block * EDIT_BLOCK_SIZE;
+        append_dt1(expected, address, view.data() + address, EDIT_BLOCK_LENGTHS[block]);
+    }
+
+    host::uart_tx.clear();
+    CHECK(midi::MIDI::send_patch(view) == midi::MidiError::OK);
+    host::advance_us(500'000);  // Drain the UART
+    CHECK_EQ(host::uart_tx.size(), expected.size());
+    CHECK(host::uart_tx == expected);
+
+    // Upper partial 1 starts at 00-00-00, the patch block at 00-03-00
+    CHECK_EQ(host::uart_tx[5] + host::uart_tx[6] + host::uart_tx[7], 0);
+    size_t last = expected.size() - (EDIT_BLOCK_LENGTHS.back() + midi::SysExConst::DATA_OVERHEAD);
+    CHECK_EQ(host::uart_tx[last + 6], 3);
+
+    // And the edit buffer holds it
+    CHECK(std::memcmp(parameters::EditBuffer::data(), view.data(), PatchView::SIZE) == 0);
+}
+
+int main() {
+    host::set_time_us(1'000'000);
+    midi::MIDI::init();
+
+    test_bank_is_embedded();
+    test_views_point_into_table();
+    test_send_patch_from_flash();
+    return check::failures;
+}
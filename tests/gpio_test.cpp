@@ -0,0 +1,226 @@
+// GPIO: buttons through a modelled MCP23017, from the switch to the
+// event queue. Edge times come from INTA, bounces are rejected and an
+// idle panel costs nothing on the bus.
+
+#include "check.h"
+#include "host.h"
+#include "i2c_bus.h"
+#include "../src/hardware/gpio.h"
+#include "../src/hardware/hardware.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include <vector>
+
+using namespace pg1000;
+using hardware::ButtonEvent;
+using hardware::ButtonEventType;
+using hardware::GPIO;
+using hardware::I2C;
+using hardware::Pins;
+
+// MCP23017 in bank 0 with sequential addressing and INTA mirrored over
+// both ports. Interrupt on change against the previous value: the first
+// change latches INTF and INTCAP and pulls INTA low, reading INTCAP or
+// GPIO of that port clears it.
+class Expander : public host::I2CDevice {
+public:
+    static constexpr uint8_t IODIRA = 0x00, GPINTENA = 0x04, IOCON = 0x0A;
+    static constexpr uint8_t INTFA = 0x0E, INTCAPA = 0x10, GPIOA = 0x12, OLATA = 0x14;
+
+    uint8_t regs[0x16] = {};
+    uint16_t inputs = 0xFFFF;  // Pulled up, a pressed button reads low
+
+    Expander() { regs[IODIRA] = regs[IODIRA + 1] = 0xFF; }
+
+    void set_input(uint8_t bit, bool pressed) {
+        uint16_t before = inputs;
+        inputs = pressed ? (inputs & ~(1 << bit)) : (inputs | (1 << bit));
+        for (uint8_t port = 0; port < 2; port++) {
+            uint8_t changed = ((before ^ inputs) >> (8 * port)) & regs[GPINTENA + port] & regs[IODIRA + port];
+            if (changed == 0 || regs[INTFA + port] != 0) continue;
+            regs[INTFA + port] = changed;
+            regs[INTCAPA + port] = inputs >> (8 * port);
+        }
+        update_inta();
+    }
+
+    void write(const uint8_t* data, size_t length) override {
+        if (length == 0) return;
+        pointer = data[0];
+        for (size_t i = 1; i < length; i++) {
+            uint8_t reg = pointer;
+            if (reg == GPIOA || reg == GPIOA + 1) reg += OLATA - GPIOA;  // Writes go to the latch
+            if (reg < sizeof(regs)) regs[reg] = data[i];
+            pointer++;
+        }
+    }
+
+    void read(uint8_t* data, size_t length) override {
+        for (size_t i = 0; i < length; i++, pointer++) {
+            data[i] = read_register(pointer);
+        }
+        update_inta();
+    }
+
+private:
+    uint8_t pointer = 0;
+
+    uint8_t read_register(uint8_t reg) {
+        if (reg >= sizeof(regs)) return 0;
+        if (reg == INTCAPA || reg == INTCAPA + 1 || reg == GPIOA || reg == GPIOA + 1) {
+            regs[INTFA + (reg & 1)] = 0;
+        }
+        if (reg == GPIOA || reg == GPIOA + 1) {
+            uint8_t port = reg & 1;
+            uint8_t pins = inputs >> (8 * port);
+            return (pins & regs[IODIRA + port]) | (regs[OLATA + port] & ~regs[IODIRA + port]);
+        }
+        return regs[reg];
+    }
+
+    void update_inta() {
+        host::set_pin(Pins::MCP23017_INTA, regs[INTFA] == 0 && regs[INTFA + 1] == 0);
+    }
+};
+
+static Expander expander;
+
+// Port bit of each button
+static constexpr uint8_t BIT_MANUAL = 7;
+static constexpr uint8_t BIT_PARAM_REQ = 14;
+
+// Main loop at 1 kHz for the given time
+static void run_ms(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+        GPIO::update();
+        host::advance_us(1000);
+    }
+    GPIO::update();
+}
+
+static std::vector<ButtonEvent> take_events() {
+    std::vector<ButtonEvent> events;
+    ButtonEvent event;
+    while (GPIO::next_event(event)) events.push_back(event);
+    return events;
+}
+
+static uint32_t bus_transactions() {
+    return host::get_i2c_transactions(I2C::Bus::BUS0);
+}
+
+static void test_init_configures_expander() {
+    CHECK_EQ(expander.regs[Expander::IOCON], 0x44);
+    CHECK_EQ(expander.regs[Expander::IODIRA + 1], 0xC0);
+    CHECK_EQ(expander.regs[Expander::GPINTENA], 0xFF);
+    CHECK_EQ(expander.regs[Expander::GPINTENA + 1], 0xC0);
+    CHECK(gpio_get(Pins::MCP23017_INTA));
+}
+
+static void test_idle_reads_nothing() {
+    run_ms(10);
+    uint32_t start = bus_transactions();
+    run_ms(2000);
+    CHECK_EQ(bus_transactions(), start);
+    CHECK_EQ(GPIO::get_stats().transactions, 0);
+    CHECK(take_events().empty());
+}
+
+static void test_press_and_release_times() {
+    uint32_t pressed_at = time_us_32() + 300;
+    host::advance_us(300);
+    expander.set_input(BIT_MANUAL, true);
+    CHECK(!gpio_get(Pins::MCP23017_INTA));
+
+    // The read lands a few updates later, the event keeps the edge time
+    run_ms(3);
+    CHECK(gpio_get(Pins::MCP23017_INTA));
+    std::vector<ButtonEvent> events = take_events();
+    CHECK_EQ(events.size(), 1);
+    CHECK_EQ(events[0].button, GPIO::BTN_MANUAL);
+    CHECK(events[0].type == ButtonEventType::PRESS);
+    CHECK_EQ(events[0].time_us, pressed_at);
+    CHECK(GPIO::get_button(GPIO::BTN_MANUAL));
+
+    run_ms(100);
+    uint32_t released_at = time_us_32();
+    expander.set_input(BIT_MANUAL, false);
+    run_ms(3);
+    events = take_events();
+    CHECK_EQ(events.size(), 1);
+    CHECK(events[0].type == ButtonEventType::RELEASE);
+    CHECK_EQ(events[0].time_us, released_at);
+    CHECK(!GPIO::get_button(GPIO::BTN_MANUAL));
+}
+
+static void test_port_b_button() {
+    run_ms(20);
+    expander.set_input(BIT_PARAM_REQ, true);
+    run_ms(3);
+    std::vector<ButtonEvent> events = take_events();
+    CHECK_EQ(events.size(), 1);
+    CHECK_EQ(events[0].button, GPIO::BTN_PARAM_REQ);
+    CHECK(events[0].type == ButtonEventType::PRESS);
+
+    // LEDs share the port and don't look like buttons
+    GPIO::set_led(GPIO::LED_PARTIAL_UP1, hardware::LedState::ON);
+    run_ms(3);
+    CHECK_EQ(expander.regs[Expander::OLATA + 1], 0x04);
+    CHECK(take_events().empty());
+    GPIO::set_led(GPIO::LED_PARTIAL_UP1, hardware::LedState::OFF);
+
+    expander.set_input(BIT_PARAM_REQ, false);
+    run_ms(3);
+    events = take_events();
+    CHECK_EQ(events.size(), 1);
+    CHECK(events[0].type == ButtonEventType::RELEASE);
+}
+
+static void test_bounce_is_rejected() {
+    run_ms(GPIO::DOUBLE_PRESS_US / 1000);  // Not a double press of the last one
+
+    // Contact bounce over 2 ms, each edge read as it comes
+    uint32_t pressed_at = time_us_32();
+    for (int i = 0; i < 4; i++) {
+        expander.set_input(BIT_MANUAL, i % 2 == 0);
+        run_ms(1);
+    }
+    expander.set_input(BIT_MANUAL, true);
+    run_ms(20);
+
+    std::vector<ButtonEvent> events = take_events();
+    CHECK_EQ(events.size(), 1);
+    CHECK(events[0].type == ButtonEventType::PRESS);
+    CHECK_EQ(events[0].time_us, pressed_at);
+    CHECK(GPIO::get_button(GPIO::BTN_MANUAL));
+
+    // Bouncing on the way up ends released, even with the last edge rejected
+    uint32_t start = bus_transactions();
+    for (int i = 0; i < 3; i++) {
+        expander.set_input(BIT_MANUAL, i % 2 != 0);
+        run_ms(1);
+    }
+    run_ms(20);
+    events = take_events();
+    CHECK_EQ(events.size(), 1);
+    CHECK(events[0].type == ButtonEventType::RELEASE);
+    CHECK(!GPIO::get_button(GPIO::BTN_MANUAL));
+
+    // And the bus goes quiet again
+    uint32_t reads = bus_transactions() - start;
+    run_ms(500);
+    CHECK_EQ(bus_transactions() - start, reads);
+}
+
+int main() {
+    host::set_time_us(1'000'000);
+    host::attach_i2c(I2C::Bus::BUS0, I2C::ADDR_MCP23017, &expander);
+    CHECK(GPIO::init());
+
+    test_init_configures_expander();
+    test_idle_reads_nothing();
+    test_press_and_release_times();
+    test_port_b_button();
+    test_bounce_is_rejected();
+    return check::failures;
+}
@@ -0,0 +1,260 @@
+// Handshake: patch transfers to and from D-50 internal memory through the
+// menu and whole banks both ways, against the local D-50 stand-in on
+// loopback
+
+#include "check.h"
+#include "host.h"
+#include "../src/midi/midi.h"
+#include "../src/midi/handshake.h"
+#include "../src/midi/d50_responder.h"
+#include "../src/parameters/edit_buffer.h"
+#include "../src/hardware/gpio.h"
+#include "../src/ui/interface.h"
+#include <array>
+#include <vector>
+
+using namespace pg1000;
+using hardware::GPIO;
+using midi::D50Responder;
+using midi::Handshake;
+using midi::TransferState;
+using parameters::EditBuffer;
+
+static constexpr uint32_t PACKET_DATA = midi::SysExConst::MAX_PACKET_DATA;
+using ui::Interface;
+using ui::Mode;
+
+static void press(uint8_t button) {
+    Interface::handle_button_press(button);
+    Interface::handle_button_release(button);
+}
+
+// Runs the main loop until the transfer is over
+static void run_transfer(int max_passes = 10'000) {
+    for (int i = 0; i < max_passes && Handshake::is_busy(); i++) {
+        midi::MIDI::process_incoming();
+        Interface::update();
+        host::advance_us(100);
+    }
+    Interface::update();
+}
+
+static uint32_t patch_address(uint8_t patch) {
+    return Handshake::PATCH_MEMORY + patch * Handshake::PATCH_STRIDE;
+}
+
+// Both selections carry on from where the last one was left, the menu
+// starts at MIDI Channel and the patch at I11
+static void choose_d50_patch(uint8_t menu_steps, uint8_t patch_steps) {
+    Interface::set_mode(Mode::MENU);
+    for (uint8_t i = 0; i < menu_steps; i++) press(GPIO::BTN_COMMON_UPPER);
+    press(GPIO::BTN_MANUAL);
+    CHECK(Interface::get_current_mode() == Mode::PATCH_SELECT);
+    for (uint8_t i = 0; i < patch_steps; i++) press(GPIO::BTN_COMMON_UPPER);
+    press(GPIO::BTN_MANUAL);
+    CHECK(Interface::get_current_mode() == Mode::NORMAL);
+}
+
+static void test_write_from_menu() {
+    uint32_t sum = 0;
+    for (uint16_t i = 0; i < EDIT_BUFFER_SIZE; i++) {
+        EditBuffer::store(i, (i * 5 + 1) & 0x7F);
+        sum += (i * 5 + 1) & 0x7F;
+    }
+
+    choose_d50_patch(static_cast<uint8_t>(ui::MenuItem::D50_WRITE), 3);  // I14
+    CHECK(Handshake::is_busy());
+    run_transfer();
+
+    CHECK(Handshake::get_state() == TransferState::COMPLETE);
+    CHECK_EQ(Handshake::get_bytes_done(), Handshake::PATCH_STRIDE);
+    CHECK_EQ(D50Responder::get_bytes_written(), Handshake::PATCH_STRIDE);
+    CHECK_EQ(D50Responder::get_write_sum(), sum);  // Padding goes out as zero
+}
+
+static void test_read_from_menu() {
+    choose_d50_patch(1, 2);  // Read from D-50, I16
+    CHECK(Handshake::is_busy());
+    run_transfer();
+
+    CHECK(Handshake::get_state() == TransferState::COMPLETE);
+    bool same = true;
+    for (uint16_t i = 0; i < EDIT_BUFFER_SIZE; i++) {
+        same = same && EditBuffer::get(i) == D50Responder::read(patch_address(5) + i);
+    }
+    CHECK(same);
+
+    // The synth's edit buffer got the patch too
+    CHECK_EQ(D50Responder::read(0), D50Responder::read(patch_address(5)));
+    CHECK_EQ(D50Responder::read(400), D50Responder::read(patch_address(5) + 400));
+}
+
+static void test_errors_are_retried() {
+    D50Responder::reset();
+    D50Responder::set_error_interval(3);
+    uint32_t retries = Handshake::get_retries();
+
+    // Every third DAT each way is refused or corrupted
+    std::array<uint8_t, Handshake::PATCH_STRIDE> image;
+    uint32_t sum = 0;
+    for (uint16_t i = 0; i < image.size(); i++) {
+        image[i] = (i * 11) & 0x7F;
+        sum += image[i];
+    }
+    CHECK(Handshake::send_patch(63, image.data()));
+    CHECK(!Handshake::send_patch(62, image.data()));  // One at a time
+    run_transfer();
+    CHECK(Handshake::get_state() == TransferState::COMPLETE);
+    CHECK_EQ(D50Responder::get_write_sum(), sum);
+
+    CHECK(Handshake::receive_patch(7, image.data()));
+    run_transfer();
+    CHECK(Handshake::get_state() == TransferState::COMPLETE);
+    bool same = true;
+    for (uint16_t i = 0; i < image.size(); i++) {
+        same = same && image[i] == D50Responder::read(patch_address(7) + i);
+    }
+    CHECK(same);
+
+    CHECK(D50Responder::get_errors_injected() > 0);
+    CHECK(Handshake::get_retries() > retries);
+    D50Responder::set_error_interval(0);
+}
+
+static std::array<uint8_t, Handshake::BANK_SIZE> bank;
+
+static uint32_t fill_bank() {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < bank.size(); i++) {
+        bank[i] = (i * 13 + i / Handshake::PATCH_STRIDE) & 0x7F;
+        sum += bank[i];
+    }
+    return sum;
+}
+
+static bool bank_matches_d50() {
+    for (uint32_t i = 0; i < bank.size(); i++) {
+        if (bank[i] != D50Responder::read(Handshake::PATCH_MEMORY + i)) return false;
+    }
+    return true;
+}
+
+static void test_bank_both_ways() {
+    D50Responder::reset();
+    uint32_t sum = fill_bank();
+    CHECK(Handshake::send_bank(bank.data()));
+    CHECK_EQ(Handshake::get_size(), Handshake::BANK_SIZE);
+    run_transfer(100'000);
+    CHECK(Handshake::get_state() == TransferState::COMPLETE);
+    CHECK_EQ(Handshake::get_bytes_done(), Handshake::BANK_SIZE);
+    CHECK_EQ(D50Responder::get_bytes_written(), Handshake::BANK_SIZE);
+    CHECK_EQ(D50Responder::get_write_sum(), sum);
+
+    bank.fill(0xFF);
+    CHECK(Handshake::receive_bank(bank.data()));
+    run_transfer(100'000);
+    CHECK(Handshake::get_state() == TransferState::COMPLETE);
+    CHECK_EQ(Handshake::get_bytes_done(), Handshake::BANK_SIZE);
+    CHECK(bank_matches_d50());
+    CHECK(!D50Responder::is_busy());
+}
+
+static void test_bank_errors_are_retried() {
+    // Every fifth DAT each way is refused or corrupted, the bank still
+    // arrives whole
+    D50Responder::reset();
+    D50Responder::set_error_interval(5);
+    uint32_t retries = Handshake::get_retries();
+
+    uint32_t sum = fill_bank();
+    CHECK(Handshake::send_bank(bank.data()));
+    run_transfer(100'000);
+    CHECK(Handshake::get_state() == TransferState::COMPLETE);
+    CHECK_EQ(D50Responder::get_bytes_written(), Handshake::BANK_SIZE);
+    CHECK_EQ(D50Responder::get_write_sum(), sum);
+
+    bank.fill(0xFF);
+    CHECK(Handshake::receive_bank(bank.data()));
+    run_transfer(100'000);
+    CHECK(Handshake::get_state() == TransferState::COMPLETE);
+    CHECK(bank_matches_d50());
+
+    // Each error cost one retry and nothing more
+    CHECK(D50Responder::get_errors_injected() >= 2 * Handshake::BANK_SIZE / PACKET_DATA / 5);
+    CHECK_EQ(Handshake::get_retries() - retries, D50Responder::get_errors_injected());
+    D50Responder::set_error_interval(0);
+}
+
+static void test_bank_rejected_midway() {
+    // The synth gives up after 40 of the 112 packets, either way
+    D50Responder::reset();
+    D50Responder::set_reject_after(40);
+
+    fill_bank();
+    CHECK(Handshake::send_bank(bank.data()));
+    run_transfer(100'000);
+    CHECK(Handshake::get_state() == TransferState::FAILED);
+    CHECK(Handshake::get_bytes_done() < Handshake::BANK_SIZE);
+    CHECK(!D50Responder::is_busy());
+
+    CHECK(Handshake::receive_bank(bank.data()));
+    run_transfer(100'000);
+    CHECK(Handshake::get_state() == TransferState::FAILED);
+    CHECK_EQ(Handshake::get_bytes_done(), 40 * PACKET_DATA);
+    D50Responder::set_reject_after(0);
+
+    // And the next transfer runs normally
+    CHECK(Handshake::receive_bank(bank.data()));
+    run_transfer(100'000);
+    CHECK(Handshake::get_state() == TransferState::COMPLETE);
+    CHECK(bank_matches_d50());
+}
+
+static void test_bank_aborted_by_controller() {
+    // RJC from this end stops the synth sending
+    D50Responder::reset();
+    CHECK(Handshake::receive_bank(bank.data()));
+    for (int i = 0; i < 20; i++) {
+        midi::MIDI::process_incoming();
+        host::advance_us(100);
+    }
+    CHECK(Handshake::is_busy());
+    CHECK(D50Responder::is_busy());
+    Handshake::abort();
+    CHECK(Handshake::get_state() == TransferState::FAILED);
+    run_transfer();
+    midi::MIDI::process_incoming();
+    CHECK(!D50Responder::is_busy());
+    CHECK(!Handshake::is_busy());
+}
+
+static void test_unsolicited_transfer_is_rejected() {
+    midi::MIDI::set_loopback(false);
+    host::uart_tx.clear();
+
+    std::vector<uint8_t> wsd;
+    midi::SysEx::write_request(midi::SysExCommand::WSD, patch_address(0), Handshake::PATCH_STRIDE,
+                               [&](uint8_t byte) { wsd.push_back(byte); });
+    host::uart_receive(wsd.data(), wsd.size());
+    midi::MIDI::process_incoming();
+
+    const std::vector<uint8_t> rjc = {0xF0, 0x41, 0x00, 0x14, 0x4F, 0xF7};
+    CHECK(host::uart_tx == rjc);
+    midi::MIDI::set_loopback(true);
+}
+
+int main() {
+    midi::MIDI::init();
+    midi::MIDI::set_loopback(true);
+    D50Responder::reset();
+
+    test_write_from_menu();
+    test_read_from_menu();
+    test_errors_are_retried();
+    test_bank_both_ways();
+    test_bank_errors_are_retried();
+    test_bank_rejected_midway();
+    test_bank_aborted_by_controller();
+    test_unsolicited_transfer_is_rejected();
+    return check::failures;
+}
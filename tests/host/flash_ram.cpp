@@ -0,0 +1,45 @@
+#include "host.h"
+#include "../../src/hardware/flash.h"
+#include <vector>
+#include <cstring>
+
+// Flash in RAM, in place of src/hardware/flash.cpp
+namespace host {
+
+namespace {
+std::vector<uint8_t> memory(pg1000::hardware::Flash::SIZE, 0xFF);
+int program_budget = -1;
+}
+
+uint8_t* flash_memory() { return memory.data(); }
+void flash_power_cut_after(int bytes) { program_budget = bytes; }
+
+} // namespace host
+
+namespace pg1000 {
+namespace hardware {
+
+const uint8_t* Flash::read(uint32_t offset) {
+    return host::memory.data() + offset;
+}
+
+bool Flash::erase(uint32_t offset, uint32_t size) {
+    if (offset % SECTOR_SIZE || size % SECTOR_SIZE || offset + size > SIZE) return false;
+    std::memset(&host::memory[offset], 0xFF, size);
+    return true;
+}
+
+bool Flash::program(uint32_t offset, const uint8_t* data, uint32_t size) {
+    if (!data || offset % PAGE_SIZE || size % PAGE_SIZE || offset + size > SIZE) return false;
+
+    // Programming only clears bits
+    for (uint32_t i = 0; i < size; i++) {
+        if (host::program_budget == 0) break;
+        if (host::program_budget > 0) host::program_budget--;
+        host::memory[offset + i] &= data[i];
+    }
+    return true;
+}
+
+} // namespace hardware
+} // namespace pg1000
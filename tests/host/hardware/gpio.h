@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+enum gpio_function { GPIO_FUNC_SPI, GPIO_FUNC_UART, GPIO_FUNC_I2C, GPIO_FUNC_SIO };
+
+#define GPIO_OUT 1
+#define GPIO_IN 0
+#define GPIO_IRQ_LEVEL_LOW 0x1u
+#define GPIO_IRQ_EDGE_FALL 0x4u
+#define GPIO_IRQ_EDGE_RISE 0x8u
+
+typedef void (*gpio_irq_callback_t)(unsigned int gpio, uint32_t event_mask);
+
+void gpio_init(unsigned gpio);
+void gpio_set_function(unsigned gpio, gpio_function fn);
+void gpio_set_dir(unsigned gpio, bool out);
+void gpio_pull_up(unsigned gpio);
+void gpio_put(unsigned gpio, bool value);
+bool gpio_get(unsigned gpio);
+void gpio_set_irq_enabled_with_callback(unsigned gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback);
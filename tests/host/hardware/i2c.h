@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// The I2C engine is replaced by i2c_bus.cpp, only the types are needed
+typedef struct i2c_inst i2c_inst_t;
+extern i2c_inst_t *i2c0, *i2c1;
@@ -0,0 +1,11 @@
+#pragma once
+
+typedef void (*irq_handler_t)();
+
+#define UART0_IRQ 20
+#define I2C0_IRQ 23
+#define I2C1_IRQ 24
+#define DMA_IRQ_1 12
+
+void irq_set_exclusive_handler(unsigned num, irq_handler_t handler);
+void irq_set_enabled(unsigned num, bool enabled);
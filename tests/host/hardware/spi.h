@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+typedef struct spi_inst spi_inst_t;
+extern spi_inst_t *spi0, *spi1;
+#define spi_default spi0
+
+typedef struct {
+    volatile uint32_t cr0, cr1, dr, sr;
+} spi_hw_t;
+
+unsigned spi_init(spi_inst_t* spi, unsigned baudrate);
+int spi_write_blocking(spi_inst_t* spi, const uint8_t* src, size_t len);
+int spi_write_read_blocking(spi_inst_t* spi, const uint8_t* src, uint8_t* dst, size_t len);
+bool spi_is_busy(const spi_inst_t* spi);
+unsigned spi_get_dreq(spi_inst_t* spi, bool is_tx);
+spi_hw_t* spi_get_hw(spi_inst_t* spi);
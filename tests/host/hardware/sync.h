@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+// Tests run on one thread, interrupt handlers are called in line
+uint32_t save_and_disable_interrupts();
+void restore_interrupts(uint32_t status);
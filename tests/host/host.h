@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Test side of the SDK stand-ins: the clock, pins and UART that the
+// firmware sees
+namespace host {
+
+// Moves the clock, firing alarms and the UART interrupt as it goes
+void advance_us(uint64_t us);
+void set_time_us(uint64_t us);
+
+// INTA and other inputs, a falling edge calls the GPIO callback
+void set_pin(unsigned gpio, bool level);
+
+// Bytes written to the UART since the last clear
+extern std::vector<uint8_t> uart_tx;
+
+// Bytes arriving at the UART, handed to its interrupt
+void uart_receive(const uint8_t* data, size_t length);
+
+// Bytes pushed over SPI by DMA, e.g. OLED pages
+extern std::vector<uint8_t> dma_tx;
+
+// Flash, all 0xFF at start. Programming stops after the given number of
+// bytes as if the power was cut, -1 for no limit.
+uint8_t* flash_memory();
+void flash_power_cut_after(int bytes);
+
+} // namespace host
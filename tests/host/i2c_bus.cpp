@@ -0,0 +1,163 @@
+#include "i2c_bus.h"
+#include <array>
+#include <cstdio>
+
+namespace host {
+
+namespace {
+
+struct Bus {
+    uint32_t byte_us;
+    std::array<I2CDevice*, 128> devices;
+
+    // The pool, the transaction at tail is the one on the wire
+    struct Transaction {
+        uint8_t address;
+        uint8_t write_length;
+        uint8_t read_length;
+        std::array<uint8_t, I2C::MAX_WRITE> write_data;
+        uint8_t* read_data;
+        I2C::Callback callback;
+        void* context;
+    };
+    std::array<Transaction, I2C::POOL_SIZE> pool;
+    uint8_t tail;
+    uint8_t count;
+    bool on_wire;
+    uint64_t done_us;
+
+    uint32_t transactions;
+    uint32_t bytes;
+};
+
+// 9 bit times per byte, 400 kHz and 100 kHz
+std::array<Bus, 2> buses = {{{23}, {90}}};
+
+Bus& get_bus(I2C::Bus bus) { return buses[static_cast<size_t>(bus)]; }
+
+uint32_t wire_bytes(const Bus::Transaction& t) {
+    return (t.write_length ? 1 + t.write_length : 0) + (t.read_length ? 1 + t.read_length : 0);
+}
+
+// Runs a transaction against the device, false on a NACK
+bool execute(Bus& bus, uint8_t address, const uint8_t* write_data, size_t write_length,
+             uint8_t* read_data, size_t read_length) {
+    I2CDevice* device = (address < 128) ? bus.devices[address] : nullptr;
+    bus.transactions++;
+    bus.bytes += (write_length ? 1 + write_length : 0) + (read_length ? 1 + read_length : 0);
+    if (!device) return false;
+    if (write_length) device->write(write_data, write_length);
+    if (read_length) device->read(read_data, read_length);
+    return true;
+}
+
+} // namespace
+
+void attach_i2c(I2C::Bus bus, uint8_t address, I2CDevice* device) {
+    get_bus(bus).devices[address] = device;
+}
+
+uint32_t get_i2c_transactions(I2C::Bus bus) { return get_bus(bus).transactions; }
+uint32_t get_i2c_bytes(I2C::Bus bus) { return get_bus(bus).bytes; }
+
+// Called by advance_us() each microsecond
+void i2c_tick(uint64_t now_us) {
+    for (Bus& bus : buses) {
+        if (bus.count == 0) continue;
+
+        Bus::Transaction& t = bus.pool[bus.tail];
+        if (!bus.on_wire) {
+            bus.on_wire = true;
+            bus.done_us = now_us + wire_bytes(t) * bus.byte_us;
+        }
+        if (now_us < bus.done_us) continue;
+
+        bool ok = execute(bus, t.address, t.write_data.data(), t.write_length, t.read_data, t.read_length);
+        I2C::Callback callback = t.callback;
+        void* context = t.context;
+        bus.tail = (bus.tail + 1) % I2C::POOL_SIZE;
+        bus.count--;
+        bus.on_wire = false;
+        if (callback) callback(ok, context);
+    }
+}
+
+} // namespace host
+
+namespace pg1000 {
+namespace hardware {
+
+bool I2C::init(Bus) { return true; }
+bool I2C::init_all() { return true; }
+
+bool I2C::submit(Bus bus, uint8_t device_addr, const uint8_t* write_data, size_t write_length,
+                 uint8_t* read_data, size_t read_length, Callback callback, void* context) {
+    host::Bus& b = host::get_bus(bus);
+    if (b.count == POOL_SIZE || write_length > MAX_WRITE || read_length > UINT8_MAX) return false;
+
+    host::Bus::Transaction& t = b.pool[(b.tail + b.count) % POOL_SIZE];
+    t.address = device_addr;
+    t.write_length = static_cast<uint8_t>(write_length);
+    t.read_length = static_cast<uint8_t>(read_length);
+    for (size_t i = 0; i < write_length; i++) t.write_data[i] = write_data[i];
+    t.read_data = read_data;
+    t.callback = callback;
+    t.context = context;
+    b.count++;
+    return true;
+}
+
+uint8_t I2C::get_free(Bus bus) { return POOL_SIZE - host::get_bus(bus).count; }
+bool I2C::is_idle(Bus bus) { return host::get_bus(bus).count == 0; }
+
+// The blocking calls go straight to the device
+bool I2C::write_byte(Bus bus, uint8_t device_addr, uint8_t reg, uint8_t data) {
+    uint8_t buf[] = {reg, data};
+    return host::execute(host::get_bus(bus), device_addr, buf, 2, nullptr, 0);
+}
+
+bool I2C::write_bytes(Bus bus, uint8_t device_addr, uint8_t reg, const uint8_t* data, size_t length) {
+    std::array<uint8_t, MAX_WRITE + 1> buf;
+    if (length > MAX_WRITE) return false;
+    buf[0] = reg;
+    for (size_t i = 0; i < length; i++) buf[i + 1] = data[i];
+    return host::execute(host::get_bus(bus), device_addr, buf.data(), length + 1, nullptr, 0);
+}
+
+bool I2C::read_byte(Bus bus, uint8_t device_addr, uint8_t reg, uint8_t& data) {
+    return host::execute(host::get_bus(bus), device_addr, &reg, 1, &data, 1);
+}
+
+bool I2C::read_bytes(Bus bus, uint8_t device_addr, uint8_t reg, uint8_t* data, size_t length) {
+    return host::execute(host::get_bus(bus), device_addr, &reg, 1, data, length);
+}
+
+bool I2C::write_raw(Bus bus, uint8_t device_addr, uint8_t data) {
+    return host::execute(host::get_bus(bus), device_addr, &data, 1, nullptr, 0);
+}
+
+bool I2C::read_raw(Bus bus, uint8_t device_addr, uint8_t& data) {
+    return host::execute(host::get_bus(bus), device_addr, nullptr, 0, &data, 1);
+}
+
+bool I2C::device_present(Bus bus, uint8_t device_addr) {
+    return device_addr < 128 && host::get_bus(bus).devices[device_addr] != nullptr;
+}
+
+void I2C::scan_bus(Bus bus) {
+    for (uint8_t addr = 0; addr < 128; addr++) {
+        if (device_present(bus, addr)) std::printf("I2C device at 0x%02X\n", addr);
+    }
+}
+
+const I2C::Stats& I2C::get_stats(Bus) {
+    static const Stats none = {};
+    return none;
+}
+
+uint8_t I2C::get_utilisation(Bus) { return 0; }
+uint32_t I2C::get_average_latency(Bus) { return 0; }
+void I2C::print_stats() {}
+
+} // namespace hardware
+} // namespace pg1000
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "../../src/hardware/i2c.h"
+
+// Both I2C buses at transaction level, in place of src/hardware/i2c.cpp.
+// Queued transactions take their time on the wire as the clock advances,
+// then reach the device and call back.
+namespace host {
+
+class I2CDevice {
+public:
+    virtual ~I2CDevice() = default;
+
+    // The write part of a transaction, register address first, then the
+    // read part after a repeated start
+    virtual void write(const uint8_t* data, size_t length) = 0;
+    virtual void read(uint8_t* data, size_t length) = 0;
+};
+
+using pg1000::hardware::I2C;
+
+void attach_i2c(I2C::Bus bus, uint8_t address, I2CDevice* device);
+
+// Since start-up, address bytes included
+uint32_t get_i2c_transactions(I2C::Bus bus);
+uint32_t get_i2c_bytes(I2C::Bus bus);
+
+} // namespace host
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#define __not_in_flash_func(x) x
+#define __time_critical_func(x) x
+
+static inline void tight_loop_contents() {}
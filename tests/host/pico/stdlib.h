@@ -0,0 +1,13 @@
+#pragma once
+
+// Host stand-in for the Pico SDK, just what the firmware uses
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+#include "hardware/irq.h"
+
+void stdio_init_all();
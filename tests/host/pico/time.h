@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// The clock only moves when a test advances it, see host.h
+typedef uint64_t absolute_time_t;
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void* user_data);
+
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+uint32_t time_us_32();
+uint64_t time_us_64();
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void* user_data, bool fire_if_past);
+bool cancel_alarm(alarm_id_t alarm);
@@ -0,0 +1,168 @@
+#include "host.h"
+#include "pico/stdlib.h"
+#include "pico/time.h"
+#include "hardware/sync.h"
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "hardware/i2c.h"
+#include <array>
+#include <deque>
+
+namespace host {
+
+std::vector<uint8_t> uart_tx;
+std::vector<uint8_t> dma_tx;
+
+namespace {
+
+uint64_t now_us = 0;
+
+struct Alarm {
+    uint64_t due;
+    alarm_callback_t callback;
+    void* user_data;
+    bool armed;
+};
+std::array<Alarm, 4> alarms = {};
+
+std::array<bool, 30> pins = {};
+std::array<gpio_irq_callback_t, 30> pin_callbacks = {};
+std::array<irq_handler_t, 32> irq_handlers = {};
+std::deque<uint8_t> uart_rx;
+
+void run_alarms() {
+    for (size_t i = 0; i < alarms.size(); i++) {
+        Alarm& alarm = alarms[i];
+        if (!alarm.armed || alarm.due > now_us) continue;
+
+        // Positive means that long after it was due, negative after now
+        alarm.armed = false;
+        int64_t again = alarm.callback(static_cast<alarm_id_t>(i + 1), alarm.user_data);
+        if (again != 0) {
+            alarm.due = (again > 0) ? alarm.due + again : now_us - again;
+            alarm.armed = true;
+        }
+    }
+}
+
+} // namespace
+
+void i2c_tick(uint64_t now_us);  // i2c_bus.cpp
+
+void advance_us(uint64_t us) {
+    for (uint64_t end = now_us + us; now_us < end; now_us++) {
+        i2c_tick(now_us);
+        run_alarms();
+    }
+    i2c_tick(now_us);
+    run_alarms();
+}
+
+void set_time_us(uint64_t us) {
+    now_us = us;
+}
+
+void set_pin(unsigned gpio, bool level) {
+    bool fell = pins[gpio] && !level;
+    pins[gpio] = level;
+    if (fell && pin_callbacks[gpio]) pin_callbacks[gpio](gpio, GPIO_IRQ_EDGE_FALL);
+}
+
+void uart_receive(const uint8_t* data, size_t length) {
+    uart_rx.insert(uart_rx.end(), data, data + length);
+    if (irq_handlers[UART0_IRQ]) irq_handlers[UART0_IRQ]();
+}
+
+} // namespace host
+
+using namespace host;
+
+uart_inst_t* uart0 = nullptr;
+spi_inst_t* spi0 = nullptr;
+spi_inst_t* spi1 = nullptr;
+i2c_inst_t* i2c0 = nullptr;
+i2c_inst_t* i2c1 = nullptr;
+
+void stdio_init_all() {}
+
+void sleep_us(uint64_t us) { advance_us(us); }
+void sleep_ms(uint32_t ms) { advance_us(ms * 1000ull); }
+uint32_t time_us_32() { return static_cast<uint32_t>(now_us); }
+uint64_t time_us_64() { return now_us; }
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void* user_data, bool) {
+    for (size_t i = 0; i < alarms.size(); i++) {
+        if (alarms[i].armed) continue;
+        alarms[i] = {now_us + us, callback, user_data, true};
+        return static_cast<alarm_id_t>(i + 1);
+    }
+    return -1;
+}
+
+bool cancel_alarm(alarm_id_t alarm) {
+    if (alarm < 1 || static_cast<size_t>(alarm) > alarms.size()) return false;
+    bool was_armed = alarms[alarm - 1].armed;
+    alarms[alarm - 1].armed = false;
+    return was_armed;
+}
+
+uint32_t save_and_disable_interrupts() { return 0; }
+void restore_interrupts(uint32_t) {}
+
+void irq_set_exclusive_handler(unsigned num, irq_handler_t handler) { irq_handlers[num] = handler; }
+void irq_set_enabled(unsigned, bool) {}
+
+void gpio_init(unsigned gpio) { pins[gpio] = true; }
+void gpio_set_function(unsigned, gpio_function) {}
+void gpio_set_dir(unsigned, bool) {}
+void gpio_pull_up(unsigned gpio) { pins[gpio] = true; }
+void gpio_put(unsigned gpio, bool value) { pins[gpio] = value; }
+bool gpio_get(unsigned gpio) { return pins[gpio]; }
+
+void gpio_set_irq_enabled_with_callback(unsigned gpio, uint32_t, bool enabled, gpio_irq_callback_t callback) {
+    pin_callbacks[gpio] = enabled ? callback : nullptr;
+}
+
+// The UART sends as fast as it's fed
+unsigned uart_init(uart_inst_t*, unsigned baudrate) { return baudrate; }
+void uart_set_fifo_enabled(uart_inst_t*, bool) {}
+void uart_set_irq_enables(uart_inst_t*, bool, bool) {}
+bool uart_is_readable(uart_inst_t*) { return !uart_rx.empty(); }
+bool uart_is_writable(uart_inst_t*) { return true; }
+void uart_putc_raw(uart_inst_t*, char c) { uart_tx.push_back(static_cast<uint8_t>(c)); }
+
+char uart_getc(uart_inst_t*) {
+    char c = static_cast<char>(uart_rx.front());
+    uart_rx.pop_front();
+    return c;
+}
+
+// SPI reads back zeros, DMA completes at once
+static spi_hw_t spi_registers = {};
+
+unsigned spi_init(spi_inst_t*, unsigned baudrate) { return baudrate; }
+int spi_write_blocking(spi_inst_t*, const uint8_t*, size_t len) { return static_cast<int>(len); }
+bool spi_is_busy(const spi_inst_t*) { return false; }
+unsigned spi_get_dreq(spi_inst_t*, bool) { return 0; }
+spi_hw_t* spi_get_hw(spi_inst_t*) { return &spi_registers; }
+
+int spi_write_read_blocking(spi_inst_t*, const uint8_t*, uint8_t* dst, size_t len) {
+    for (size_t i = 0; i < len; i++) dst[i] = 0;
+    return static_cast<int>(len);
+}
+
+int dma_claim_unused_channel(bool) { return 0; }
+dma_channel_config dma_channel_get_default_config(unsigned) { return {}; }
+void channel_config_set_transfer_data_size(dma_channel_config*, dma_channel_transfer_size) {}
+void channel_config_set_read_increment(dma_channel_config*, bool) {}
+void channel_config_set_write_increment(dma_channel_config*, bool) {}
+void channel_config_set_dreq(dma_channel_config*, unsigned) {}
+void dma_channel_configure(unsigned, const dma_channel_config*, volatile void*, const volatile void*, unsigned, bool) {}
+void dma_channel_set_irq1_enabled(unsigned, bool) {}
+void dma_channel_acknowledge_irq1(unsigned) {}
+
+void dma_channel_transfer_from_buffer_now(unsigned, const volatile void* read_addr, uint32_t transfer_count) {
+    const volatile uint8_t* bytes = static_cast<const volatile uint8_t*>(read_addr);
+    for (uint32_t i = 0; i < transfer_count; i++) dma_tx.push_back(static_cast<uint8_t>(bytes[i]));
+    if (irq_handlers[DMA_IRQ_1]) irq_handlers[DMA_IRQ_1]();
+}
@@ -0,0 +1,129 @@
+// MacroPots: what one scan of macro pots costs on the MIDI link. The
+// fan-out of each scan must go out as the fewest DT1 bytes that cover
+// every changed address. Curves are the parameter pots' tapers.
+
+#include "check.h"
+#include "host.h"
+#include "../src/midi/midi.h"
+#include "../src/parameters/macro_pots.h"
+#include "../src/parameters/edit_buffer.h"
+#include "../src/parameters/pot_scaling.h"
+#include <array>
+#include <vector>
+
+using namespace pg1000;
+using parameters::EditBuffer;
+using parameters::MacroPots;
+
+// Pots of the presets
+static constexpr uint8_t POT_CUTOFF = 46;
+static constexpr uint8_t POT_RESONANCE = 47;
+static constexpr uint8_t POT_BRIGHTNESS = 48;
+static constexpr uint8_t POT_CHORUS = 49;
+
+static std::array<uint8_t, EDIT_BUFFER_SIZE> before;
+
+static void snapshot() {
+    for (uint16_t i = 0; i < EDIT_BUFFER_SIZE; i++) before[i] = EditBuffer::get(i);
+}
+
+// Lower bound for the changes since snapshot(): a DT1 per block with
+// anything changed, and each gap between two changed bytes either
+// rewritten or paid for with a new message, whichever is less
+static uint32_t minimum_bytes() {
+    uint32_t bytes = 0;
+    int last = -1;
+    for (uint16_t address = 0; address < EDIT_BUFFER_SIZE; address++) {
+        if (EditBuffer::get(address) == before[address]) continue;
+
+        bool same_block = last >= 0 && last / EDIT_BLOCK_SIZE == address / EDIT_BLOCK_SIZE;
+        uint32_t gap = same_block ? address - last - 1 : 0;
+        bytes += (same_block && gap < midi::SysExConst::DATA_OVERHEAD) ? gap + 1 : midi::SysExConst::DATA_OVERHEAD + 1;
+        last = address;
+    }
+    return bytes;
+}
+
+// Sends the scan's edits, the bytes that went out
+static std::vector<uint8_t> send_scan() {
+    host::uart_tx.clear();
+    midi::MIDI::send_dirty();
+    host::advance_us(50'000);  // Drain the UART
+    return host::uart_tx;
+}
+
+static uint32_t count_messages(const std::vector<uint8_t>& bytes) {
+    uint32_t count = 0;
+    for (uint8_t byte : bytes) count += (byte == 0xF0);
+    return count;
+}
+
+static void test_one_target_per_partial() {
+    snapshot();
+    CHECK(MacroPots::apply(POT_CUTOFF, 100));
+    std::vector<uint8_t> sent = send_scan();
+    CHECK_EQ(count_messages(sent), 4);
+    CHECK_EQ(sent.size(), 4 * (midi::SysExConst::DATA_OVERHEAD + 1));
+    CHECK_EQ(sent.size(), minimum_bytes());
+}
+
+static void test_targets_merged_within_a_block() {
+    // Cutoff and ENV depth, four bytes apart in each partial
+    snapshot();
+    CHECK(MacroPots::apply(POT_BRIGHTNESS, 90));
+    std::vector<uint8_t> sent = send_scan();
+    CHECK_EQ(count_messages(sent), 4);
+    CHECK_EQ(sent.size(), minimum_bytes());
+}
+
+static void test_two_macros_in_one_scan() {
+    // Resonance sits next to cutoff, so each partial is one two byte DT1.
+    // Chorus depth and balance are adjacent in each common block.
+    snapshot();
+    CHECK(MacroPots::apply(POT_CUTOFF, 20));
+    CHECK(MacroPots::apply(POT_RESONANCE, 70));
+    CHECK(MacroPots::apply(POT_CHORUS, 64));
+    std::vector<uint8_t> sent = send_scan();
+    CHECK_EQ(count_messages(sent), 6);
+    CHECK_EQ(sent.size(), minimum_bytes());
+}
+
+static void test_unchanged_sends_nothing() {
+    CHECK(!MacroPots::apply(POT_CHORUS, 64));
+    CHECK(send_scan().empty());
+}
+
+static void test_curves_follow_pot_tapers() {
+    using namespace parameters;
+    namespace taper = parameters::pot_scaling;
+    const MacroTarget exponential = {0, 0, 100, MacroCurve::EXPONENTIAL};
+    const MacroTarget logarithmic = {0, 0, 100, MacroCurve::LOGARITHMIC};
+    const MacroTarget inverted = {0, 0, 100, MacroCurve::INVERTED};
+
+    // Same reading through the same table as a pot on the antilog taper
+    bool same = true;
+    for (uint8_t position = 0; position < MacroPots::CURVE_STEPS; position++) {
+        uint16_t reading = (position * taper::ADC_MAX + 63) / 127;
+        uint32_t expected = (taper::TAPERS[static_cast<size_t>(PotTaper::ANTILOG)][reading] * 100 + 511) / 1023;
+        same = same && MacroPots::map(exponential, position) == expected;
+    }
+    CHECK(same);
+
+    CHECK_EQ(MacroPots::map(exponential, 64), 25);
+    CHECK_EQ(MacroPots::map(logarithmic, 64), 75);
+    CHECK_EQ(MacroPots::map(inverted, 0), 100);
+    CHECK_EQ(MacroPots::map(inverted, 127), 0);
+}
+
+int main() {
+    host::set_time_us(1'000'000);
+    midi::MIDI::init();
+    MacroPots::init();
+
+    test_one_target_per_partial();
+    test_targets_merged_within_a_block();
+    test_two_macros_in_one_scan();
+    test_unchanged_sends_nothing();
+    test_curves_follow_pot_tapers();
+    return check::failures;
+}
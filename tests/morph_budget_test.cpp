@@ -0,0 +1,174 @@
+// PatchMorph: pot sweeps simulated against the MIDI link. What goes out
+// stays within the morph's share of the link, the synth catches up with
+// the pot as soon as it stops, and the update rate of each parameter
+// follows how far it has to move.
+
+#include "check.h"
+#include "host.h"
+#include "../src/midi/midi.h"
+#include "../src/midi/address_map.h"
+#include "../src/parameters/patch_morph.h"
+#include "../src/parameters/edit_buffer.h"
+#include "../src/hardware/hardware.h"
+#include <array>
+#include <cstdio>
+
+using namespace pg1000;
+using parameters::EditBuffer;
+using parameters::PatchMorph;
+
+using Image = std::array<uint8_t, PatchMorph::SIZE>;
+
+// Link bytes per second, start, 8 data bits and stop each
+static constexpr uint32_t LINK_BYTES_PER_S = hardware::Config::MIDI_BAUD_RATE / 10;
+
+static constexpr uint32_t TICK_US = 1000;  // Main loop period
+
+// Slots in PARAMETERS
+static constexpr uint8_t SLOT_WAVEFORM = 6;
+static constexpr uint8_t SLOT_CUTOFF = 10;
+static constexpr uint8_t SLOT_TVA_LEVEL = 16;
+
+static uint16_t address_of(uint8_t slot) {
+    for (uint16_t address = 0; address < PatchMorph::SIZE; address++) {
+        if (midi::AddressMap::get_slot(address) == slot) return address;
+    }
+    return PatchMorph::SIZE;
+}
+
+static Image random_image(uint32_t seed) {
+    Image image;
+    uint32_t state = seed;
+    for (uint8_t& byte : image) {
+        state = state * 1103515245u + 12345;
+        byte = (state >> 16) & 0x7F;
+    }
+    return image;
+}
+
+static void load(const Image& image) {
+    for (uint16_t address = 0; address < image.size(); address++) EditBuffer::store(address, image[address]);
+}
+
+static bool synth_at(const Image& image) {
+    for (uint16_t address = 0; address < image.size(); address++) {
+        if (is_edit_address_valid(address) && EditBuffer::get(address) != image[address]) return false;
+    }
+    return true;
+}
+
+// Morph from A towards B: the main loop with the pot moving from one
+// position to another over the given time, then held for hold_ms. Returns
+// the bytes that went out over MIDI.
+static uint32_t sweep(uint16_t from, uint16_t to, uint32_t sweep_ms, uint32_t hold_ms) {
+    host::uart_tx.clear();
+    uint32_t ticks = sweep_ms * 1000 / TICK_US;
+    for (uint32_t tick = 0; tick <= ticks + hold_ms * 1000 / TICK_US; tick++) {
+        uint32_t done = tick < ticks ? tick : ticks;
+        int position = from + (static_cast<int>(to) - from) * static_cast<int>(done) / static_cast<int>(ticks ? ticks : 1);
+        PatchMorph::set_position(static_cast<uint16_t>(position));
+        PatchMorph::update(time_us_32());
+        midi::MIDI::send_dirty();
+        host::advance_us(TICK_US);
+    }
+    host::advance_us(50'000);  // Drain the UART
+    return static_cast<uint32_t>(host::uart_tx.size());
+}
+
+static void test_full_sweep_stays_in_budget() {
+    Image a = random_image(1);
+    Image b = random_image(2);
+    load(a);
+    PatchMorph::set_position(0);
+    PatchMorph::start(a.data(), b.data());
+
+    uint32_t sent = sweep(0, PatchMorph::POSITION_MAX, 2000, 0);
+    const PatchMorph::Stats& stats = PatchMorph::get_stats();
+
+    // The morph's share of the link plus the burst, and what reached the
+    // wire was no more than that
+    uint32_t budget = static_cast<uint64_t>(stats.elapsed_us) * LINK_BYTES_PER_S / 1'000'000 *
+                      PatchMorph::LINK_SHARE_PERCENT / 100 + PatchMorph::MAX_BURST;
+    CHECK(stats.wire_bytes <= budget);
+    CHECK(sent <= budget);
+    CHECK(stats.wire_bytes > budget / 2);  // Budget is used, not left idle
+
+    // Held at B it catches up in about the time one pass takes
+    uint32_t catch_up_ms = 0;
+    while (!synth_at(b) && catch_up_ms < 2000) {
+        sweep(PatchMorph::POSITION_MAX, PatchMorph::POSITION_MAX, 0, 10);
+        catch_up_ms += 10;
+    }
+    CHECK(synth_at(b));
+    CHECK(catch_up_ms <= 1000);
+
+    PatchMorph::stop();  // Prints the rates
+}
+
+static void test_rates_follow_distance() {
+    // Three parameters differ: the cutoff over its full range, TVA level
+    // by two steps and the waveform switch
+    Image a = random_image(3);
+    Image b = a;
+    const uint16_t cutoff = address_of(SLOT_CUTOFF);
+    const uint16_t level = address_of(SLOT_TVA_LEVEL);
+    const uint16_t waveform = address_of(SLOT_WAVEFORM);
+    a[cutoff] = 0;
+    b[cutoff] = 100;
+    a[level] = 50;
+    b[level] = 52;
+    a[waveform] = 0;
+    b[waveform] = 1;
+    load(a);
+    PatchMorph::set_position(0);
+    PatchMorph::start(a.data(), b.data());
+
+    // Slow enough for every cutoff step to go out
+    sweep(0, PatchMorph::POSITION_MAX, 2000, 20);
+    CHECK(synth_at(b));
+    const PatchMorph::Stats& stats = PatchMorph::get_stats();
+    CHECK(stats.updates[SLOT_CUTOFF] >= 95);
+    CHECK_EQ(stats.updates[SLOT_TVA_LEVEL], 2);
+    CHECK_EQ(stats.updates[SLOT_WAVEFORM], 1);
+
+    // The switch sits at the halfway point
+    PatchMorph::set_position(PatchMorph::POSITION_MAX / 2);
+    CHECK_EQ(PatchMorph::get_target(waveform), 0);
+    PatchMorph::set_position(PatchMorph::POSITION_MAX / 2 + 1);
+    CHECK_EQ(PatchMorph::get_target(waveform), 1);
+    PatchMorph::stop();
+}
+
+static void test_fast_sweep_skips_steps() {
+    // Every byte far apart, swept in 100 ms: the synth can't follow each
+    // step, it skips them and is still at B soon after the pot stops
+    Image a = random_image(4);
+    Image b;
+    for (uint16_t address = 0; address < b.size(); address++) b[address] = 127 - a[address];
+    load(a);
+    PatchMorph::set_position(0);
+    PatchMorph::start(a.data(), b.data());
+
+    sweep(0, PatchMorph::POSITION_MAX, 100, 0);
+    const PatchMorph::Stats& stats = PatchMorph::get_stats();
+    CHECK(stats.updates[SLOT_CUTOFF] < 10);
+    CHECK(stats.wire_bytes <= LINK_BYTES_PER_S / 10 * PatchMorph::LINK_SHARE_PERCENT / 100 + PatchMorph::MAX_BURST);
+
+    uint32_t catch_up_ms = 0;
+    while (!synth_at(b) && catch_up_ms < 2000) {
+        sweep(PatchMorph::POSITION_MAX, PatchMorph::POSITION_MAX, 0, 10);
+        catch_up_ms += 10;
+    }
+    CHECK(catch_up_ms <= 1000);
+    PatchMorph::stop();
+}
+
+int main() {
+    host::set_time_us(1'000'000);
+    midi::MIDI::init();
+
+    test_full_sweep_stays_in_budget();
+    test_rates_follow_distance();
+    test_fast_sweep_skips_steps();
+    return check::failures;
+}
@@ -0,0 +1,177 @@
+// Display on the OLED: frames drawn by the host back end, dumped as PGM
+// images next to the test binary and read back, and what goes out over
+// DMA once the panel is connected
+
+#include "check.h"
+#include "host.h"
+#include "../src/hardware/display.h"
+#include "../src/hardware/oled.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace pg1000;
+using hardware::Display;
+using hardware::Oled;
+
+// Dumps the framebuffer to name.pgm and reads the pixels back, empty if
+// the file isn't a 128x64 binary PGM
+static std::vector<uint8_t> dump(const std::string& name) {
+    std::string path = name + ".pgm";
+    std::FILE* out = std::fopen(path.c_str(), "wb");
+    if (!out) return {};
+    Oled::write_pgm(out);
+    std::fclose(out);
+
+    std::FILE* in = std::fopen(path.c_str(), "rb");
+    if (!in) return {};
+    int width = 0, height = 0, max_value = 0;
+    std::vector<uint8_t> pixels(Oled::WIDTH * Oled::HEIGHT);
+    bool ok = std::fscanf(in, "P5 %d %d %d", &width, &height, &max_value) == 3 && std::fgetc(in) == '\n' &&
+              width == Oled::WIDTH && height == Oled::HEIGHT && max_value == 255 &&
+              std::fread(pixels.data(), 1, pixels.size(), in) == pixels.size() && std::fgetc(in) == EOF;
+    std::fclose(in);
+    return ok ? pixels : std::vector<uint8_t>();
+}
+
+static bool lit(const std::vector<uint8_t>& pixels, int x, int y) {
+    return pixels[y * Oled::WIDTH + x] == 255;
+}
+
+// Every pixel of the image agrees with the framebuffer
+static bool matches_framebuffer(const std::vector<uint8_t>& pixels) {
+    if (pixels.empty()) return false;
+    for (int y = 0; y < Oled::HEIGHT; y++) {
+        for (int x = 0; x < Oled::WIDTH; x++) {
+            uint8_t pixel = pixels[y * Oled::WIDTH + x];
+            if (pixel != 0 && pixel != 255) return false;
+            if (lit(pixels, x, y) != Oled::get_pixel(x, y)) return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t lit_in_rows(const std::vector<uint8_t>& pixels, int top, int bottom) {
+    uint32_t count = 0;
+    for (int y = top; y < bottom; y++) {
+        for (int x = 0; x < Oled::WIDTH; x++) count += lit(pixels, x, y);
+    }
+    return count;
+}
+
+// Layout as in display.h: 8x12 pixel cells, the bar right of the value
+static constexpr int BAR_X = 4 * 8;
+static constexpr int BAR_Y = 12;
+static constexpr int BAR_INNER = Oled::WIDTH - BAR_X - 4;
+static constexpr int ENVELOPE_TOP = 26;
+
+// Row of an envelope level, 0-100 over the rows below ENVELOPE_TOP
+static int level_row(int level) {
+    return Oled::HEIGHT - 1 - (level * (Oled::HEIGHT - ENVELOPE_TOP - 2) + 50) / 100;
+}
+
+static void test_blank_frame() {
+    std::vector<uint8_t> pixels = dump("oled_blank");
+    CHECK(matches_framebuffer(pixels));
+    CHECK_EQ(lit_in_rows(pixels, 0, Oled::HEIGHT), 0);
+}
+
+static void test_parameter_frame() {
+    Display::show_parameter("TVF Cutoff Freq", "50", 50, 100);
+    Display::flush();
+    std::vector<uint8_t> pixels = dump("oled_parameter");
+    CHECK(matches_framebuffer(pixels));
+
+    // Name on the first text row, nothing under the bar
+    CHECK(lit_in_rows(pixels, 0, 8) > 0);
+    CHECK_EQ(lit_in_rows(pixels, ENVELOPE_TOP, Oled::HEIGHT), 0);
+
+    // Outline, and the fill half way along the inside
+    CHECK(lit(pixels, BAR_X, BAR_Y + 4));
+    CHECK(lit(pixels, Oled::WIDTH - 1, BAR_Y + 4));
+    CHECK(lit(pixels, BAR_X + 2 + BAR_INNER / 2 - 1, BAR_Y + 4));
+    CHECK(!lit(pixels, BAR_X + 2 + BAR_INNER / 2, BAR_Y + 4));
+}
+
+static void test_signed_bar_frame() {
+    // -12..0, zero at the right end: -6 fills the right half of the inside
+    Display::show_parameter("TVA Bias Level", "-6", 6, 12, 12);
+    Display::flush();
+    std::vector<uint8_t> pixels = dump("oled_signed");
+    CHECK(matches_framebuffer(pixels));
+
+    const int zero_x = BAR_X + 2 + BAR_INNER;
+    CHECK(lit(pixels, zero_x, BAR_Y + 1));  // Tick, above the fill
+    CHECK(!lit(pixels, BAR_X + 2 + BAR_INNER / 2, BAR_Y + 1));
+    CHECK(lit(pixels, zero_x - 1, BAR_Y + 4));
+    CHECK(lit(pixels, BAR_X + 2 + BAR_INNER / 2, BAR_Y + 4));
+    CHECK(!lit(pixels, BAR_X + 2 + BAR_INNER / 2 - 1, BAR_Y + 4));
+}
+
+static void test_envelope_frame() {
+    // T1-T4, then L0, L1, L2, sustain, end
+    const uint8_t times[] = {10, 30, 50, 20};
+    const uint8_t levels[] = {50, 100, 75, 60, 50};
+    Display::show_parameter("TVA ENV Time 1", "10", 10, 50);
+    Display::show_envelope(times, levels);
+    Display::flush();
+    std::vector<uint8_t> pixels = dump("oled_envelope");
+    CHECK(matches_framebuffer(pixels));
+
+    // Starts at zero on the left, peaks at the top after T1
+    CHECK(lit(pixels, 0, level_row(50)));
+    CHECK(lit(pixels, 10 * 24 / 50, level_row(100)));
+    CHECK_EQ(level_row(100), ENVELOPE_TOP + 1);
+    CHECK(lit_in_rows(pixels, ENVELOPE_TOP, Oled::HEIGHT) > 40);
+
+    // Another parameter wipes it
+    Display::show_parameter("TVF Cutoff Freq", "50", 50, 100);
+    Display::flush();
+    pixels = dump("oled_parameter_again");
+    CHECK(matches_framebuffer(pixels));
+    CHECK_EQ(lit_in_rows(pixels, ENVELOPE_TOP, Oled::HEIGHT), 0);
+}
+
+static void test_only_dirty_pages_go_out() {
+    uint32_t sent = Oled::get_pages_sent();
+    Display::show_parameter("TVF Cutoff Freq", "50", 50, 100);
+    Display::flush();
+    CHECK_EQ(Oled::get_pages_sent(), sent);
+
+    // The value and bar span rows 12-19, pages 1 and 2
+    Display::show_parameter("TVF Cutoff Freq", "51", 51, 100);
+    Display::flush();
+    CHECK_EQ(Oled::get_pages_sent(), sent + 2);
+}
+
+static void test_dma_pushes_pages() {
+    host::dma_tx.clear();
+    CHECK(Display::init(hardware::DisplayType::OLED_128X64));
+    CHECK_EQ(host::dma_tx.size(), Oled::BUFFER_SIZE);
+
+    Display::show_parameter("TVF Cutoff Freq", "50", 50, 100);
+    host::dma_tx.clear();
+    Display::flush();
+    CHECK(!Oled::is_busy());
+
+    // Each dirty page as it is in the framebuffer, top to bottom
+    CHECK_EQ(host::dma_tx.size() % Oled::WIDTH, 0);
+    CHECK(host::dma_tx.size() < Oled::BUFFER_SIZE);
+    CHECK(!host::dma_tx.empty());
+    CHECK(std::memcmp(host::dma_tx.data(), Oled::get_buffer(), Oled::WIDTH) == 0);
+}
+
+int main() {
+    CHECK(Display::init(hardware::DisplayType::HOST));
+    Display::flush();
+    CHECK_EQ(Oled::get_pages_sent(), Oled::PAGES);
+
+    test_blank_frame();
+    test_parameter_frame();
+    test_signed_bar_frame();
+    test_envelope_frame();
+    test_only_dirty_pages_go_out();
+    test_dma_pushes_pages();
+    return check::failures;
+}
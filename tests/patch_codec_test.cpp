@@ -0,0 +1,270 @@
+// PatchCodec: round trips over random images and references, from no
+// change at all to every byte changed, and over the patches of the
+// embedded Starter bank, their variations and what PatchLibrary stores
+// for them
+
+#include "check.h"
+#include "../src/parameters/patch_codec.h"
+#include "../src/parameters/patch_library.h"
+#include "../src/parameters/factory_banks.h"
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace pg1000;
+using parameters::FactoryBanks;
+using parameters::PatchCodec;
+using parameters::PatchLibrary;
+
+using Image = std::array<uint8_t, PatchCodec::SIZE>;
+
+// Buffer for the worst case, one run per changed byte
+using Encoded = std::array<uint8_t, 3 * PatchCodec::SIZE>;
+
+static uint32_t state = 1;
+
+static uint32_t next_random() {
+    state = state * 1103515245u + 12345;
+    return state >> 16;
+}
+
+static Image random_image() {
+    Image image;
+    for (uint8_t& byte : image) byte = next_random() & 0x7F;
+    return image;
+}
+
+// Starts a burst of up to burst changed bytes at about one address in density
+static Image mutate(const Image& reference, uint32_t density, uint32_t burst) {
+    Image image = reference;
+    for (uint16_t address = 0; address < image.size(); address++) {
+        if (density == 0 || next_random() % density != 0) continue;
+        uint32_t length = 1 + next_random() % burst;
+        for (uint32_t i = 0; i < length && address < image.size(); i++, address++) {
+            image[address] = (image[address] + 1 + next_random() % 126) & 0x7F;
+        }
+    }
+    return image;
+}
+
+static uint16_t changed_bytes(const Image& image, const Image* reference) {
+    uint16_t count = 0;
+    for (uint16_t i = 0; i < image.size(); i++) {
+        if (image[i] != (reference ? (*reference)[i] : 0)) count++;
+    }
+    return count;
+}
+
+// Encode, decode and compare, along with the properties every encoding has
+static bool round_trip(const Image& image, const Image* reference) {
+    const uint8_t* ref = reference ? reference->data() : nullptr;
+    Encoded encoded;
+    int length = PatchCodec::encode(image.data(), ref, encoded.data(), encoded.size());
+    if (length < 0) return false;
+
+    // Sizing alone agrees with the real thing
+    if (PatchCodec::encode(image.data(), ref, nullptr, encoded.size()) != length) return false;
+
+    // Any tighter limit fails
+    if (length > 0 && PatchCodec::encode(image.data(), ref, nullptr, length - 1) != -1) return false;
+
+    // Never worse than a run per changed byte, plus the skip runs
+    uint16_t changed = changed_bytes(image, reference);
+    if (changed == 0 && length != 0) return false;
+    if (length > 3 * changed + PatchCodec::RUN_OVERHEAD * (PatchCodec::SIZE / PatchCodec::MAX_RUN)) return false;
+
+    Image decoded;
+    decoded.fill(0xFF);
+    if (!PatchCodec::decode(encoded.data(), length, ref, decoded.data())) return false;
+    if (decoded != image) return false;
+
+    // A byte short is always malformed
+    return length == 0 || !PatchCodec::decode(encoded.data(), length - 1, ref, decoded.data());
+}
+
+static void test_unchanged() {
+    Image reference = random_image();
+    CHECK(round_trip(reference, &reference));
+
+    Image zero = {};
+    CHECK(round_trip(zero, nullptr));
+    CHECK_EQ(PatchCodec::encode(zero.data(), nullptr, nullptr, 0), 0);
+}
+
+static void test_random_edits() {
+    const uint32_t densities[] = {400, 100, 20, 5, 2, 1};
+    const uint32_t bursts[] = {1, 3, 40, 300};
+    bool all = true;
+    for (uint32_t density : densities) {
+        for (uint32_t burst : bursts) {
+            for (int i = 0; i < 50; i++) {
+                Image reference = random_image();
+                all = all && round_trip(mutate(reference, density, burst), &reference);
+            }
+        }
+    }
+    CHECK(all);
+}
+
+static void test_zero_reference() {
+    Image zero = {};
+    bool all = true;
+    for (int i = 0; i < 200; i++) {
+        all = all && round_trip(mutate(zero, 1 + i % 50, 1 + i % 8), nullptr);
+    }
+    all = all && round_trip(random_image(), nullptr);
+    CHECK(all);
+}
+
+// Skips longer than a run can hold, and a change at each end
+static void test_long_skips() {
+    Image reference = random_image();
+    Image image = reference;
+    image[PatchCodec::SIZE - 1] ^= 0x01;
+    CHECK(round_trip(image, &reference));
+
+    image[0] ^= 0x01;
+    CHECK(round_trip(image, &reference));
+
+    image[PatchCodec::MAX_RUN] ^= 0x01;
+    CHECK(round_trip(image, &reference));
+}
+
+static void test_malformed() {
+    Image image;
+    const uint8_t past_end[] = {255, 0, 165, 2, 1, 2};   // One byte beyond the image
+    const uint8_t to_end[] = {255, 0, 164, 2, 1, 2};
+    const uint8_t short_run[] = {0, 3, 1, 2};
+    const uint8_t half_header[] = {0, 1, 5, 7};
+    CHECK(!PatchCodec::decode(past_end, sizeof(past_end), nullptr, image.data()));
+    CHECK(PatchCodec::decode(to_end, sizeof(to_end), nullptr, image.data()));
+    CHECK_EQ(image[PatchCodec::SIZE - 1], 2);
+    CHECK(!PatchCodec::decode(short_run, sizeof(short_run), nullptr, image.data()));
+    CHECK(!PatchCodec::decode(half_header, sizeof(half_header), nullptr, image.data()));
+}
+
+// Whatever the data, decode only ever puts each address once, in order
+static void test_garbage_decodes_in_range() {
+    bool all = true;
+    for (int i = 0; i < 2000; i++) {
+        std::array<uint8_t, 64> data;
+        for (uint8_t& byte : data) byte = next_random() & 0xFF;
+        uint16_t length = next_random() % data.size();
+
+        uint16_t expected = 0;
+        bool ok = PatchCodec::decode(data.data(), length, nullptr, [&](uint16_t address, uint8_t) {
+            all = all && address == expected && address < PatchCodec::SIZE;
+            expected++;
+        });
+        if (ok) all = all && expected == PatchCodec::SIZE;
+    }
+    CHECK(all);
+}
+
+// The Starter bank, as syx2bank put it in the factory table
+static std::vector<Image> load_bank() {
+    std::vector<Image> bank;
+    for (uint8_t number = 0; number < FactoryBanks::get_bank_count(); number++) {
+        if (std::string(FactoryBanks::get_bank_name(number)) != "Starter") continue;
+        for (uint8_t patch = 0; patch < FactoryBanks::get_patch_count(number); patch++) {
+            Image image;
+            std::memcpy(image.data(), FactoryBanks::get_patch(number, patch).data(), image.size());
+            bank.push_back(image);
+        }
+    }
+    return bank;
+}
+
+// A few parameters turned, as a player edits a sound: in range, no bursts
+static Image tweak(const Image& patch, uint32_t edits) {
+    Image image = patch;
+    for (uint32_t i = 0; i < edits; i++) {
+        uint16_t address;
+        do {
+            address = next_random() % image.size();
+        } while (!is_edit_address_valid(address));
+        image[address] = (image[address] + 1 + next_random() % 10) % 101;
+    }
+    return image;
+}
+
+static void test_bank_round_trips() {
+    std::vector<Image> bank = load_bank();
+    CHECK_EQ(bank.size(), 64);
+
+    // Every patch against every other and against the zero image
+    bool all = true;
+    uint32_t zero_bytes = 0;
+    for (const Image& patch : bank) {
+        all = all && round_trip(patch, nullptr);
+        zero_bytes += PatchCodec::encode(patch.data(), nullptr, nullptr, PatchCodec::SIZE);
+        for (const Image& reference : bank) {
+            all = all && round_trip(patch, &reference);
+        }
+    }
+    CHECK(all);
+
+    // Real patches are mostly small values and reserved zeros, the zero
+    // image alone saves a little
+    CHECK(zero_bytes < bank.size() * PatchCodec::SIZE);
+
+    // Edits of a bank patch against the patch it came from
+    uint32_t tweak_bytes = 0;
+    for (uint32_t i = 0; i < bank.size() * 4; i++) {
+        const Image& patch = bank[i % bank.size()];
+        Image edited = tweak(patch, 1 + i % 5);
+        all = all && round_trip(edited, &patch) && round_trip(edited, nullptr);
+        tweak_bytes += PatchCodec::encode(edited.data(), patch.data(), nullptr, PatchCodec::SIZE);
+    }
+    CHECK(all);
+    CHECK(tweak_bytes < bank.size() * 4 * 5 * (PatchCodec::RUN_OVERHEAD + 1));
+}
+
+static void test_library_ratio() {
+    std::vector<Image> bank = load_bank();
+    PatchLibrary::init();
+
+    // The bank itself: each record is a header, the factory patch does the rest
+    bool saved = true;
+    for (uint8_t patch = 0; patch < bank.size(); patch++) {
+        saved = saved && PatchLibrary::save(patch, bank[patch].data());
+    }
+    CHECK(saved);
+    CHECK_EQ(PatchLibrary::get_raw_bytes(), bank.size() * PatchLibrary::PATCH_SIZE);
+    uint32_t stored = PatchLibrary::get_stored_bytes();
+    printf("Starter bank: %lu of %lu bytes\n", static_cast<unsigned long>(stored),
+           static_cast<unsigned long>(PatchLibrary::get_raw_bytes()));
+    CHECK(stored * 100 <= PatchLibrary::get_raw_bytes() * 6);
+
+    // Edited copies of it in the other 64 slots
+    for (uint8_t patch = 0; patch < bank.size(); patch++) {
+        saved = saved && PatchLibrary::save(64 + patch, tweak(bank[patch], 1 + patch % 5).data());
+    }
+    CHECK(saved);
+    stored = PatchLibrary::get_stored_bytes();
+    printf("Starter bank and edits: %lu of %lu bytes\n", static_cast<unsigned long>(stored),
+           static_cast<unsigned long>(PatchLibrary::get_raw_bytes()));
+    CHECK(stored * 100 <= PatchLibrary::get_raw_bytes() * 8);
+
+    // And everything comes back
+    bool same = true;
+    for (uint8_t patch = 0; patch < bank.size(); patch++) {
+        Image image;
+        same = same && PatchLibrary::load(patch, image.data()) && image == bank[patch];
+    }
+    CHECK(same);
+}
+
+int main() {
+    test_unchanged();
+    test_random_edits();
+    test_zero_reference();
+    test_long_skips();
+    test_malformed();
+    test_garbage_decodes_in_range();
+    test_bank_round_trips();
+    test_library_ratio();
+    return check::failures;
+}
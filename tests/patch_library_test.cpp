@@ -0,0 +1,145 @@
+// PatchLibrary: the log in flash survives a rescan, a torn record and a
+// compaction cut short, against the RAM flash model
+
+#include "check.h"
+#include "host.h"
+#include "../src/parameters/patch_library.h"
+#include <array>
+#include <cstring>
+
+using namespace pg1000;
+using hardware::Flash;
+using parameters::PatchLibrary;
+
+using Image = std::array<uint8_t, PatchLibrary::PATCH_SIZE>;
+
+static constexpr uint32_t RAW_RECORD = 448;  // Header and image, 4 byte aligned
+
+// Noise, so nothing encodes smaller than a raw record
+static Image make_image(uint32_t seed) {
+    Image image;
+    uint32_t state = seed * 2654435761u + 1;
+    for (uint8_t& byte : image) {
+        state = state * 1103515245u + 12345;
+        byte = (state >> 16) & 0x7F;
+    }
+    return image;
+}
+
+static bool holds(uint8_t patch, const Image& expected) {
+    Image image;
+    return PatchLibrary::load(patch, image.data()) && image == expected;
+}
+
+static void wipe() {
+    std::memset(host::flash_memory() + PatchLibrary::REGION_OFFSET, 0xFF, 2 * PatchLibrary::HALF_SIZE);
+    PatchLibrary::init();
+}
+
+// Lets the next program stop the given number of bytes into the record
+static void cut_next_record_after(int bytes) {
+    uint32_t write_offset = PatchLibrary::HALF_SIZE - PatchLibrary::get_free_space();
+    host::flash_power_cut_after(write_offset % Flash::PAGE_SIZE + bytes);
+}
+
+static void test_newest_record_wins() {
+    wipe();
+    CHECK_EQ(PatchLibrary::get_generation(), 1);
+    CHECK_EQ(PatchLibrary::get_used_count(), 0);
+
+    CHECK(PatchLibrary::save(3, make_image(1).data()));
+    CHECK(PatchLibrary::save(9, make_image(2).data()));
+    CHECK(PatchLibrary::save(3, make_image(3).data()));
+
+    PatchLibrary::init();
+    CHECK_EQ(PatchLibrary::get_used_count(), 2);
+    CHECK(holds(3, make_image(3)));
+    CHECK(holds(9, make_image(2)));
+    CHECK(!PatchLibrary::is_used(4));
+}
+
+static void test_torn_record_is_skipped() {
+    wipe();
+    CHECK(PatchLibrary::save(5, make_image(10).data()));
+
+    cut_next_record_after(20);  // Part of the header
+    PatchLibrary::save(5, make_image(11).data());
+    host::flash_power_cut_after(-1);
+
+    PatchLibrary::init();
+    CHECK(holds(5, make_image(10)));
+
+    // The log carries on past it
+    uint32_t free_space = PatchLibrary::get_free_space();
+    CHECK(PatchLibrary::save(6, make_image(12).data()));
+    CHECK(PatchLibrary::get_free_space() < free_space);
+    PatchLibrary::init();
+    CHECK(holds(5, make_image(10)));
+    CHECK(holds(6, make_image(12)));
+}
+
+// Saves until the active half fills up and the library compacts, with
+// the last seed of each patch in seeds
+static void fill_until_compaction(std::array<uint32_t, PatchLibrary::PATCH_COUNT>& seeds, uint32_t& seed) {
+    uint32_t generation = PatchLibrary::get_generation();
+    for (uint32_t i = 0; PatchLibrary::get_generation() == generation && i < 1000; i++) {
+        uint8_t patch = (i * 7) % 20;
+        CHECK(PatchLibrary::save(patch, make_image(++seed).data()));
+        seeds[patch] = seed;
+    }
+}
+
+static void test_compaction_keeps_latest() {
+    wipe();
+    std::array<uint32_t, PatchLibrary::PATCH_COUNT> seeds = {};
+    uint32_t seed = 100;
+    fill_until_compaction(seeds, seed);
+    CHECK_EQ(PatchLibrary::get_generation(), 2);
+
+    PatchLibrary::init();
+    CHECK_EQ(PatchLibrary::get_generation(), 2);
+    CHECK_EQ(PatchLibrary::get_used_count(), 20);
+    bool all = true;
+    for (uint8_t patch = 0; patch < 20; patch++) all = all && holds(patch, make_image(seeds[patch]));
+    CHECK(all);
+}
+
+static void test_cut_compaction_leaves_old_half() {
+    wipe();
+    std::array<uint32_t, PatchLibrary::PATCH_COUNT> seeds = {};
+    uint32_t seed = 5000;
+
+    // Fill the first half short of compacting
+    for (uint8_t patch = 0; PatchLibrary::get_free_space() >= RAW_RECORD; patch = (patch + 1) % 20) {
+        CHECK(PatchLibrary::save(patch, make_image(++seed).data()));
+        seeds[patch] = seed;
+    }
+
+    // This one compacts, the power goes partway through copying
+    host::flash_power_cut_after(3000);
+    PatchLibrary::save(1, make_image(++seed).data());
+    host::flash_power_cut_after(-1);
+
+    PatchLibrary::init();
+    CHECK_EQ(PatchLibrary::get_generation(), 1);
+    bool all = true;
+    for (uint8_t patch = 0; patch < 20; patch++) all = all && holds(patch, make_image(seeds[patch]));
+    CHECK(all);
+
+    // The next save compacts again, this time for good
+    CHECK(PatchLibrary::save(1, make_image(++seed).data()));
+    seeds[1] = seed;
+    CHECK_EQ(PatchLibrary::get_generation(), 2);
+    PatchLibrary::init();
+    all = true;
+    for (uint8_t patch = 0; patch < 20; patch++) all = all && holds(patch, make_image(seeds[patch]));
+    CHECK(all);
+}
+
+int main() {
+    test_newest_record_wins();
+    test_torn_record_is_skipped();
+    test_compaction_keeps_latest();
+    test_cut_compaction_leaves_old_half();
+    return check::failures;
+}
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Convert D-50 SysEx dumps into the embedded factory bank table.
+
+Each .syx file becomes one bank. DT1 (one-way) and DAT (handshake)
+packets are collected into a sparse address map, then cut into 421 byte
+edit buffer images:
+
+  - patch memory dumps (02-00-00, 448 bytes per patch) give one record
+    per patch present in the file
+  - an edit buffer dump (00-00-00) gives a single record
+
+Bytes missing from a dump are left at 0. Packets with a bad checksum are
+reported and skipped.
+
+Usage: syx2bank.py -o factory_bank_data.cpp [bank.syx ...]
+"""
+
+import argparse
+import os
+import sys
+
+ROLAND_ID = 0x41
+D50_ID = 0x14
+DATA_COMMANDS = (0x12, 0x42)  # DT1, DAT
+
+PATCH_SIZE = 421          # Edit buffer image
+PATCH_MEMORY = 0x02 << 14  # 02-00-00
+PATCH_STRIDE = 448
+PATCH_COUNT = 64
+
+
+def read_messages(data):
+    """Yield the SysEx messages in a byte string, F0 to F7 inclusive."""
+    start = None
+    for i, byte in enumerate(data):
+        if byte == 0xF0:
+            start = i
+        elif byte == 0xF7 and start is not None:
+            yield data[start:i + 1]
+            start = None
+
+
+def load_memory(path):
+    """Address to byte map of every valid data packet in a file."""
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    memory = {}
+    for msg in read_messages(data):
+        if len(msg) < 11 or msg[1] != ROLAND_ID or msg[3] != D50_ID:
+            continue
+        if msg[4] not in DATA_COMMANDS:
+            continue
+
+        body = msg[5:-2]
+        if (sum(body) + msg[-2]) & 0x7F:
+            print(f'{path}: checksum error, packet skipped', file=sys.stderr)
+            continue
+
+        address = (body[0] << 14) | (body[1] << 7) | body[2]
+        for offset, byte in enumerate(body[3:]):
+            memory[address + offset] = byte & 0x7F
+    return memory
+
+
+def extract_records(memory):
+    """421 byte images in patch order."""
+    def image(base):
+        return bytes(memory.get(base + i, 0) for i in range(PATCH_SIZE))
+
+    def present(base):
+        return any(base + i in memory for i in range(PATCH_SIZE))
+
+    records = []
+    for patch in range(PATCH_COUNT):
+        base = PATCH_MEMORY + patch * PATCH_STRIDE
+        if present(base):
+            records.append(image(base))
+
+    if not records and present(0):
+        records.append(image(0))
+    return records
+
+
+def bank_name(path):
+    name = os.path.splitext(os.path.basename(path))[0]
+    return name.replace('\\', '_').replace('"', '_')
+
+
+def write_table(out, banks):
+    out.write('// Generated by tools/syx2bank.py from banks/*.syx, do not edit\n')
+    out.write('#include "parameters/factory_banks.h"\n\n')
+    out.write('namespace pg1000 {\nnamespace parameters {\n\n')
+
+    for index, (name, records) in enumerate(banks):
+        out.write(f'// {name}: {len(records)} patches\n')
+        out.write(f'static const uint8_t BANK_{index}_RECORDS[] = {{\n')
+        for record in records:
+            for i in range(0, len(record), 16):
+                out.write('    ' + ', '.join(f'0x{b:02X}' for b in record[i:i + 16]) + ',\n')
+        out.write('};\n\n')
+
+    out.write('const FactoryBank FACTORY_BANKS[] = {\n')
+    for index, (name, records) in enumerate(banks):
+        out.write(f'    {{"{name}", BANK_{index}_RECORDS, {len(records)}}},\n')
+    if not banks:
+        out.write('    {nullptr, nullptr, 0}  // No banks, keeps the array non-empty\n')
+    out.write('};\n\n')
+    out.write(f'const uint8_t FACTORY_BANK_COUNT = {len(banks)};\n\n')
+    out.write('} // namespace parameters\n} // namespace pg1000\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('-o', '--output', required=True, help='generated C++ source')
+    parser.add_argument('inputs', nargs='*', help='.syx files, one bank each')
+    args = parser.parse_args()
+
+    banks = []
+    for path in sorted(args.inputs):
+        records = extract_records(load_memory(path))
+        if not records:
+            print(f'{path}: no D-50 patch data found', file=sys.stderr)
+            continue
+        if len(banks) == 255:
+            print(f'{path}: too many banks, ignored', file=sys.stderr)
+            continue
+        banks.append((bank_name(path), records))
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+    with open(args.output, 'w') as out:
+        write_table(out, banks)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())